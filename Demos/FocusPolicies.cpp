@@ -43,6 +43,11 @@ osg::ref_ptr<osgText::Text> TextMouseWheelFocusPolicy;
 FocusPolicy KeyboardFocusPolicy = ManualFocusPolicy;
 FocusPolicy MouseWheelFocusPolicy = ManualFocusPolicy;
 
+// The policies themselves (they have no state, so they can be shared)
+OSGUIsh::ManualFocusPolicy TheManualFocusPolicy;
+OSGUIsh::MouseOverFocusPolicy TheMouseOverFocusPolicy;
+OSGUIsh::MouseDownFocusPolicy TheMouseDownFocusPolicy;
+
 
 
 //
@@ -105,24 +110,19 @@ class ChangePolicyEventHandler: public osgGA::GUIEventHandler
                switch (MouseWheelFocusPolicy)
                {
                   case ManualFocusPolicy:
-                     eh_->setMouseWheelFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<OSGUIsh::MouseOverFocusPolicy>());
+                     eh_->setMouseWheelFocusPolicy(&TheMouseOverFocusPolicy);
                      MouseWheelFocusPolicy = MouseOverFocusPolicy;
                      TextMouseWheelFocusPolicy->setText(
                         "Mouse wheel focus policy: mouse over sets focus");
                      break;
                   case MouseOverFocusPolicy:
-                     eh_->setMouseWheelFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<
-                           OSGUIsh::MouseDownFocusPolicy>());
+                     eh_->setMouseWheelFocusPolicy(&TheMouseDownFocusPolicy);
                      MouseWheelFocusPolicy = MouseDownFocusPolicy;
                      TextMouseWheelFocusPolicy->setText(
                         "Mouse wheel focus policy: mouse down sets focus");
                      break;
                   case MouseDownFocusPolicy:
-                     eh_->setMouseWheelFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<
-                           OSGUIsh::ManualFocusPolicy>());
+                     eh_->setMouseWheelFocusPolicy(&TheManualFocusPolicy);
                      TextMouseWheelFocusPolicy->setText(
                         std::string("Mouse wheel focus policy: manual focus ")
                         + "change (don't change focus)");
@@ -135,25 +135,19 @@ class ChangePolicyEventHandler: public osgGA::GUIEventHandler
                switch (KeyboardFocusPolicy)
                {
                   case ManualFocusPolicy:
-                     eh_->setKeyboardFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<
-                           OSGUIsh::MouseOverFocusPolicy>());
+                     eh_->setKeyboardFocusPolicy(&TheMouseOverFocusPolicy);
                      KeyboardFocusPolicy = MouseOverFocusPolicy;
                      TextKeyboardFocusPolicy->setText(
                         "Keyboard focus policy: mouse over sets focus");
                      break;
                   case MouseOverFocusPolicy:
-                     eh_->setKeyboardFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<
-                           OSGUIsh::MouseDownFocusPolicy>());
+                     eh_->setKeyboardFocusPolicy(&TheMouseDownFocusPolicy);
                      KeyboardFocusPolicy = MouseDownFocusPolicy;
                      TextKeyboardFocusPolicy->setText(
                         "Keyboard focus policy: mouse down sets focus");
                      break;
                   case MouseDownFocusPolicy:
-                     eh_->setKeyboardFocusPolicy(
-                        OSGUIsh::FocusPolicyFactoryMason<
-                           OSGUIsh::ManualFocusPolicy>());
+                     eh_->setKeyboardFocusPolicy(&TheManualFocusPolicy);
                      KeyboardFocusPolicy = ManualFocusPolicy;
                      TextKeyboardFocusPolicy->setText(
                         std::string("Keyboard focus policy: manual focus ")
@@ -302,9 +296,7 @@ int main(int argc, char* argv[])
    // Create the OSGUIsh event handler
    osg::ref_ptr<OSGUIsh::EventHandler> guishEH(
       new OSGUIsh::EventHandler(
-         0.0,
-         OSGUIsh::FocusPolicyFactoryMason<OSGUIsh::MouseOverFocusPolicy>(),
-         OSGUIsh::FocusPolicyFactoryMason<OSGUIsh::MouseDownFocusPolicy>()));
+         0.0, &TheMouseOverFocusPolicy, &TheMouseDownFocusPolicy));
 
    viewer.addEventHandler(guishEH);
 
@@ -240,6 +240,10 @@ int main(int argc, char* argv[])
    // Pick first the HUD, then the scene.
    guishEH->setPickingMasks(HUD_MASK, SCENE_MASK);
 
+   // Find the HUD nodes with 2D tests, before traversing the scene. (Their
+   // geometry is tested too, since they are not rectangular.)
+   guishEH->setOverlayPicking(true, true);
+
    // Enter rendering loop
    viewer.run();
 }
@@ -0,0 +1,110 @@
+/******************************************************************************\
+* AsyncPicker.cpp                                                              *
+* Picking on a worker thread.                                                  *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/AsyncPicker.hpp>
+#include <algorithm>
+#include <cassert>
+
+
+namespace OSGUIsh
+{
+   // - AsyncPicker::AsyncPicker -----------------------------------------------
+   AsyncPicker::AsyncPicker()
+      : state_(IDLE), done_(0), front_(0)
+   {
+      // The worker thread references and unreferences nodes (through the
+      // candidates and hits)
+      osg::Referenced::setThreadSafeReferenceCounting(true);
+
+      startThread();
+   }
+
+
+
+   // - AsyncPicker::~AsyncPicker ----------------------------------------------
+   AsyncPicker::~AsyncPicker()
+   {
+      done_.exchange(1);
+      wakeUp_.release();
+      join();
+   }
+
+
+
+   // - AsyncPicker::post ------------------------------------------------------
+   void AsyncPicker::post()
+   {
+      assert(isIdle() && "Posting while another request is in flight");
+
+      state_.exchange(REQUESTED);
+      wakeUp_.release();
+   }
+
+
+
+   // - AsyncPicker::fetch -----------------------------------------------------
+   const AsyncPicker::Result* AsyncPicker::fetch()
+   {
+      if (state_ != READY)
+         return 0;
+
+      // The worker wrote to the back buffer; it becomes the front one
+      front_ = 1 - front_;
+      state_.exchange(IDLE);
+
+      return &results_[front_];
+   }
+
+
+
+   // - AsyncPicker::run -------------------------------------------------------
+   void AsyncPicker::run()
+   {
+      while (true)
+      {
+         wakeUp_.block();
+         wakeUp_.reset();
+
+         if (done_ != 0)
+            break;
+
+         if (state_ != REQUESTED)
+            continue;
+
+         Result& result = results_[1 - front_];
+         result.hits.clear();
+
+         assert(request_.hits.size() == request_.candidates.size()
+                && "One set of hits and of candidates per mask expected");
+
+         for (std::size_t i = 0; i < request_.candidates.size(); ++i)
+         {
+            result.hits.push_back(request_.hits[i]);
+            PickTraversal::Hits_t& hits = result.hits.back();
+
+            PickTraversal::intersectCandidates(
+               request_.candidates[i], request_.cullBackFaces, hits);
+
+            std::stable_sort(hits.begin(), hits.end());
+
+            if (!request_.allMasks && !hits.empty())
+               break;
+         }
+
+         // Don't keep the scene referenced while idle
+         request_.candidates.clear();
+         request_.hits.clear();
+
+         state_.exchange(READY);
+      }
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,269 @@
+/******************************************************************************\
+* BatchPickTraversal.cpp                                                       *
+* A picking traversal for many segments at once.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <cassert>
+#include <OSGUIsh/BatchPickTraversal.hpp>
+#include <OSGUIsh/PickTraversal.hpp>
+
+
+namespace OSGUIsh
+{
+   // - BatchPickTraversal::makeSegment ----------------------------------------
+   BatchPickTraversal::Segment
+   BatchPickTraversal::makeSegment(const osg::Camera& camera, float x, float y)
+   {
+      osg::Matrixd window;
+      if (camera.getViewport() != 0)
+         window = camera.getViewport()->computeWindowMatrix();
+
+      osg::Matrixd inverseVPW;
+      inverseVPW.invert(
+         camera.getViewMatrix() * camera.getProjectionMatrix() * window);
+
+      return Segment(osg::Vec3d(x, y, 0.0) * inverseVPW,
+                     osg::Vec3d(x, y, 1.0) * inverseVPW);
+   }
+
+
+
+   // - BatchPickTraversal::BatchPickTraversal ---------------------------------
+   BatchPickTraversal::BatchPickTraversal()
+      : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        modelIsIdentity_(true), triangleCache_(new TriangleCache()),
+        cullBackFaces_(false), lodScale_(1.0f), cameraLODScale_(1.0f)
+   {
+      // empty...
+   }
+
+
+
+   // - BatchPickTraversal::setTriangleCache -----------------------------------
+   void BatchPickTraversal::setTriangleCache(TriangleCache* cache)
+   {
+      assert(cache != 0 && "A triangle cache is required");
+      triangleCache_ = cache;
+   }
+
+
+
+   // - BatchPickTraversal::pick -----------------------------------------------
+   const BatchPickTraversal::Hits_t&
+   BatchPickTraversal::pick(osg::Camera* camera, const Segments_t& segments,
+                            osg::Node::NodeMask traversalMask,
+                            bool cullBackFaces)
+   {
+      hits_.assign(segments.size(), Hit());
+      segments_.clear();
+      segments_.reserve(segments.size());
+
+      for (std::size_t i = 0; i < segments.size(); ++i)
+      {
+         LocalSegment segment;
+         segment.index = i;
+         segment.start = segments[i].start;
+         segment.end = segments[i].end;
+         segments_.push_back(segment);
+      }
+
+      model_.makeIdentity();
+      modelIsIdentity_ = true;
+      cullBackFaces_ = cullBackFaces;
+      setTraversalMask(traversalMask);
+
+      view_ = camera->getViewMatrix();
+      projection_ = camera->getProjectionMatrix();
+      window_.makeIdentity();
+      if (camera->getViewport() != 0)
+         window_ = camera->getViewport()->computeWindowMatrix();
+      cameraLODScale_ = camera->getLODScale();
+
+      // Traverse the camera children directly: the camera itself must not be
+      // taken as a nested one
+      if ((camera->getNodeMask() & traversalMask) != 0)
+         camera->traverse(*this);
+
+      segments_.clear();
+
+      return hits_;
+   }
+
+
+
+   // - BatchPickTraversal::apply ----------------------------------------------
+   void BatchPickTraversal::apply(osg::Node& node)
+   {
+      LocalSegments_t passed;
+      if (!cullSegments(node.getBound(), passed))
+         return;
+
+      segments_.swap(passed);
+      traverse(node);
+      segments_.swap(passed);
+   }
+
+
+
+   // - BatchPickTraversal::apply ----------------------------------------------
+   void BatchPickTraversal::apply(osg::Transform& transform)
+   {
+      // Segments in world coordinates mean nothing under absolute transforms
+      // (which include nested cameras used for HUDs)
+      if (transform.getReferenceFrame() != osg::Transform::RELATIVE_RF)
+         return;
+
+      LocalSegments_t passed;
+      if (!cullSegments(transform.getBound(), passed))
+         return;
+
+      osg::Matrixd localToParent;
+      transform.computeLocalToWorldMatrix(localToParent, this);
+
+      osg::Matrixd parentToLocal;
+      if (!parentToLocal.invert(localToParent))
+         return; // singular matrix, nothing under it can be picked
+
+      typedef LocalSegments_t::iterator iter_t;
+      for (iter_t p = passed.begin(); p != passed.end(); ++p)
+      {
+         p->start = p->start * parentToLocal;
+         p->end = p->end * parentToLocal;
+      }
+
+      const osg::Matrixd savedModel = model_;
+      const bool savedModelIsIdentity = modelIsIdentity_;
+      const float savedCameraLODScale = cameraLODScale_;
+
+      model_ = localToParent * model_;
+      modelIsIdentity_ = false;
+
+      if (const osg::Camera* camera = dynamic_cast<osg::Camera*>(&transform))
+      {
+         cameraLODScale_ =
+            PickTraversal::getNestedLODScale(*camera, cameraLODScale_);
+      }
+
+      segments_.swap(passed);
+      traverse(transform);
+      segments_.swap(passed);
+
+      model_ = savedModel;
+      modelIsIdentity_ = savedModelIsIdentity;
+      cameraLODScale_ = savedCameraLODScale;
+   }
+
+
+
+   // - BatchPickTraversal::apply ----------------------------------------------
+   void BatchPickTraversal::apply(osg::Geode& geode)
+   {
+      LocalSegments_t passed;
+      if (!cullSegments(geode.getBound(), passed))
+         return;
+
+      osg::Matrixd inverseModel;
+      if (!modelIsIdentity_)
+         inverseModel.invert(model_);
+
+      // Take each drawable's triangles once, test them against every segment
+      for (unsigned d = 0; d < geode.getNumDrawables(); ++d)
+      {
+         const TriangleCache::TrianglesPtr triangles =
+            triangleCache_->get(*geode.getDrawable(d));
+
+         if (triangles->size() == 0)
+            continue;
+
+         typedef LocalSegments_t::const_iterator iter_t;
+         for (iter_t p = passed.begin(); p != passed.end(); ++p)
+         {
+            Hit& hit = hits_[p->index];
+
+            float ratio = static_cast<float>(hit.ratio);
+            const std::size_t tri =
+               triangles->intersect(p->start, p->end, cullBackFaces_, ratio);
+
+            if (tri == triangles->size())
+               continue;
+
+            hit.hasHit = true;
+            hit.ratio = ratio;
+
+            Intersection_t& i = hit.intersection;
+            i.nodePath = getNodePath();
+            i.localIntersectionPoint = p->start + (p->end - p->start) * ratio;
+            i.localIntersectionNormal = triangles->getNormal(tri);
+            i.localIntersectionNormal.normalize();
+
+            if (modelIsIdentity_)
+            {
+               i.worldIntersectionPoint = i.localIntersectionPoint;
+               i.worldIntersectionNormal = i.localIntersectionNormal;
+            }
+            else
+            {
+               i.worldIntersectionPoint = i.localIntersectionPoint * model_;
+               i.worldIntersectionNormal = osg::Matrixd::transform3x3(
+                  inverseModel, i.localIntersectionNormal);
+               i.worldIntersectionNormal.normalize();
+            }
+         }
+      }
+   }
+
+
+
+   // - BatchPickTraversal::apply ----------------------------------------------
+   void BatchPickTraversal::apply(osg::Projection&)
+   {
+      // Segments in world coordinates mean nothing under a Projection
+   }
+
+
+
+   // - BatchPickTraversal::apply ----------------------------------------------
+   void BatchPickTraversal::apply(osg::LOD& lod)
+   {
+      LocalSegments_t passed;
+      if (!cullSegments(lod.getBound(), passed))
+         return;
+
+      std::vector<unsigned> children;
+      PickTraversal::selectLODChildren(
+         lod, modelIsIdentity_ ? view_ : model_ * view_, projection_, window_,
+         cameraLODScale_ * lodScale_, children);
+
+      segments_.swap(passed);
+
+      for (std::size_t i = 0; i < children.size(); ++i)
+         lod.getChild(children[i])->accept(*this);
+
+      segments_.swap(passed);
+   }
+
+
+
+   // - BatchPickTraversal::cullSegments ---------------------------------------
+   bool BatchPickTraversal::cullSegments(const osg::BoundingSphere& bs,
+                                         LocalSegments_t& passed) const
+   {
+      passed.clear();
+
+      typedef LocalSegments_t::const_iterator iter_t;
+      for (iter_t p = segments_.begin(); p != segments_.end(); ++p)
+      {
+         if (PickTraversal::intersects(bs, p->start, p->end))
+            passed.push_back(*p);
+      }
+
+      return !passed.empty();
+   }
+
+} // namespace OSGUIsh
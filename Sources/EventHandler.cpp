@@ -10,7 +10,16 @@
 \******************************************************************************/
 
 #include "OSGUIsh/EventHandler.hpp"
+#include <algorithm>
+#include <cmath>
 #include <boost/lexical_cast.hpp>
+#include <osg/FrameStamp>
+#include <osg/Timer>
+#include <osg/Version>
+
+#if OSG_VERSION_GREATER_OR_EQUAL(3, 0, 0)
+#  define OSGUISH_HAVE_MULTI_TOUCH
+#endif
 
 
 namespace
@@ -42,6 +51,95 @@ namespace
       return rayDir * hit.worldIntersectionNormal < 0.0;
    }
 
+
+
+   /// A task that picks a camera's subgraph with a single node mask.
+   class PickTask: public OSGUIsh::PickThreadPool::Task
+   {
+      public:
+         PickTask(osg::Camera* camera, float x, float y,
+                  osg::Node::NodeMask mask, float lodScale)
+            : camera_(camera), x_(x), y_(y), mask_(mask)
+         {
+            traversal_.setLODScale(lodScale);
+         }
+
+         virtual void run()
+         {
+            traversal_.start(camera_, x_, y_, mask_);
+            traversal_.resume();
+         }
+
+         const OSGUIsh::PickTraversal::Hits_t& getHits() const
+         { return traversal_.getHits(); }
+
+      private:
+         osg::Camera* camera_;
+         float x_;
+         float y_;
+         osg::Node::NodeMask mask_;
+         OSGUIsh::PickTraversal traversal_;
+   };
+
+
+
+   /// A task that picks a camera's subgraph with a batch of segments.
+   class BatchPickTask: public OSGUIsh::PickThreadPool::Task
+   {
+      public:
+         BatchPickTask(osg::Camera* camera, osg::Node::NodeMask mask,
+                       bool cullBackFaces, float lodScale,
+                       OSGUIsh::TriangleCache* triangleCache)
+            : camera_(camera), mask_(mask), cullBackFaces_(cullBackFaces)
+         {
+            traversal_.setLODScale(lodScale);
+            traversal_.setTriangleCache(triangleCache);
+         }
+
+         virtual void run()
+         {
+            traversal_.pick(camera_, segments, mask_, cullBackFaces_);
+         }
+
+         const OSGUIsh::BatchPickTraversal::Hits_t& getHits() const
+         { return traversal_.getHits(); }
+
+         OSGUIsh::BatchPickTraversal::Segments_t segments;
+
+      private:
+         osg::Camera* camera_;
+         osg::Node::NodeMask mask_;
+         bool cullBackFaces_;
+         OSGUIsh::BatchPickTraversal traversal_;
+   };
+
+
+
+   /**
+    * The number of segments above which batch picking is split among the
+    * threads of a thread pool.
+    */
+   const std::size_t BATCH_PICK_CHUNK_SIZE = 256;
+
+   /// The value of an index into the list of gestures that refers to none.
+   const std::size_t NO_GESTURE = static_cast<std::size_t>(-1);
+
+
+
+   /**
+    * Returns the index of an event type in the table of values returned by
+    * \c EventHandler::handle(): the position of its bit, plus one (so that
+    * \c NONE gets index zero).
+    */
+   std::size_t GetEventTypeIndex(osgGA::GUIEventAdapter::EventType eventType)
+   {
+      std::size_t index = 0;
+      for (unsigned bits = eventType; bits != 0; bits >>= 1)
+         ++index;
+
+      return index;
+   }
+
 } // (anonymous) namespace
 
 
@@ -49,25 +147,56 @@ namespace OSGUIsh
 {
    // - EventHandler::EventHandler ---------------------------------------------
    EventHandler::EventHandler(
-      double pickerRadius,
-      const FocusPolicyFactory& kbdPolicyFactory,
-      const FocusPolicyFactory& wheelPolicyFactory)
+      double pickerRadius, FocusPolicy* kbdPolicy, FocusPolicy* wheelPolicy)
       : pickerRadius_(pickerRadius), ignoreBackFaces_(false),
-        kbdFocusPolicy_(kbdPolicyFactory.create(kbdFocus_)),
-        wheelFocusPolicy_(wheelPolicyFactory.create(wheelFocus_))
+        eventConsumed_(false), pressConsumed_(false),
+        mouseView_(0), nextPointerId_(MOUSE_POINTER + 1),
+        regionSelectionMode_(REGION_SELECTION_NONE),
+        regionSelectionButton_(osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON),
+        regionSelectionModKeyMask_(osgGA::GUIEventAdapter::MODKEY_SHIFT),
+        regionDragging_(false), regionChanged_(false),
+        regionCandidatesDirty_(false),
+        dragConstraint_(DRAG_ON_VIEW_PLANE),
+        dragConstraintDirection_(0.0, 0.0, 1.0), dropProbeRate_(0.0),
+        dragThreshold_(4.0f), doubleClickInterval_(0.3),
+        clickSerial_(0), hoverDwellGesture_(NO_GESTURE),
+        hysteresisPixels_(0.0f),
+        hysteresisFrames_(0), depthTieTolerance_(0.0), hysteresisCount_(0),
+        asyncPickView_(0), pickBudget_(0.0), hoverMaskIndex_(0),
+        hoverX_(0.0f), hoverY_(0.0f),
+        pickSchedule_(PICK_EVERY_FRAME), maxPickRate_(30.0),
+        timeOfLastPick_(-1.0), pointerMoved_(true), pickDirty_(true),
+        lastViewport_(-1.0, -1.0, -1.0, -1.0),
+        overlayPicking_(false), overlayGeometry_(false), pickLODScale_(1.0f),
+        triangleCache_(new TriangleCache()),
+        nextPickCacheEntry_(0), sceneRevision_(0),
+        kbdFocusPolicy_(kbdPolicy),
+        numKeySignals_(0), focusNavigation_(false),
+        focusChainEnabled_(false),
+        wheelFocusPolicy_(wheelPolicy),
+        scrollPending_(false),
+        blankEvent_(new osgGA::GUIEventAdapter())
    {
       assert(pickerRadius_ >= 0.0 && "Cannot use negative picker radius");
 
       addNode(NodePtr());
 
-      for (int i = 0; i < MOUSE_BUTTON_COUNT; ++i)
-      {
-         nodeThatGotMouseDown_[i] = NodePtr();
-         nodeThatGotClick_[i] = NodePtr();
-         timeOfLastClick_[i] = -1.0;
-      }
+      setFocusHistorySize(8);
+
+      std::fill(handleReturnValues_, handleReturnValues_ + NUM_EVENT_TYPES,
+                RETURN_IF_CONSUMED);
+      setHandleReturnValue(osgGA::GUIEventAdapter::FRAME, RETURN_FALSE);
 
       pickingMasks_.push_back(0xFFFFFFFF); // by default, no restrictions
+
+      navigationKeys_[FocusNavigator::NAVIGATE_LEFT] =
+         osgGA::GUIEventAdapter::KEY_Left;
+      navigationKeys_[FocusNavigator::NAVIGATE_RIGHT] =
+         osgGA::GUIEventAdapter::KEY_Right;
+      navigationKeys_[FocusNavigator::NAVIGATE_UP] =
+         osgGA::GUIEventAdapter::KEY_Up;
+      navigationKeys_[FocusNavigator::NAVIGATE_DOWN] =
+         osgGA::GUIEventAdapter::KEY_Down;
    }
 
 
@@ -76,26 +205,148 @@ namespace OSGUIsh
    bool EventHandler::handle(const osgGA::GUIEventAdapter& ea,
                              osgGA::GUIActionAdapter& aa)
    {
+      osg::View* view = dynamic_cast<osg::View*>(&aa);
+
+      eventConsumed_ = false;
+
+      // The pointer belongs to the view receiving pointer events
+      const unsigned pointerEvents = osgGA::GUIEventAdapter::PUSH
+         | osgGA::GUIEventAdapter::RELEASE
+         | osgGA::GUIEventAdapter::DOUBLECLICK
+         | osgGA::GUIEventAdapter::DRAG
+         | osgGA::GUIEventAdapter::MOVE
+         | osgGA::GUIEventAdapter::SCROLL;
+
+      if (view != 0 && view != mouseView_
+          && (ea.getEventType() & pointerEvents) != 0)
+      {
+         setMouseView(view);
+      }
+
+#     ifdef OSGUISH_HAVE_MULTI_TOUCH
+      if (ea.isMultiTouchEvent() && ea.getTouchData() != 0)
+      {
+         // Touch contacts are pointers of their own, handled in the next
+         // FRAME event
+         handleTouchEvent(ea);
+         return getHandleReturnValue(ea.getEventType());
+      }
+#     endif
+
+      // The node passed to the focus policies. Mouse button and wheel events
+      // use the node actually under the event coordinates.
+      NodePtr focusCandidate = mouse_.node;
+
       switch (ea.getEventType())
       {
          case osgGA::GUIEventAdapter::FRAME:
          {
-            osg::View* view = dynamic_cast<osg::View*>(&aa);
             assert(view != 0 && "Needed an osg::View here.");
             handleFrameEvent(view, ea);
+            focusCandidate = mouse_.node;
             break;
          }
 
          case osgGA::GUIEventAdapter::PUSH:
-            handlePushEvent(ea);
+         {
+            const PickResult pick = pickAtEvent(view, ea);
+            handlePushEvent(mouse_, getMouseButton(ea), ea, pick);
+            focusCandidate = pick.node;
+
+            if (!gestures_.empty())
+               recognizePressGestures(view, ea, pick.node);
+
+            if (regionSelectionMode_ != REGION_SELECTION_NONE && view != 0
+                && static_cast<unsigned>(ea.getButton())
+                   == regionSelectionButton_
+                && (regionSelectionModKeyMask_ == 0
+                    || (ea.getModKeyMask() & regionSelectionModKeyMask_) != 0))
+            {
+               beginRegionDrag(view, ea);
+            }
+            else if (!drag_.active && view != 0 && isDraggable(pick.node))
+            {
+               // Maybe the start of a drag
+               float x, y;
+               getWindowCoords(view, ea, x, y);
+               drag_.pending = true;
+               drag_.button = getMouseButton(ea);
+               drag_.pressPosition = osg::Vec2(x, y);
+               drag_.pick = pick;
+            }
             break;
+         }
 
          case osgGA::GUIEventAdapter::RELEASE:
-            handleReleaseEvent(ea);
+         {
+            if (drag_.active && getMouseButton(ea) == drag_.button)
+            {
+               // No picking here: the dragged node captures the pointer
+               endDrag(view, ea);
+               focusCandidate = drag_.pick.node;
+
+               // A drag is never a click
+               if (!gestures_.empty())
+                  recognizeReleaseGestures(view, ea, PickResult());
+               break;
+            }
+
+            if (drag_.pending && getMouseButton(ea) == drag_.button)
+               drag_.pending = false;
+
+            const PickResult pick = pickAtEvent(view, ea);
+            const bool isClick = pick.node.valid()
+               && pick.node
+                  == mouse_.nodeThatGotMouseDown[getMouseButton(ea)];
+
+            handleReleaseEvent(mouse_, getMouseButton(ea), ea, pick);
+            focusCandidate = pick.node;
+
+            if (!gestures_.empty())
+            {
+               recognizeReleaseGestures(view, ea,
+                                        isClick ? pick : PickResult());
+            }
+
+            if (regionDragging_ && view != 0
+                && static_cast<unsigned>(ea.getButton())
+                   == regionSelectionButton_)
+            {
+               extendRegionDrag(view, ea);
+               updateRegionSelection(view);
+               regionDragging_ = false;
+            }
+            break;
+         }
+
+         case osgGA::GUIEventAdapter::MOVE:
+            pointerMoved_ = true;
+            break;
+
+         case osgGA::GUIEventAdapter::DRAG:
+            pointerMoved_ = true;
+            if (regionDragging_ && view != 0)
+            {
+               extendRegionDrag(view, ea);
+            }
+            else if (drag_.pending && view != 0)
+            {
+               float x, y;
+               getWindowCoords(view, ea, x, y);
+               if ((osg::Vec2(x, y) - drag_.pressPosition).length()
+                   >= dragThreshold_)
+               {
+                  beginDrag(view, ea);
+               }
+            }
             break;
 
          case osgGA::GUIEventAdapter::KEYDOWN:
             handleKeyDownEvent(ea);
+            if (focusNavigation_ && view != 0)
+               navigateFocus(view, ea);
+            if (focusChainEnabled_ && view != 0)
+               traverseFocusChain(view, ea);
             break;
 
          case osgGA::GUIEventAdapter::KEYUP:
@@ -103,17 +354,63 @@ namespace OSGUIsh
             break;
 
          case osgGA::GUIEventAdapter::SCROLL:
-            handleScrollEvent(ea);
+         {
+            const PickResult pick = pickAtEvent(view, ea);
+            handleScrollEvent(ea, pick);
+            focusCandidate = pick.node;
+            break;
+         }
+
+         default:
+            break;
+      }
+
+      // Policies are called only for the event types they react to
+      if (kbdFocusPolicy_ != 0)
+      {
+         NodePtr focus = kbdFocus_;
+         if (kbdFocusPolicy_->decideFocus(ea, focusCandidate, focus))
+            moveFocus(KEYBOARD_FOCUS, focus, ea);
+      }
+
+      if (wheelFocusPolicy_ != 0)
+      {
+         NodePtr focus = wheelFocus_;
+         if (wheelFocusPolicy_->decideFocus(ea, focusCandidate, focus))
+            moveFocus(MOUSE_WHEEL_FOCUS, focus, ea);
+      }
+
+      // Once a press is consumed, so is the rest of the click (or drag)
+      switch (ea.getEventType())
+      {
+         case osgGA::GUIEventAdapter::PUSH:
+            pressConsumed_ = pressConsumed_ || eventConsumed_;
+            break;
+
+         case osgGA::GUIEventAdapter::DRAG:
+            eventConsumed_ = eventConsumed_ || pressConsumed_;
+            break;
+
+         case osgGA::GUIEventAdapter::RELEASE:
+            eventConsumed_ = eventConsumed_ || pressConsumed_;
+            if (ea.getButtonMask() == 0)
+               pressConsumed_ = false;
             break;
 
          default:
             break;
       }
 
-      kbdFocusPolicy_->updateFocus(ea, nodeUnderMouse_);
-      wheelFocusPolicy_->updateFocus(ea, nodeUnderMouse_);
+      return getHandleReturnValue(ea.getEventType());
+   }
+
 
-      return handleReturnValues_[ea.getEventType()];
+
+   // - EventHandler::setHandleReturnValue -------------------------------------
+   void EventHandler::setHandleReturnValue(
+      osgGA::GUIEventAdapter::EventType eventType, HandleReturnValue value)
+   {
+      handleReturnValues_[GetEventTypeIndex(eventType)] = value;
    }
 
 
@@ -124,6 +421,7 @@ namespace OSGUIsh
       std::vector<osg::Node::NodeMask> masks;
       pickingMasks_ = std::vector<osg::Node::NodeMask>();
       pickingMasks_.push_back(newMask);
+      pickCache_.clear();
    }
 
 
@@ -136,6 +434,7 @@ namespace OSGUIsh
       pickingMasks_ = std::vector<osg::Node::NodeMask>();
       pickingMasks_.push_back(newMask1);
       pickingMasks_.push_back(newMask2);
+      pickCache_.clear();
    }
 
 
@@ -150,6 +449,7 @@ namespace OSGUIsh
       pickingMasks_.push_back(newMask1);
       pickingMasks_.push_back(newMask2);
       pickingMasks_.push_back(newMask3);
+      pickCache_.clear();
    }
 
 
@@ -159,6 +459,7 @@ namespace OSGUIsh
       const std::vector<osg::Node::NodeMask>& newMasks)
    {
       pickingMasks_ = newMasks;
+      pickCache_.clear();
    }
 
 
@@ -180,8 +481,24 @@ namespace OSGUIsh
       OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_MOUSE_WHEEL_DOWN);
       OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_KEY_UP);
       OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_KEY_DOWN);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_DRAG_START);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_DRAG);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_DRAG_END);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_DROP);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_HOVER_DWELL);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_HOVER_CANCEL);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_SCROLL);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_FOCUS_IN);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_FOCUS_OUT);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_WHEEL_FOCUS_IN);
+      OSGUISH_EVENTHANDLER_ADD_EVENT(EVENT_WHEEL_FOCUS_OUT);
 
 #     undef OSGUISH_EVENTHANDLER_ADD_EVENT
+
+      ++sceneRevision_;
+      focusNavigator_.invalidate();
+      focusChain_.invalidate();
+      overlayIndex_.invalidate();
    }
 
 
@@ -210,10 +527,73 @@ namespace OSGUIsh
 
 
 
+   // - EventHandler::getKeySignal ---------------------------------------------
+   EventHandler::SignalPtr EventHandler::getKeySignal(const NodePtr node,
+                                                      int key,
+                                                      unsigned modKeyMask,
+                                                      Event event)
+   {
+      assert((event == EVENT_KEY_DOWN || event == EVENT_KEY_UP)
+             && "Key signals must be for 'KeyDown' or 'KeyUp'");
+
+      if (signals_.find(node) == signals_.end())
+      {
+         throw std::runtime_error(
+            ("Trying to get a key signal of an unknown node: '"
+             + node->getName() + "' ("
+             + boost::lexical_cast<std::string>(node) + ").").c_str());
+      }
+
+      key = normalizeKey(key);
+      modKeyMask = normalizeModKeyMask(modKeyMask);
+
+      if (!keySignals_.empty())
+      {
+         const std::size_t i =
+            findKeySignal(node.get(), key, modKeyMask, event);
+
+         if (keySignals_[i].signal)
+            return keySignals_[i].signal;
+      }
+
+      // Not found; keep the load factor at most one half
+      if (2 * (numKeySignals_ + 1) > keySignals_.size())
+      {
+         KeySignalEntries_t oldEntries(
+            std::max<std::size_t>(16, 2 * keySignals_.size()));
+         oldEntries.swap(keySignals_);
+
+         typedef KeySignalEntries_t::const_iterator iter_t;
+         for (iter_t p = oldEntries.begin(); p != oldEntries.end(); ++p)
+         {
+            if (p->signal)
+            {
+               keySignals_[findKeySignal(p->node.get(), p->key,
+                                         p->modKeyMask, p->event)] = *p;
+            }
+         }
+      }
+
+      KeySignalEntry& entry =
+         keySignals_[findKeySignal(node.get(), key, modKeyMask, event)];
+
+      entry.node = node;
+      entry.key = key;
+      entry.modKeyMask = modKeyMask;
+      entry.event = event;
+      entry.signal = SignalPtr(new Signal_t());
+
+      ++numKeySignals_;
+
+      return entry.signal;
+   }
+
+
+
    // - EventHandler::setKeyboardFocus -----------------------------------------
    void EventHandler::setKeyboardFocus(const NodePtr node)
    {
-      kbdFocus_ = node;
+      moveFocus(KEYBOARD_FOCUS, node, *blankEvent_);
    }
 
 
@@ -221,322 +601,2588 @@ namespace OSGUIsh
    // - EventHandler::setMouseWheelFocus ---------------------------------------
    void EventHandler::setMouseWheelFocus(const NodePtr node)
    {
-      wheelFocus_ = node;
+      moveFocus(MOUSE_WHEEL_FOCUS, node, *blankEvent_);
    }
 
 
 
    // - EventHandler::setKeyboardFocusPolicy -----------------------------------
-   void EventHandler::setKeyboardFocusPolicy(
-      const FocusPolicyFactory& policyFactory)
+   void EventHandler::setKeyboardFocusPolicy(FocusPolicy* policy)
    {
-      kbdFocusPolicy_ = policyFactory.create(kbdFocus_);
+      kbdFocusPolicy_ = policy;
    }
 
 
 
    // - EventHandler::setMouseWheelFocusPolicy ---------------------------------
-   void EventHandler::setMouseWheelFocusPolicy(
-      const FocusPolicyFactory& policyFactory)
+   void EventHandler::setMouseWheelFocusPolicy(FocusPolicy* policy)
    {
-      wheelFocusPolicy_ = policyFactory.create(wheelFocus_);
+      wheelFocusPolicy_ = policy;
    }
 
 
 
-   // - EventHandler::getObservedNode ------------------------------------------
-   NodePtr EventHandler::getObservedNode(const osg::NodePath& nodePath)
+   // - EventHandler::setFocusNavigation ---------------------------------------
+   void EventHandler::setFocusNavigation(bool enable, int leftKey,
+                                         int rightKey, int upKey, int downKey)
    {
-      typedef osg::NodePath::const_reverse_iterator iter_t;
-      for (iter_t p = nodePath.rbegin(); p != nodePath.rend(); ++p)
-      {
-         if (signals_.find(NodePtr(*p)) != signals_.end())
-            return NodePtr(*p);
-      }
-
-      return NodePtr();
+      focusNavigation_ = enable;
+      navigationKeys_[FocusNavigator::NAVIGATE_LEFT] = leftKey;
+      navigationKeys_[FocusNavigator::NAVIGATE_RIGHT] = rightKey;
+      navigationKeys_[FocusNavigator::NAVIGATE_UP] = upKey;
+      navigationKeys_[FocusNavigator::NAVIGATE_DOWN] = downKey;
    }
 
 
 
-   // - EventHandler::handleFrameEvent -----------------------------------------
-   void EventHandler::handleFrameEvent(osg::View* view,
-                                       const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setFocusChain --------------------------------------------
+   void EventHandler::setFocusChain(bool enable, FocusChain::Order order,
+                                    float rowHeight)
    {
-      assert(pickingMasks_.size() > 0);
+      focusChainEnabled_ = enable;
+      focusChain_.setOrder(order, rowHeight);
+   }
 
-      updatePickingData(view, ea);
 
-      // Trigger the events
-      if (nodeUnderMouse_ == prevNodeUnderMouse_)
-      {
-         if (prevNodeUnderMouse_.valid()
-             && positionUnderMouse_ != prevPositionUnderMouse_)
-         {
-            HandlerParams params (nodeUnderMouse_, ea, hitUnderMouse_);
-            signals_[nodeUnderMouse_][EVENT_MOUSE_MOVE]->operator()(params);
-         }
-      }
-      else // nodeUnderMouse != prevNodeUnderMouse_
-      {
-         if (prevNodeUnderMouse_.valid())
-         {
-            HandlerParams params (prevNodeUnderMouse_, ea, hitUnderMouse_);
-            signals_[prevNodeUnderMouse_][EVENT_MOUSE_LEAVE]
-               ->operator()(params);
-         }
 
-         if (nodeUnderMouse_.valid())
-         {
-            HandlerParams params (nodeUnderMouse_, ea, hitUnderMouse_);
-            signals_[nodeUnderMouse_][EVENT_MOUSE_ENTER]->operator()(params);
-         }
-      }
+   // - EventHandler::setTabIndex ----------------------------------------------
+   void EventHandler::setTabIndex(const NodePtr& node, int tabIndex)
+   {
+      focusChain_.setTabIndex(node, tabIndex);
    }
 
 
 
-   // - EventHandler::handlePushEvent ------------------------------------------
-   void EventHandler::handlePushEvent(const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setFocusHistorySize --------------------------------------
+   void EventHandler::setFocusHistorySize(std::size_t size)
    {
-      // Trigger a "MouseDown" signal.
-      if (nodeUnderMouse_.valid())
+      for (std::size_t i = 0; i < 2; ++i)
       {
-         HandlerParams params (nodeUnderMouse_, ea, hitUnderMouse_);
-         signals_[nodeUnderMouse_][EVENT_MOUSE_DOWN]->operator()(params);
+         focusHistories_[i].nodes.assign(size, NodePtr());
+         focusHistories_[i].newest = 0;
+         focusHistories_[i].count = 0;
       }
+   }
 
-      // Do the bookkeeping for "Click" and "DoubleClick"
-      MouseButton button = getMouseButton(ea);
-      nodeThatGotMouseDown_[button] = nodeUnderMouse_;
+
+
+   // - EventHandler::getPreviousFocus -----------------------------------------
+   NodePtr EventHandler::getPreviousFocus(FocusKind kind, std::size_t age) const
+   {
+      const FocusHistory& history = focusHistories_[kind];
+
+      if (age >= history.count)
+         return NodePtr();
+
+      const std::size_t capacity = history.nodes.size();
+      return history.nodes[(history.newest + capacity - age) % capacity];
    }
 
 
 
-   // - EventHandler::handleReleaseEvent ---------------------------------------
-   void EventHandler::handleReleaseEvent(const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::restorePreviousFocus -------------------------------------
+   bool EventHandler::restorePreviousFocus(FocusKind kind)
    {
-      const double DOUBLE_CLICK_INTERVAL = 0.3;
+      FocusHistory& history = focusHistories_[kind];
 
-      if (nodeUnderMouse_.valid())
-      {
-         MouseButton button = getMouseButton(ea);
+      if (history.count == 0)
+         return false;
 
-         // First the trivial case: the "MouseUp" event
-         HandlerParams params(nodeUnderMouse_, ea, hitUnderMouse_);
-         signals_[nodeUnderMouse_][EVENT_MOUSE_UP]->operator()(params);
+      const std::size_t capacity = history.nodes.size();
+      const NodePtr node = history.nodes[history.newest];
 
-         // Now, the trickier ones: "Click" and "DoubleClick"
-         if (nodeUnderMouse_ == nodeThatGotMouseDown_[button])
-         {
-            HandlerParams params(nodeUnderMouse_, ea, hitUnderMouse_);
-            signals_[nodeUnderMouse_][EVENT_CLICK]->operator()(params);
+      history.nodes[history.newest] = NodePtr();
+      history.newest = (history.newest + capacity - 1) % capacity;
+      --history.count;
+
+      moveFocus(kind, node, *blankEvent_, false);
+
+      return true;
+   }
 
-            const double now = ea.getTime();
 
-            if (now - timeOfLastClick_[button] < DOUBLE_CLICK_INTERVAL
-                && nodeUnderMouse_ == nodeThatGotClick_[button])
-            {
-               HandlerParams params (nodeUnderMouse_, ea, hitUnderMouse_);
-               signals_[nodeUnderMouse_][EVENT_DOUBLE_CLICK]
-                  ->operator()(params);
-            }
 
-            nodeThatGotClick_[button] = nodeUnderMouse_;
-            timeOfLastClick_[button] = now;
+   // - EventHandler::pickAt ---------------------------------------------------
+   PickResult EventHandler::pickAt(osg::View* view, float x, float y)
+   {
+      const osg::FrameStamp* frameStamp = view->getFrameStamp();
+      const unsigned frameNumber =
+         frameStamp != 0 ? frameStamp->getFrameNumber() : 0;
+
+      typedef std::vector<PickCacheEntry>::const_iterator iter_t;
+      for (iter_t p = pickCache_.begin(); p != pickCache_.end(); ++p)
+      {
+         if (p->view == view && p->x == x && p->y == y
+             && p->sceneRevision == sceneRevision_
+             && p->frameNumber == frameNumber)
+         {
+            return p->result;
          }
       }
+
+      PickCacheEntry entry;
+      entry.view = view;
+      entry.x = x;
+      entry.y = y;
+      entry.sceneRevision = sceneRevision_;
+      entry.frameNumber = frameNumber;
+      pick(view, x, y, entry.result);
+
+      if (pickCache_.size() < PICK_CACHE_SIZE)
+      {
+         pickCache_.push_back(entry);
+      }
+      else
+      {
+         pickCache_[nextPickCacheEntry_] = entry;
+         nextPickCacheEntry_ = (nextPickCacheEntry_ + 1) % PICK_CACHE_SIZE;
+      }
+
+      return entry.result;
    }
 
 
 
-   // - EventHandler::handleKeyDownEvent ---------------------------------------
-   void EventHandler::handleKeyDownEvent(const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::markSceneDirty -------------------------------------------
+   void EventHandler::markSceneDirty()
    {
-      HandlerParams params(kbdFocus_, ea, hitUnderMouse_);
-      signals_[kbdFocus_][EVENT_KEY_DOWN]->operator()(params);
+      ++sceneRevision_;
+      pickCache_.clear();
+      nextPickCacheEntry_ = 0;
+      pickDirty_ = true;
+      regionCandidatesDirty_ = true;
+      focusNavigator_.invalidate();
+      focusChain_.invalidate();
+      overlayIndex_.invalidate();
+      triangleCache_->prune();
+
+      if (pickService_.valid())
+         pickService_->markSceneDirty();
    }
 
 
 
-   // - EventHandler::handleKeyUpEvent -----------------------------------------
-   void EventHandler::handleKeyUpEvent(const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setPickSchedule ------------------------------------------
+   void EventHandler::setPickSchedule(PickSchedule schedule)
    {
-      HandlerParams params(kbdFocus_, ea, hitUnderMouse_);
-      signals_[kbdFocus_][EVENT_KEY_UP]->operator()(params);
+      pickSchedule_ = schedule;
+      pickDirty_ = true;
    }
 
 
 
-   // - EventHandler::handleScrollEvent ----------------------------------------
-   void EventHandler::handleScrollEvent(const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setMaxPickRate -------------------------------------------
+   void EventHandler::setMaxPickRate(double picksPerSecond)
    {
-      switch (ea.getScrollingMotion())
-      {
-         case osgGA::GUIEventAdapter::SCROLL_UP:
-         {
-            HandlerParams params(wheelFocus_, ea, hitUnderMouse_);
-            signals_[wheelFocus_][EVENT_MOUSE_WHEEL_UP]->operator()(params);
-            break;
-         }
+      assert(picksPerSecond > 0.0 && "Picking rate must be positive");
+      maxPickRate_ = picksPerSecond;
+   }
 
-         case osgGA::GUIEventAdapter::SCROLL_DOWN:
-         {
-            HandlerParams params(wheelFocus_, ea, hitUnderMouse_);
-            signals_[wheelFocus_][EVENT_MOUSE_WHEEL_DOWN]->operator()(params);
-            break;
-         }
 
-         default:
-            break; // ignore other events
-      }
+
+   // - EventHandler::setAsyncPicking ------------------------------------------
+   void EventHandler::setAsyncPicking(bool enable)
+   {
+      if (enable && asyncPicker_.get() == 0)
+         asyncPicker_.reset(new AsyncPicker());
+      else if (!enable)
+         asyncPicker_.reset();
    }
 
 
 
-   // - EventHandler::getMouseButton -------------------------------------------
-   EventHandler::MouseButton EventHandler::getMouseButton(
-      const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setPickThreadPool ----------------------------------------
+   void EventHandler::setPickThreadPool(PickThreadPool* pool)
    {
-      switch (ea.getButton())
-      {
-         case osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON:
-            return LEFT_MOUSE_BUTTON;
-         case osgGA::GUIEventAdapter::MIDDLE_MOUSE_BUTTON:
-            return MIDDLE_MOUSE_BUTTON;
-         case osgGA::GUIEventAdapter::RIGHT_MOUSE_BUTTON:
-            return RIGHT_MOUSE_BUTTON;
-         default:
-         {
-            assert(false && "Got an invalid mouse button code. Is 'ea' really "
-                   "a mouse event?");
-            return MOUSE_BUTTON_COUNT; // Can't happen; but makes compiler happy
-         }
-      }
+      pickThreadPool_ = pool;
    }
 
 
 
-   // - EventHandler::updatePickingData ----------------------------------------
-   void EventHandler::updatePickingData(
-      osg::View* view, const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setPickService -------------------------------------------
+   void EventHandler::setPickService(PickService* service)
    {
-      assert(pickerRadius_ >= 0.0 && "Cannot use negative picker radius");
+      pickService_ = service;
+      pickCache_.clear();
+      nextPickCacheEntry_ = 0;
+   }
 
-      if (pickerRadius_ > 0.0)
-         updatePickingDataPolytope(view, ea);
-      else
-         updatePickingDataLine(view, ea);
+
+
+   // - EventHandler::setOverlayPicking ----------------------------------------
+   void EventHandler::setOverlayPicking(bool enable, bool testGeometry)
+   {
+      overlayPicking_ = enable;
+      overlayGeometry_ = testGeometry;
+      pickCache_.clear();
+      nextPickCacheEntry_ = 0;
+      pickDirty_ = true;
    }
 
 
 
-   // - EventHandler::updatePickingDataLine ------------------------------------
-   void EventHandler::updatePickingDataLine(
-      osg::View* view, const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::setPickLODScale ------------------------------------------
+   void EventHandler::setPickLODScale(float scale)
    {
-      const osg::Viewport* vp = view->getCamera()->getViewport();
+      assert(scale > 0.0f && "Pick LOD scale must be positive");
+
+      pickLODScale_ = scale;
+      hoverTraversal_.setLODScale(scale);
+      overlayIndex_.invalidate();
+      pickCache_.clear();
+      nextPickCacheEntry_ = 0;
+      pickDirty_ = true;
+   }
 
-      const float x = vp->x() + static_cast<int>(
-         vp->width() * (ea.getXnormalized() * 0.5f + 0.5f));
-      const float y = vp->y() + static_cast<int>(
-         vp->height() * (ea.getYnormalized() * 0.5f + 0.5f));
 
-      NodePtr currentNodeUnderMouse;
-      osg::Vec3 currentPositionUnderMouse;
 
-      typedef NodeMasks_t::const_iterator iter_t;
-      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
-      {
-         osg::ref_ptr<osgUtil::LineSegmentIntersector> picker(
-            new osgUtil::LineSegmentIntersector(
-               osgUtil::Intersector::WINDOW, x, y));
+   // - EventHandler::addPointerSource -----------------------------------------
+   PointerId EventHandler::addPointerSource(PointerSourcePtr source)
+   {
+      assert(source && "Cannot add a NULL pointer source");
 
-         osgUtil::IntersectionVisitor iv(picker);
-         iv.setTraversalMask(*p);
+      const PointerId id = nextPointerId_++;
 
-         view->getCamera()->accept(iv);
+      PointerSourceEntry& entry = pointerSources_[id];
+      entry.source = source;
+      entry.state = PointerState(id);
 
-         const osgUtil::LineSegmentIntersector::Intersections& hitList =
-            picker->getIntersections();
+      return id;
+   }
 
-         if (hitList.size() > 0)
-         {
-            typedef
-               osgUtil::LineSegmentIntersector::Intersections::const_iterator
-               iter_t;
 
-            iter_t theHit = hitList.end();
 
-            if (ignoreBackFaces_ && hitList.size() >= 2)
+   // - EventHandler::removePointerSource --------------------------------------
+   void EventHandler::removePointerSource(PointerId id)
+   {
+      PointerSources_t::iterator p = pointerSources_.find(id);
+
+      if (p == pointerSources_.end())
+         return;
+
+      // Actually removed in the next frame, after "MouseLeave" is generated
+      p->second.source.reset();
+   }
+
+
+
+   // - EventHandler::setDragConstraint ----------------------------------------
+   void EventHandler::setDragConstraint(DragConstraint constraint,
+                                        const osg::Vec3d& direction)
+   {
+      assert((direction.length2() > 0.0
+              || (constraint != DRAG_ON_PLANE
+                  && constraint != DRAG_ALONG_AXIS))
+             && "Drag constraint direction cannot be null");
+
+      dragConstraint_ = constraint;
+      dragConstraintDirection_ = direction;
+   }
+
+
+
+   // - EventHandler::setDropTargetProbeRate -----------------------------------
+   void EventHandler::setDropTargetProbeRate(double probesPerSecond)
+   {
+      assert(probesPerSecond >= 0.0 && "Probing rate cannot be negative");
+      dropProbeRate_ = probesPerSecond;
+   }
+
+
+
+   // - EventHandler::setDragThreshold -----------------------------------------
+   void EventHandler::setDragThreshold(float pixels)
+   {
+      assert(pixels >= 0.0f && "Drag threshold cannot be negative");
+      dragThreshold_ = pixels;
+   }
+
+
+
+   // - EventHandler::setDoubleClickInterval -----------------------------------
+   void EventHandler::setDoubleClickInterval(double seconds)
+   {
+      assert(seconds > 0.0 && "Double-click interval must be positive");
+      doubleClickInterval_ = seconds;
+   }
+
+
+
+   // - EventHandler::setRegionSelection ---------------------------------------
+   void EventHandler::setRegionSelection(RegionSelectionMode mode,
+                                         unsigned button, unsigned modKeyMask)
+   {
+      regionSelectionMode_ = mode;
+      regionSelectionButton_ = button;
+      regionSelectionModKeyMask_ = modKeyMask;
+      regionDragging_ = false;
+   }
+
+
+
+   // - EventHandler::getSelection ---------------------------------------------
+   void EventHandler::getSelection(Nodes_t& selection) const
+   {
+      regionSelector_.getSelection(selection);
+   }
+
+
+
+   // - EventHandler::clearSelection -------------------------------------------
+   void EventHandler::clearSelection()
+   {
+      regionDragging_ = false;
+
+      SelectionParams params;
+      regionSelector_.clear(params.removed);
+
+      if (!params.removed.empty())
+         selectionChangedSignal_(params);
+   }
+
+
+
+   // - EventHandler::addGesture -----------------------------------------------
+   EventHandler::SignalPtr EventHandler::addGesture(const NodePtr node,
+                                                    const Gesture& gesture)
+   {
+      if (signals_.find(node) == signals_.end())
+      {
+         throw std::runtime_error(
+            ("Trying to add a gesture to an unknown node: '" + node->getName()
+             + "' (" + boost::lexical_cast<std::string>(node) + ").").c_str());
+      }
+
+      GestureEntry entry;
+      entry.node = node;
+      entry.gesture = gesture;
+      entry.signal = SignalPtr(new Signal_t());
+      entry.clicks = 0;
+      entry.lastClickSerial = 0;
+      entry.timeOfLastClick = -1.0;
+      entry.due = 0.0;
+      entry.tracked = false;
+      entry.enabled = true;
+      entry.recognized = false;
+
+      gesturesByNode_[node].push_back(gestures_.size());
+      gestures_.push_back(entry);
+
+      return entry.signal;
+   }
+
+
+
+   // - EventHandler::setHoverDwell --------------------------------------------
+   void EventHandler::setHoverDwell(double delay, float tolerance)
+   {
+      assert(delay >= 0.0 && "Cannot use negative hover dwell time");
+      assert(tolerance >= 0.0f && "Cannot use negative hover dwell tolerance");
+
+      if (hoverDwellGesture_ == NO_GESTURE)
+      {
+         if (delay == 0.0)
+            return;
+
+         // Not in gesturesByNode_: it is for whatever node is under the
+         // pointer
+         GestureEntry entry;
+         entry.clicks = 0;
+         entry.lastClickSerial = 0;
+         entry.timeOfLastClick = -1.0;
+         entry.due = 0.0;
+         entry.tracked = false;
+         entry.recognized = false;
+
+         hoverDwellGesture_ = gestures_.size();
+         gestures_.push_back(entry);
+      }
+
+      // A dwell in progress is canceled in the next frame if disabling
+      GestureEntry& entry = gestures_[hoverDwellGesture_];
+      entry.gesture = Gesture::hoverDwell(delay, tolerance);
+      entry.enabled = delay > 0.0;
+   }
+
+
+
+   // - EventHandler::setHoverHysteresis ---------------------------------------
+   void EventHandler::setHoverHysteresis(float pixels, unsigned frames,
+                                         double depthTieTolerance)
+   {
+      assert(pixels >= 0.0f && "Cannot use negative hysteresis distance");
+      assert(depthTieTolerance >= 0.0
+             && "Cannot use negative depth tie tolerance");
+
+      hysteresisPixels_ = pixels;
+      hysteresisFrames_ = frames;
+      depthTieTolerance_ = depthTieTolerance;
+
+      hysteresisCandidate_ = NodePtr();
+      hysteresisCount_ = 0;
+   }
+
+
+
+   // - EventHandler::setPickBudget --------------------------------------------
+   void EventHandler::setPickBudget(double seconds)
+   {
+      assert(seconds >= 0.0 && "Cannot use negative picking budget");
+      pickBudget_ = seconds;
+   }
+
+
+
+   // - EventHandler::PointerState::PointerState -------------------------------
+   EventHandler::PointerState::PointerState(PointerId theId)
+      : id(theId), buttonMask(0)
+   {
+      for (int i = 0; i < MOUSE_BUTTON_COUNT; ++i)
+         timeOfLastClick[i] = -1.0;
+   }
+
+
+
+   // - EventHandler::DragState::DragState -------------------------------------
+   EventHandler::DragState::DragState()
+      : pending(false), active(false), button(LEFT_MOUSE_BUTTON),
+        alongAxis(false), timeOfLastProbe(-1.0)
+   { }
+
+
+
+   // - EventHandler::getObservedNode ------------------------------------------
+   NodePtr EventHandler::getObservedNode(const osg::NodePath& nodePath)
+   {
+      typedef osg::NodePath::const_reverse_iterator iter_t;
+      for (iter_t p = nodePath.rbegin(); p != nodePath.rend(); ++p)
+      {
+         if (signals_.find(NodePtr(*p)) != signals_.end())
+            return NodePtr(*p);
+      }
+
+      return NodePtr();
+   }
+
+
+
+   // - EventHandler::getRegisteredNodes ---------------------------------------
+   void EventHandler::getRegisteredNodes(Nodes_t& nodes) const
+   {
+      nodes.clear();
+      nodes.reserve(signals_.size());
+
+      typedef SignalsMap_t::const_iterator iter_t;
+      for (iter_t p = signals_.begin(); p != signals_.end(); ++p)
+      {
+         if (p->first.valid())
+            nodes.push_back(p->first);
+      }
+   }
+
+
+
+   // - EventHandler::handleFrameEvent -----------------------------------------
+   void EventHandler::handleFrameEvent(osg::View* view,
+                                       const osgGA::GUIEventAdapter& ea)
+   {
+      assert(pickingMasks_.size() > 0);
+
+      // Checking whether overlay nodes moved is too costly to do at every
+      // pick, so it is done once per frame, before any picking
+      if (overlayPicking_)
+         overlayIndex_.invalidateIfMoved();
+
+      // With several views, the pointers are handled only in the frames of
+      // the view the mouse pointer is in
+      if (mouseView_ == 0 || mouseView_ == view)
+      {
+         if (drag_.active)
+         {
+            // The dragged node captures the mouse pointer, so there is no
+            // need to pick (and no enter or leave events for other nodes)
+            mouse_.prevNode = mouse_.node;
+            mouse_.prevPosition = mouse_.position;
+            handleDragFrame(view, ea);
+         }
+         else if (updatePickingData(view, ea))
+         {
+            triggerHoverEvents(mouse_, ea);
+         }
+         else
+         {
+            // No new picking results; so, no events to trigger.
+            mouse_.prevNode = mouse_.node;
+            mouse_.prevPosition = mouse_.position;
+         }
+
+         if (!pointerSources_.empty())
+            handlePointerSources(view, ea);
+
+         if (!touchContacts_.empty())
+            handleTouchContacts(view, ea);
+
+         if (regionDragging_ && regionChanged_)
+            updateRegionSelection(view);
+
+         if (!gestures_.empty())
+            recognizeFrameGestures(view, ea);
+      }
+
+      if (scrollPending_)
+         flushScroll(ea);
+   }
+
+
+
+   // - EventHandler::triggerHoverEvents ---------------------------------------
+   void EventHandler::triggerHoverEvents(const PointerState& pointer,
+                                         const osgGA::GUIEventAdapter& ea)
+   {
+      if (pointer.node == pointer.prevNode)
+      {
+         if (pointer.prevNode.valid()
+             && pointer.position != pointer.prevPosition)
+         {
+            HandlerParams params(pointer.node, ea, pointer.hit, pointer.id);
+            triggerSignal(signals_[pointer.node][EVENT_MOUSE_MOVE], params);
+         }
+      }
+      else // pointer.node != pointer.prevNode
+      {
+         if (pointer.prevNode.valid())
+         {
+            HandlerParams params(pointer.prevNode, ea, pointer.hit,
+                                 pointer.id);
+            triggerSignal(signals_[pointer.prevNode][EVENT_MOUSE_LEAVE],
+                          params);
+         }
+
+         if (pointer.node.valid())
+         {
+            HandlerParams params(pointer.node, ea, pointer.hit, pointer.id);
+            triggerSignal(signals_[pointer.node][EVENT_MOUSE_ENTER], params);
+         }
+      }
+   }
+
+
+
+   // - EventHandler::handlePointerSources -------------------------------------
+   void EventHandler::handlePointerSources(osg::View* view,
+                                           const osgGA::GUIEventAdapter& ea)
+   {
+      // Collect the segments of the active pointers, and pick them together
+      BatchPickTraversal::Segments_t segments;
+      std::vector<PointerSourceEntry*> pointing;
+
+      typedef PointerSources_t::iterator iter_t;
+      for (iter_t p = pointerSources_.begin(); p != pointerSources_.end(); ++p)
+      {
+         BatchPickTraversal::Segment segment;
+         if (p->second.source
+             && p->second.source->getSegment(view, ea, segment))
+         {
+            segments.push_back(segment);
+            pointing.push_back(&p->second);
+         }
+      }
+
+      std::vector<PickResult> picks;
+      if (!segments.empty())
+         pickBatch(view, segments, picks);
+
+      std::size_t nextPick = 0;
+
+      for (iter_t p = pointerSources_.begin(); p != pointerSources_.end(); )
+      {
+         PointerSourceEntry& entry = p->second;
+
+         PickResult pick;
+         if (nextPick < pointing.size() && pointing[nextPick] == &entry)
+            pick = picks[nextPick++];
+
+         setPointerPick(entry.state, pick);
+         triggerHoverEvents(entry.state, ea);
+
+         // Removed sources were kept just to generate a last "MouseLeave"
+         if (!entry.source)
+         {
+            pointerSources_.erase(p++);
+            continue;
+         }
+
+         // Button presses and releases
+         const unsigned buttonMask = entry.source->getButtonMask();
+         const unsigned buttonMasks[MOUSE_BUTTON_COUNT] = {
+            osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON,
+            osgGA::GUIEventAdapter::MIDDLE_MOUSE_BUTTON,
+            osgGA::GUIEventAdapter::RIGHT_MOUSE_BUTTON };
+
+         for (int i = 0; i < MOUSE_BUTTON_COUNT; ++i)
+         {
+            const bool wasDown = (entry.state.buttonMask & buttonMasks[i]) != 0;
+            const bool isDown = (buttonMask & buttonMasks[i]) != 0;
+
+            if (isDown && !wasDown)
+            {
+               handlePushEvent(entry.state, static_cast<MouseButton>(i), ea,
+                               pick);
+            }
+            else if (!isDown && wasDown)
+            {
+               handleReleaseEvent(entry.state, static_cast<MouseButton>(i),
+                                  ea, pick);
+            }
+         }
+
+         entry.state.buttonMask = buttonMask;
+
+         ++p;
+      }
+   }
+
+
+
+   // - EventHandler::handleTouchEvent -----------------------------------------
+   void EventHandler::handleTouchEvent(const osgGA::GUIEventAdapter& ea)
+   {
+#     ifdef OSGUISH_HAVE_MULTI_TOUCH
+      const osgGA::GUIEventAdapter::TouchData* touchData = ea.getTouchData();
+
+      typedef osgGA::GUIEventAdapter::TouchData::const_iterator iter_t;
+      for (iter_t p = touchData->begin(); p != touchData->end(); ++p)
+      {
+         if (p->phase == osgGA::GUIEventAdapter::TOUCH_UNKNOWN)
+            continue;
+
+         TouchContacts_t::iterator contactIter = touchContacts_.find(p->id);
+
+         if (contactIter == touchContacts_.end())
+         {
+            TouchContact contact;
+            contact.state = PointerState(nextPointerId_++);
+            contact.began = true;
+
+            // Keep the click history, so that double taps are recognized
+            for (int i = 0; i < MOUSE_BUTTON_COUNT; ++i)
+            {
+               PointerState& state = contact.state;
+               state.nodeThatGotClick[i] = lastTouch_.nodeThatGotClick[i];
+               state.timeOfLastClick[i] = lastTouch_.timeOfLastClick[i];
+            }
+
+            contactIter = touchContacts_.insert(
+               std::make_pair(p->id, contact)).first;
+         }
+
+         // Same normalization done by GUIEventAdapter::getXnormalized() and
+         // getYnormalized()
+         TouchContact& contact = contactIter->second;
+
+         contact.xNormalized =
+            2.0f * (p->x - ea.getXmin()) / (ea.getXmax() - ea.getXmin()) - 1.0f;
+         contact.yNormalized =
+            2.0f * (p->y - ea.getYmin()) / (ea.getYmax() - ea.getYmin()) - 1.0f;
+
+         if (ea.getMouseYOrientation()
+             == osgGA::GUIEventAdapter::Y_INCREASING_DOWNWARDS)
+         {
+            contact.yNormalized = -contact.yNormalized;
+         }
+
+         if (p->phase == osgGA::GUIEventAdapter::TOUCH_ENDED)
+            contact.ended = true;
+      }
+#     endif // OSGUISH_HAVE_MULTI_TOUCH
+   }
+
+
+
+   // - EventHandler::handleTouchContacts --------------------------------------
+   void EventHandler::handleTouchContacts(osg::View* view,
+                                          const osgGA::GUIEventAdapter& ea)
+   {
+      // Pick all contacts together
+      std::vector<osg::Vec2> points;
+      points.reserve(touchContacts_.size());
+
+      typedef TouchContacts_t::iterator iter_t;
+      for (iter_t p = touchContacts_.begin(); p != touchContacts_.end(); ++p)
+      {
+         float x, y;
+         getWindowCoords(view, p->second.xNormalized, p->second.yNormalized,
+                         x, y);
+         points.push_back(osg::Vec2(x, y));
+      }
+
+      std::vector<PickResult> picks;
+      pickBatch(view, points, picks);
+
+      // Trigger the events
+      std::size_t i = 0;
+      for (iter_t p = touchContacts_.begin(); p != touchContacts_.end(); ++i)
+      {
+         TouchContact& contact = p->second;
+
+         setPointerPick(contact.state, picks[i]);
+         triggerHoverEvents(contact.state, ea);
+
+         if (contact.began)
+         {
+            handlePushEvent(contact.state, LEFT_MOUSE_BUTTON, ea, picks[i]);
+            contact.began = false;
+         }
+
+         if (contact.ended)
+         {
+            handleReleaseEvent(contact.state, LEFT_MOUSE_BUTTON, ea, picks[i]);
+
+            // The finger is no longer over anything
+            setPointerPick(contact.state, PickResult());
+            triggerHoverEvents(contact.state, ea);
+
+            lastTouch_ = contact.state;
+            touchContacts_.erase(p++);
+            continue;
+         }
+
+         ++p;
+      }
+   }
+
+
+
+   // - EventHandler::beginRegionDrag ------------------------------------------
+   void EventHandler::beginRegionDrag(osg::View* view,
+                                      const osgGA::GUIEventAdapter& ea)
+   {
+      // A new drag starts a new selection
+      clearSelection();
+
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+
+      // For a rectangle, both corners start at the press position
+      regionPoints_.assign(
+         regionSelectionMode_ == REGION_SELECTION_RECTANGLE ? 2 : 1,
+         osg::Vec2(x, y));
+
+      regionDragging_ = true;
+      regionChanged_ = true;
+      regionCandidatesDirty_ = true;
+   }
+
+
+
+   // - EventHandler::extendRegionDrag -----------------------------------------
+   void EventHandler::extendRegionDrag(osg::View* view,
+                                       const osgGA::GUIEventAdapter& ea)
+   {
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+      const osg::Vec2 point(x, y);
+
+      if (regionSelectionMode_ == REGION_SELECTION_RECTANGLE)
+      {
+         if (regionPoints_[1] == point)
+            return;
+
+         regionPoints_[1] = point;
+      }
+      else
+      {
+         // Getting a lasso vertex for every pixel is just a waste
+         const float MIN_LASSO_STEP = 3.0f;
+         if ((regionPoints_.back() - point).length() < MIN_LASSO_STEP)
+            return;
+
+         regionPoints_.push_back(point);
+      }
+
+      regionChanged_ = true;
+   }
+
+
+
+   // - EventHandler::updateRegionSelection ------------------------------------
+   void EventHandler::updateRegionSelection(osg::View* view)
+   {
+      SelectionParams params;
+
+      if (regionCandidatesDirty_)
+      {
+         captureRegionCandidates(view, params.removed);
+         regionCandidatesDirty_ = false;
+      }
+
+      Nodes_t added;
+      Nodes_t removed;
+
+      if (regionSelectionMode_ == REGION_SELECTION_RECTANGLE)
+      {
+         regionSelector_.selectRectangle(regionPoints_[0], regionPoints_[1],
+                                         added, removed);
+      }
+      else
+      {
+         regionSelector_.selectLasso(regionPoints_, added, removed);
+      }
+
+      regionChanged_ = false;
+
+      params.added.swap(added);
+      params.removed.insert(params.removed.end(),
+                            removed.begin(), removed.end());
+
+      if (!params.added.empty() || !params.removed.empty())
+         selectionChangedSignal_(params);
+   }
+
+
+
+   // - EventHandler::captureRegionCandidates ----------------------------------
+   void EventHandler::captureRegionCandidates(osg::View* view,
+                                              Nodes_t& removed)
+   {
+      Nodes_t nodes;
+      getRegisteredNodes(nodes);
+
+      osg::Node::NodeMask mask = 0;
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+         mask |= *p;
+
+      regionSelector_.setCandidates(view->getCamera(), nodes, mask, removed);
+   }
+
+
+
+   // - EventHandler::beginDrag ------------------------------------------------
+   void EventHandler::beginDrag(osg::View* view,
+                                const osgGA::GUIEventAdapter& ea)
+   {
+      drag_.pending = false;
+      drag_.active = true;
+
+      // Releasing the button after dragging is not a click
+      mouse_.nodeThatGotMouseDown[drag_.button] = NodePtr();
+
+      // Find the spaces of the picked node, as seen when it was picked
+      const Intersection_t& hit = drag_.pick.hit;
+      PickTraversal::Root root;
+      osg::Matrixd toWindow;
+      osg::Matrixd localToWorld;
+
+      if (PickTraversal::makeRoot(hit.nodePath, root, pickLODScale_))
+      {
+         toWindow = root.view * root.projection * root.window;
+         localToWorld = root.model;
+      }
+      else
+      {
+         const osg::Camera* camera = view->getCamera();
+         toWindow = camera->getViewMatrix() * camera->getProjectionMatrix();
+         if (camera->getViewport() != 0)
+            toWindow = toWindow * camera->getViewport()->computeWindowMatrix();
+         localToWorld = osg::computeLocalToWorld(hit.nodePath);
+      }
+
+      drag_.fromWindow.invert(toWindow);
+      drag_.worldToLocal.invert(localToWorld);
+
+      // Place the constraint at the picked point
+      drag_.origin = hit.worldIntersectionPoint;
+      drag_.alongAxis = dragConstraint_ == DRAG_ALONG_AXIS;
+
+      switch (dragConstraint_)
+      {
+         case DRAG_ON_SURFACE_PLANE:
+            drag_.direction = hit.worldIntersectionNormal;
+            break;
+
+         case DRAG_ON_PLANE:
+         case DRAG_ALONG_AXIS:
+            drag_.direction = dragConstraintDirection_;
+            break;
+
+         default:
+            drag_.direction = osg::Vec3d();
+            break;
+      }
+
+      if (drag_.direction.length2() == 0.0)
+      {
+         // Perpendicular to the picking ray
+         const float x = drag_.pressPosition.x();
+         const float y = drag_.pressPosition.y();
+         drag_.direction = osg::Vec3d(x, y, 1.0) * drag_.fromWindow
+            - osg::Vec3d(x, y, 0.0) * drag_.fromWindow;
+      }
+
+      drag_.direction.normalize();
+
+      drag_.lastPosition = drag_.pressPosition;
+      drag_.dropTarget = NodePtr();
+      drag_.timeOfLastProbe = -1.0;
+
+      triggerDragEvent(drag_.pick.node, EVENT_DRAG_START, ea);
+   }
+
+
+
+   // - EventHandler::handleDragFrame ------------------------------------------
+   void EventHandler::handleDragFrame(osg::View* view,
+                                      const osgGA::GUIEventAdapter& ea)
+   {
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+      const osg::Vec2 position(x, y);
+
+      if (dropProbeRate_ > 0.0
+          && (drag_.timeOfLastProbe < 0.0
+              || ea.getTime() - drag_.timeOfLastProbe >= 1.0 / dropProbeRate_))
+      {
+         drag_.dropTarget = probeDropTarget(view, x, y);
+         drag_.timeOfLastProbe = ea.getTime();
+      }
+
+      if (position != drag_.lastPosition && projectOnDragConstraint(x, y))
+      {
+         drag_.lastPosition = position;
+         triggerDragEvent(drag_.pick.node, EVENT_DRAG, ea);
+      }
+   }
+
+
+
+   // - EventHandler::endDrag --------------------------------------------------
+   void EventHandler::endDrag(osg::View* view,
+                              const osgGA::GUIEventAdapter& ea)
+   {
+      if (view != 0)
+      {
+         float x, y;
+         getWindowCoords(view, ea, x, y);
+         projectOnDragConstraint(x, y);
+
+         if (dropProbeRate_ > 0.0)
+            drag_.dropTarget = probeDropTarget(view, x, y);
+      }
+
+      drag_.active = false;
+
+      handleReleaseEvent(mouse_, drag_.button, ea, drag_.pick);
+
+      if (drag_.dropTarget.valid())
+         triggerDragEvent(drag_.dropTarget, EVENT_DROP, ea);
+
+      triggerDragEvent(drag_.pick.node, EVENT_DRAG_END, ea);
+
+      drag_.dropTarget = NodePtr();
+   }
+
+
+
+   // - EventHandler::projectOnDragConstraint ----------------------------------
+   bool EventHandler::projectOnDragConstraint(float x, float y)
+   {
+      // Below this, the picking ray is considered parallel to the constraint
+      const double EPSILON = 1e-9;
+
+      const osg::Vec3d start = osg::Vec3d(x, y, 0.0) * drag_.fromWindow;
+      const osg::Vec3d ray = osg::Vec3d(x, y, 1.0) * drag_.fromWindow - start;
+      const osg::Vec3d toOrigin = drag_.origin - start;
+
+      osg::Vec3d point;
+
+      if (drag_.alongAxis)
+      {
+         // The point of the axis closest to the picking ray
+         const double b = drag_.direction * ray;
+         const double c = ray * ray;
+         const double d = drag_.direction * toOrigin;
+         const double e = ray * toOrigin;
+         const double denominator = c - b * b;
+
+         if (denominator <= EPSILON * c)
+            return false;
+
+         point = drag_.origin
+            + drag_.direction * ((b * e - c * d) / denominator);
+      }
+      else
+      {
+         const double denominator = drag_.direction * ray;
+
+         if (std::fabs(denominator) <= EPSILON * ray.length())
+            return false;
+
+         point = start + ray * ((drag_.direction * toOrigin) / denominator);
+      }
+
+      drag_.pick.hit.worldIntersectionPoint = point;
+      drag_.pick.hit.localIntersectionPoint = point * drag_.worldToLocal;
+
+      return true;
+   }
+
+
+
+   // - EventHandler::probeDropTarget ------------------------------------------
+   NodePtr EventHandler::probeDropTarget(osg::View* view, float x, float y)
+   {
+      PickTraversal traversal;
+      traversal.setIgnoredNode(drag_.pick.node.get());
+      traversal.setLODScale(pickLODScale_);
+
+      osg::Camera* camera = PickTraversal::findCamera(view, x, y);
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+      {
+         traversal.start(camera, x, y, *p);
+         traversal.resume();
+
+         PickResult result;
+         if (selectHit(camera, traversal.getHits(), result))
+            return result.node;
+      }
+
+      return NodePtr();
+   }
+
+
+
+   // - EventHandler::triggerDragEvent -----------------------------------------
+   void EventHandler::triggerDragEvent(const NodePtr& node, Event event,
+                                       const osgGA::GUIEventAdapter& ea)
+   {
+      HandlerParams params(node, ea, drag_.pick.hit);
+      params.dragNode = drag_.pick.node;
+      params.dropTarget = drag_.dropTarget;
+      triggerSignal(signals_[node][event], params);
+   }
+
+
+
+   // - EventHandler::isDraggable ----------------------------------------------
+   bool EventHandler::isDraggable(const NodePtr& node) const
+   {
+      const SignalsMap_t::const_iterator signals = signals_.find(node);
+      if (!node.valid() || signals == signals_.end())
+         return false;
+
+      const Event dragEvents[] = {
+         EVENT_DRAG_START, EVENT_DRAG, EVENT_DRAG_END, EVENT_DROP };
+
+      for (std::size_t i = 0; i < sizeof(dragEvents) / sizeof(Event); ++i)
+      {
+         const SignalCollection_t::const_iterator p =
+            signals->second.find(dragEvents[i]);
+
+         if (p != signals->second.end() && !p->second->empty())
+            return true;
+      }
+
+      return false;
+   }
+
+
+
+   // - EventHandler::recognizePressGestures -----------------------------------
+   void EventHandler::recognizePressGestures(osg::View* view,
+                                             const osgGA::GUIEventAdapter& ea,
+                                             const NodePtr& node)
+   {
+      const GestureIndex_t::const_iterator p = gesturesByNode_.find(node);
+      if (p == gesturesByNode_.end() || view == 0)
+         return;
+
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+
+      const std::vector<std::size_t>& indices = p->second;
+      for (std::size_t i = 0; i < indices.size(); ++i)
+      {
+         const Gesture& gesture = gestures_[indices[i]].gesture;
+
+         if ((gesture.kind == Gesture::LONG_PRESS
+              || gesture.kind == Gesture::HOLD_REPEAT)
+             && gesture.button == static_cast<unsigned>(ea.getButton()))
+         {
+            trackGesture(indices[i], osg::Vec2(x, y),
+                         ea.getTime() + gesture.delay);
+         }
+      }
+   }
+
+
+
+   // - EventHandler::recognizeReleaseGestures ---------------------------------
+   void EventHandler::recognizeReleaseGestures(
+      osg::View* view, const osgGA::GUIEventAdapter& ea,
+      const PickResult& click)
+   {
+      const unsigned button = ea.getButton();
+
+      // Releasing the button ends the long-presses and hold-repeats
+      for (std::size_t i = 0; i < trackedGestures_.size(); )
+      {
+         const Gesture& gesture = gestures_[trackedGestures_[i]].gesture;
+
+         if (gesture.kind != Gesture::HOVER_DWELL && gesture.button == button)
+            untrackGesture(trackedGestures_[i]); // removes it from the list
+         else
+            ++i;
+      }
+
+      if (!click.node.valid() || view == 0)
+         return;
+
+      // Count the clicks. A click on any other node (or with any other
+      // button) breaks a sequence of clicks.
+      ++clickSerial_;
+
+      const GestureIndex_t::const_iterator p =
+         gesturesByNode_.find(click.node);
+      if (p == gesturesByNode_.end())
+         return;
+
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+      const osg::Vec2 position(x, y);
+      const double now = ea.getTime();
+
+      // Copy the indices: the signals may add gestures
+      const std::vector<std::size_t> indices = p->second;
+      for (std::size_t i = 0; i < indices.size(); ++i)
+      {
+         GestureEntry& entry = gestures_[indices[i]];
+
+         if (entry.gesture.kind != Gesture::MULTI_CLICK
+             || entry.gesture.button != button)
+         {
+            continue;
+         }
+
+         const double interval = entry.gesture.delay > 0.0
+            ? entry.gesture.delay
+            : doubleClickInterval_;
+
+         if (entry.clicks > 0
+             && (entry.lastClickSerial + 1 != clickSerial_
+                 || now - entry.timeOfLastClick > interval
+                 || (position - entry.anchor).length()
+                    > entry.gesture.tolerance))
+         {
+            entry.clicks = 0;
+         }
+
+         if (entry.clicks == 0)
+            entry.anchor = position;
+
+         ++entry.clicks;
+         entry.lastClickSerial = clickSerial_;
+         entry.timeOfLastClick = now;
+
+         if (entry.clicks == entry.gesture.clickCount)
+         {
+            entry.clicks = 0;
+            triggerGesture(indices[i], ea, click.hit);
+         }
+      }
+   }
+
+
+
+   // - EventHandler::recognizeFrameGestures -----------------------------------
+   void EventHandler::recognizeFrameGestures(osg::View* view,
+                                             const osgGA::GUIEventAdapter& ea)
+   {
+      const double now = ea.getTime();
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+      const osg::Vec2 position(x, y);
+
+      // No dwelling on a dragged node
+      const NodePtr node = drag_.active ? NodePtr() : mouse_.node;
+
+      // Start tracking the hover dwells of the node under the pointer
+      if (node != dwellNode_)
+      {
+         for (std::size_t i = 0; i < trackedGestures_.size(); )
+         {
+            const std::size_t index = trackedGestures_[i];
+
+            if (gestures_[index].gesture.kind == Gesture::HOVER_DWELL)
+            {
+               untrackGesture(index); // removes it from the list
+               endHoverDwell(index, ea);
+            }
+            else
+            {
+               ++i;
+            }
+         }
+
+         dwellNode_ = node;
+
+         const GestureIndex_t::const_iterator p =
+            gesturesByNode_.find(dwellNode_);
+
+         if (p != gesturesByNode_.end())
+         {
+            const std::vector<std::size_t>& indices = p->second;
+            for (std::size_t i = 0; i < indices.size(); ++i)
+            {
+               const Gesture& gesture = gestures_[indices[i]].gesture;
+               if (gesture.kind == Gesture::HOVER_DWELL)
+                  trackGesture(indices[i], position, now + gesture.delay);
+            }
+         }
+      }
+
+      // The hover dwell of setHoverDwell() is for any node
+      if (hoverDwellGesture_ != NO_GESTURE)
+      {
+         const GestureEntry& entry = gestures_[hoverDwellGesture_];
+         const bool dwelling = entry.enabled && dwellNode_.valid();
+
+         if (dwelling && !entry.tracked)
+         {
+            trackGesture(hoverDwellGesture_, position,
+                         now + entry.gesture.delay);
+         }
+         else if (!dwelling && entry.tracked)
+         {
+            untrackGesture(hoverDwellGesture_);
+            endHoverDwell(hoverDwellGesture_, ea);
+         }
+      }
+
+      // Check the pointer motion against the tolerances
+      for (std::size_t i = 0; i < trackedGestures_.size(); )
+      {
+         const std::size_t index = trackedGestures_[i];
+         const Gesture gesture = gestures_[index].gesture;
+
+         if ((position - gestures_[index].anchor).length()
+             <= gesture.tolerance)
+         {
+            ++i;
+         }
+         else if (gesture.kind == Gesture::HOVER_DWELL)
+         {
+            // Moved away; the dwell restarts where the pointer is now
+            endHoverDwell(index, ea);
+            trackGesture(index, position, now + gesture.delay);
+            ++i;
+         }
+         else
+         {
+            untrackGesture(index); // removes it from the list
+         }
+      }
+
+      if (gestureTimers_.empty())
+         return;
+
+      TimerWheel::TimerIds_t expired;
+      gestureTimers_.advance(now, expired);
+
+      for (std::size_t i = 0; i < expired.size(); ++i)
+      {
+         const std::size_t index = expired[i];
+
+         switch (gestures_[index].gesture.kind)
+         {
+            case Gesture::LONG_PRESS:
+               untrackGesture(index);
+               break;
+
+            case Gesture::HOLD_REPEAT:
+            {
+               // Keeps tracked, until the button is released
+               GestureEntry& entry = gestures_[index];
+               entry.due += entry.gesture.repeatInterval;
+               gestureTimers_.schedule(index, entry.due);
+               break;
+            }
+
+            default:
+               // A hover dwell keeps tracked, until the pointer moves away
+               gestures_[index].recognized = true;
+               break;
+         }
+
+         triggerGesture(index, ea, mouse_.hit);
+      }
+   }
+
+
+
+   // - EventHandler::trackGesture ---------------------------------------------
+   void EventHandler::trackGesture(std::size_t index, const osg::Vec2& anchor,
+                                   double due)
+   {
+      GestureEntry& entry = gestures_[index];
+
+      if (!entry.tracked)
+      {
+         trackedGestures_.push_back(index);
+         entry.tracked = true;
+      }
+
+      entry.anchor = anchor;
+      entry.due = due;
+      gestureTimers_.schedule(index, due);
+   }
+
+
+
+   // - EventHandler::untrackGesture -------------------------------------------
+   void EventHandler::untrackGesture(std::size_t index)
+   {
+      GestureEntry& entry = gestures_[index];
+
+      if (!entry.tracked)
+         return;
+
+      std::vector<std::size_t>::iterator p =
+         std::find(trackedGestures_.begin(), trackedGestures_.end(), index);
+
+      assert(p != trackedGestures_.end() && "Tracked gesture not in list");
+
+      *p = trackedGestures_.back();
+      trackedGestures_.pop_back();
+
+      entry.tracked = false;
+      gestureTimers_.cancel(index);
+   }
+
+
+
+   // - EventHandler::triggerGesture -------------------------------------------
+   void EventHandler::triggerGesture(std::size_t index,
+                                     const osgGA::GUIEventAdapter& ea,
+                                     const Intersection_t& hit)
+   {
+      // Copy what is needed: the signal may add gestures. The hover dwell of
+      // setHoverDwell() triggers the signal of the node under the pointer.
+      const bool forAnyNode = !gestures_[index].node.valid();
+      const NodePtr node = forAnyNode ? dwellNode_ : gestures_[index].node;
+      const SignalPtr signal = forAnyNode
+         ? signals_[node][EVENT_HOVER_DWELL]
+         : gestures_[index].signal;
+
+      HandlerParams params(node, ea, hit);
+      triggerSignal(signal, params);
+   }
+
+
+
+   // - EventHandler::endHoverDwell --------------------------------------------
+   void EventHandler::endHoverDwell(std::size_t index,
+                                    const osgGA::GUIEventAdapter& ea)
+   {
+      GestureEntry& entry = gestures_[index];
+
+      const bool wasRecognized = entry.recognized;
+      entry.recognized = false;
+
+      // Only the hover dwell of setHoverDwell() has a cancel event
+      if (wasRecognized && !entry.node.valid())
+      {
+         HandlerParams params(dwellNode_, ea, mouse_.hit);
+         triggerSignal(signals_[dwellNode_][EVENT_HOVER_CANCEL], params);
+      }
+   }
+
+
+
+   // - EventHandler::handlePushEvent ------------------------------------------
+   void EventHandler::handlePushEvent(PointerState& pointer,
+                                      MouseButton button,
+                                      const osgGA::GUIEventAdapter& ea,
+                                      const PickResult& pick)
+   {
+      // Trigger a "MouseDown" signal.
+      if (pick.node.valid())
+      {
+         HandlerParams params(pick.node, ea, pick.hit, pointer.id);
+         triggerSignal(signals_[pick.node][EVENT_MOUSE_DOWN], params);
+      }
+
+      // Do the bookkeeping for "Click" and "DoubleClick"
+      pointer.nodeThatGotMouseDown[button] = pick.node;
+   }
+
+
+
+   // - EventHandler::handleReleaseEvent ---------------------------------------
+   void EventHandler::handleReleaseEvent(PointerState& pointer,
+                                         MouseButton button,
+                                         const osgGA::GUIEventAdapter& ea,
+                                         const PickResult& pick)
+   {
+      if (pick.node.valid())
+      {
+         // First the trivial case: the "MouseUp" event
+         HandlerParams params(pick.node, ea, pick.hit, pointer.id);
+         triggerSignal(signals_[pick.node][EVENT_MOUSE_UP], params);
+
+         // Now, the trickier ones: "Click" and "DoubleClick"
+         if (pick.node == pointer.nodeThatGotMouseDown[button])
+         {
+            HandlerParams params(pick.node, ea, pick.hit, pointer.id);
+            triggerSignal(signals_[pick.node][EVENT_CLICK], params);
+
+            const double now = ea.getTime();
+
+            if (now - pointer.timeOfLastClick[button] < doubleClickInterval_
+                && pick.node == pointer.nodeThatGotClick[button])
+            {
+               HandlerParams params(pick.node, ea, pick.hit, pointer.id);
+               triggerSignal(signals_[pick.node][EVENT_DOUBLE_CLICK], params);
+            }
+
+            pointer.nodeThatGotClick[button] = pick.node;
+            pointer.timeOfLastClick[button] = now;
+         }
+      }
+   }
+
+
+
+   // - EventHandler::handleKeyDownEvent ---------------------------------------
+   void EventHandler::handleKeyDownEvent(const osgGA::GUIEventAdapter& ea)
+   {
+      HandlerParams params(kbdFocus_, ea, mouse_.hit);
+      triggerSignal(signals_[kbdFocus_][EVENT_KEY_DOWN], params);
+
+      if (numKeySignals_ > 0)
+         triggerKeySignal(EVENT_KEY_DOWN, ea);
+   }
+
+
+
+   // - EventHandler::handleKeyUpEvent -----------------------------------------
+   void EventHandler::handleKeyUpEvent(const osgGA::GUIEventAdapter& ea)
+   {
+      HandlerParams params(kbdFocus_, ea, mouse_.hit);
+      triggerSignal(signals_[kbdFocus_][EVENT_KEY_UP], params);
+
+      if (numKeySignals_ > 0)
+         triggerKeySignal(EVENT_KEY_UP, ea);
+   }
+
+
+
+   // - EventHandler::normalizeModKeyMask --------------------------------------
+   unsigned EventHandler::normalizeModKeyMask(unsigned modKeyMask)
+   {
+      typedef osgGA::GUIEventAdapter GUIEA;
+
+      const unsigned modifiers[] = {
+         GUIEA::MODKEY_SHIFT, GUIEA::MODKEY_CTRL, GUIEA::MODKEY_ALT,
+         GUIEA::MODKEY_META };
+
+      unsigned normalized = 0;
+      for (std::size_t i = 0; i < sizeof(modifiers) / sizeof(*modifiers); ++i)
+      {
+         if ((modKeyMask & modifiers[i]) != 0)
+            normalized |= modifiers[i];
+      }
+
+      return normalized;
+   }
+
+
+
+   // - EventHandler::normalizeKey ---------------------------------------------
+   int EventHandler::normalizeKey(int key)
+   {
+      if (key >= 'A' && key <= 'Z')
+         return key - 'A' + 'a';
+
+      return key;
+   }
+
+
+
+   // - EventHandler::findKeySignal --------------------------------------------
+   std::size_t EventHandler::findKeySignal(const osg::Node* node, int key,
+                                           unsigned modKeyMask,
+                                           Event event) const
+   {
+      assert(!keySignals_.empty());
+
+      // Nodes are at least 8-byte aligned, so their lowest bits carry no
+      // information
+      std::size_t hash = reinterpret_cast<std::size_t>(node) >> 3;
+      hash = hash * 31 + static_cast<unsigned>(key);
+      hash = hash * 31 + modKeyMask;
+      hash = hash * 31 + event;
+      hash ^= hash >> 16;
+
+      const std::size_t mask = keySignals_.size() - 1;
+
+      for (std::size_t i = hash & mask; ; i = (i + 1) & mask)
+      {
+         const KeySignalEntry& entry = keySignals_[i];
+
+         if (!entry.signal
+             || (entry.node.get() == node && entry.key == key
+                 && entry.modKeyMask == modKeyMask && entry.event == event))
+         {
+            return i;
+         }
+      }
+   }
+
+
+
+   // - EventHandler::triggerKeySignal -----------------------------------------
+   void EventHandler::triggerKeySignal(Event event,
+                                       const osgGA::GUIEventAdapter& ea)
+   {
+      const KeySignalEntry& entry =
+         keySignals_[findKeySignal(kbdFocus_.get(), normalizeKey(ea.getKey()),
+                                   normalizeModKeyMask(ea.getModKeyMask()),
+                                   event)];
+
+      if (!entry.signal)
+         return;
+
+      // The entry may move if the signal adds key signals
+      const SignalPtr signal = entry.signal;
+      HandlerParams params(kbdFocus_, ea, mouse_.hit);
+      triggerSignal(signal, params);
+   }
+
+
+
+   // - EventHandler::navigateFocus --------------------------------------------
+   void EventHandler::navigateFocus(osg::View* view,
+                                    const osgGA::GUIEventAdapter& ea)
+   {
+      const int* const keysBegin = navigationKeys_;
+      const int* const keysEnd = navigationKeys_ + 4;
+      const int* key = std::find(keysBegin, keysEnd, ea.getKey());
+
+      if (key == keysEnd)
+         return;
+
+      osg::Camera* camera = view->getCamera();
+
+      if (focusNavigator_.needsRebuild(camera))
+      {
+         Nodes_t nodes;
+         getRegisteredNodes(nodes);
+
+         focusNavigator_.rebuild(camera, nodes);
+      }
+
+      const NodePtr neighbor = focusNavigator_.findNeighbor(
+         kbdFocus_,
+         static_cast<FocusNavigator::Direction>(key - keysBegin));
+
+      if (neighbor.valid())
+      {
+         moveFocus(KEYBOARD_FOCUS, neighbor, ea);
+         eventConsumed_ = true;
+      }
+   }
+
+
+
+   // - EventHandler::traverseFocusChain ---------------------------------------
+   void EventHandler::traverseFocusChain(osg::View* view,
+                                         const osgGA::GUIEventAdapter& ea)
+   {
+      if (ea.getKey() != osgGA::GUIEventAdapter::KEY_Tab)
+         return;
+
+      osg::Camera* camera = view->getCamera();
+
+      if (focusChain_.needsRebuild(camera))
+      {
+         Nodes_t nodes;
+         getRegisteredNodes(nodes);
+
+         focusChain_.rebuild(camera, nodes);
+      }
+
+      const NodePtr node =
+         (ea.getModKeyMask() & osgGA::GUIEventAdapter::MODKEY_SHIFT)
+         ? focusChain_.getPrevious(kbdFocus_)
+         : focusChain_.getNext(kbdFocus_);
+
+      if (node.valid())
+      {
+         moveFocus(KEYBOARD_FOCUS, node, ea);
+         eventConsumed_ = true;
+      }
+   }
+
+
+
+   // - EventHandler::triggerSignal --------------------------------------------
+   void EventHandler::triggerSignal(const SignalPtr& signal,
+                                    HandlerParams& params)
+   {
+      signal->operator()(params);
+      eventConsumed_ = eventConsumed_ || params.consumed;
+   }
+
+
+
+   // - EventHandler::getHandleReturnValue -------------------------------------
+   bool EventHandler::getHandleReturnValue(
+      osgGA::GUIEventAdapter::EventType eventType) const
+   {
+      switch (handleReturnValues_[GetEventTypeIndex(eventType)])
+      {
+         case RETURN_TRUE:
+            return true;
+
+         case RETURN_IF_CONSUMED:
+            return eventConsumed_;
+
+         default:
+            return false;
+      }
+   }
+
+
+
+   // - EventHandler::moveFocus ------------------------------------------------
+   void EventHandler::moveFocus(FocusKind kind, const NodePtr& node,
+                                const osgGA::GUIEventAdapter& ea,
+                                bool remember)
+   {
+      NodePtr& focus = kind == KEYBOARD_FOCUS ? kbdFocus_ : wheelFocus_;
+
+      if (node == focus)
+         return;
+
+      const NodePtr oldFocus = focus;
+      focus = node;
+
+      FocusHistory& history = focusHistories_[kind];
+      const std::size_t capacity = history.nodes.size();
+
+      if (remember && oldFocus.valid() && capacity > 0)
+      {
+         history.newest = (history.newest + 1) % capacity;
+         history.nodes[history.newest] = oldFocus;
+         history.count = std::min(history.count + 1, capacity);
+      }
+
+      const Event outEvent =
+         kind == KEYBOARD_FOCUS ? EVENT_FOCUS_OUT : EVENT_WHEEL_FOCUS_OUT;
+      const Event inEvent =
+         kind == KEYBOARD_FOCUS ? EVENT_FOCUS_IN : EVENT_WHEEL_FOCUS_IN;
+
+      HandlerParams outParams(oldFocus, ea, mouse_.hit);
+      triggerSignal(signals_[oldFocus][outEvent], outParams);
+
+      HandlerParams inParams(node, ea, mouse_.hit);
+      triggerSignal(signals_[node][inEvent], inParams);
+   }
+
+
+
+   // - EventHandler::handleScrollEvent ----------------------------------------
+   void EventHandler::handleScrollEvent(const osgGA::GUIEventAdapter& ea,
+                                        const PickResult& pick)
+   {
+      switch (ea.getScrollingMotion())
+      {
+         case osgGA::GUIEventAdapter::SCROLL_UP:
+         {
+            HandlerParams params(wheelFocus_, ea, pick.hit);
+            triggerSignal(signals_[wheelFocus_][EVENT_MOUSE_WHEEL_UP], params);
+            accumulateScroll(ea, osg::Vec2(0.0f, 1.0f), pick.hit);
+            break;
+         }
+
+         case osgGA::GUIEventAdapter::SCROLL_DOWN:
+         {
+            HandlerParams params(wheelFocus_, ea, pick.hit);
+            triggerSignal(signals_[wheelFocus_][EVENT_MOUSE_WHEEL_DOWN],
+                          params);
+            accumulateScroll(ea, osg::Vec2(0.0f, -1.0f), pick.hit);
+            break;
+         }
+
+         case osgGA::GUIEventAdapter::SCROLL_LEFT:
+            accumulateScroll(ea, osg::Vec2(-1.0f, 0.0f), pick.hit);
+            break;
+
+         case osgGA::GUIEventAdapter::SCROLL_RIGHT:
+            accumulateScroll(ea, osg::Vec2(1.0f, 0.0f), pick.hit);
+            break;
+
+         case osgGA::GUIEventAdapter::SCROLL_2D:
+            accumulateScroll(ea, osg::Vec2(ea.getScrollingDeltaX(),
+                                           ea.getScrollingDeltaY()),
+                             pick.hit);
+            break;
+
+         default:
+            break; // ignore other events
+      }
+   }
+
+
+
+   // - EventHandler::accumulateScroll -----------------------------------------
+   void EventHandler::accumulateScroll(const osgGA::GUIEventAdapter& ea,
+                                       const osg::Vec2& delta,
+                                       const Intersection_t& hit)
+   {
+      if (scrollPending_ && scrollNode_ != wheelFocus_)
+         flushScroll(ea);
+
+      scrollPending_ = true;
+      scrollNode_ = wheelFocus_;
+      scrollDelta_ += delta;
+      scrollHit_ = hit;
+   }
+
+
+
+   // - EventHandler::flushScroll ----------------------------------------------
+   void EventHandler::flushScroll(const osgGA::GUIEventAdapter& ea)
+   {
+      // Reset before triggering, in case the handlers cause more scrolling
+      const NodePtr node = scrollNode_;
+      const osg::Vec2 delta = scrollDelta_;
+
+      scrollPending_ = false;
+      scrollNode_ = NodePtr();
+      scrollDelta_ = osg::Vec2();
+
+      HandlerParams params(node, ea, scrollHit_);
+      params.scrollDelta = delta;
+      triggerSignal(signals_[node][EVENT_SCROLL], params);
+   }
+
+
+
+   // - EventHandler::getMouseButton -------------------------------------------
+   EventHandler::MouseButton EventHandler::getMouseButton(
+      const osgGA::GUIEventAdapter& ea)
+   {
+      switch (ea.getButton())
+      {
+         case osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON:
+            return LEFT_MOUSE_BUTTON;
+         case osgGA::GUIEventAdapter::MIDDLE_MOUSE_BUTTON:
+            return MIDDLE_MOUSE_BUTTON;
+         case osgGA::GUIEventAdapter::RIGHT_MOUSE_BUTTON:
+            return RIGHT_MOUSE_BUTTON;
+         default:
+         {
+            assert(false && "Got an invalid mouse button code. Is 'ea' really "
+                   "a mouse event?");
+            return MOUSE_BUTTON_COUNT; // Can't happen; but makes compiler happy
+         }
+      }
+   }
+
+
+
+   // - EventHandler::updatePickingData ----------------------------------------
+   bool EventHandler::updatePickingData(
+      osg::View* view, const osgGA::GUIEventAdapter& ea)
+   {
+      PickResult pick;
+
+      // The position picked, if known, for publishing in the pick service
+      bool hasPosition = false;
+      float x = 0.0f;
+      float y = 0.0f;
+
+      if (asyncPicker_.get() != 0 && pickerRadius_ == 0.0)
+      {
+         const bool gotResult = fetchAsyncPick(view, pick);
+
+         if (asyncPicker_->isIdle() && isPickDue(view, ea))
+            postAsyncPick(view, ea);
+
+         if (!gotResult)
+            return false;
+      }
+      else if (pickBudget_ > 0.0 && pickerRadius_ == 0.0)
+      {
+         bool pickedOverlay = false;
+
+         // A picking in progress is always continued; a new one is started
+         // only when the schedule says so.
+         if (!hoverTraversal_.isRunning())
+         {
+            if (!isPickDue(view, ea))
+               return false;
+
+            assert(pickingMasks_.size() > 0);
+            getWindowCoords(view, ea, hoverX_, hoverY_);
+            hoverMaskIndex_ = 0;
+
+            if (overlayPicking_ && pickOverlay(view, hoverX_, hoverY_, pick))
+            {
+               pickedOverlay = true;
+            }
+            else
+            {
+               float cameraX = hoverX_;
+               float cameraY = hoverY_;
+               osg::Camera* camera =
+                  PickTraversal::findCamera(view, cameraX, cameraY);
+
+               hoverTraversal_.start(camera, cameraX, cameraY,
+                                     pickingMasks_[hoverMaskIndex_]);
+            }
+         }
+
+         if (!pickedOverlay && !resumeHoverPick(view, pick))
+            return false;
+
+         hasPosition = true;
+         x = hoverX_;
+         y = hoverY_;
+      }
+      else
+      {
+         if (!isPickDue(view, ea))
+            return false;
+
+         hasPosition = true;
+         getWindowCoords(view, ea, x, y);
+         pick = pickAt(view, x, y);
+      }
+
+      if (hysteresisPixels_ > 0.0f || hysteresisFrames_ > 1)
+         applyHoverHysteresis(view, ea, pick);
+
+      setPointerPick(mouse_, pick);
+
+      if (hasPosition && pickService_.valid())
+         pickService_->publishMousePick(view, x, y, pick);
+
+      return true;
+   }
+
+
+
+   // - EventHandler::applyHoverHysteresis -------------------------------------
+   void EventHandler::applyHoverHysteresis(osg::View* view,
+                                           const osgGA::GUIEventAdapter& ea,
+                                           PickResult& pick)
+   {
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+      const osg::Vec2 position(x, y);
+
+      if (pick.node == mouse_.node || !mouse_.node.valid())
+      {
+         hysteresisAnchor_ = position;
+         hysteresisCandidate_ = NodePtr();
+         hysteresisCount_ = 0;
+         return;
+      }
+
+      // Something else was picked; count for how long
+      if (pick.node == hysteresisCandidate_ && hysteresisCount_ > 0)
+      {
+         ++hysteresisCount_;
+      }
+      else
+      {
+         hysteresisCandidate_ = pick.node;
+         hysteresisCount_ = 1;
+      }
+
+      const bool withinPixels = hysteresisPixels_ > 0.0f
+         && (position - hysteresisAnchor_).length() <= hysteresisPixels_;
+
+      const bool withinFrames = hysteresisFrames_ > 1
+         && hysteresisCount_ < hysteresisFrames_;
+
+      if (!withinPixels && !withinFrames)
+      {
+         // Switch
+         hysteresisAnchor_ = position;
+         hysteresisCandidate_ = NodePtr();
+         hysteresisCount_ = 0;
+         return;
+      }
+
+      // Keep the current node, as if nothing changed
+      pick.node = mouse_.node;
+      pick.hit = mouse_.hit;
+      pick.hasHit = true;
+   }
+
+
+
+   // - EventHandler::setPointerPick -------------------------------------------
+   void EventHandler::setPointerPick(PointerState& pointer,
+                                     const PickResult& pick)
+   {
+      if (pick.hasHit)
+         pointer.hit = pick.hit;
+
+      pointer.prevNode = pointer.node;
+      pointer.prevPosition = pointer.position;
+
+      pointer.node = pick.node;
+      pointer.position = pick.node.valid()
+         ? osg::Vec3(pick.hit.localIntersectionPoint)
+         : osg::Vec3();
+   }
+
+
+
+   // - EventHandler::postAsyncPick --------------------------------------------
+   void EventHandler::postAsyncPick(osg::View* view,
+                                    const osgGA::GUIEventAdapter& ea)
+   {
+      AsyncPicker::Request& request = asyncPicker_->getRequest();
+
+      request.allMasks = ignoreBackFaces_;
+      request.cullBackFaces = ignoreBackFaces_;
+      request.candidates.clear();
+      request.hits.clear();
+
+      // Paths not viewed through this view's cameras (the master or a slave)
+      // are not pickable here; paths under other registered nodes will be
+      // traversed when traversing these other nodes
+      if (!asyncPickPaths_.isValidFor(view, sceneRevision_))
+      {
+         asyncPickPaths_.paths.clear();
+
+         Nodes_t nodes;
+         getRegisteredNodes(nodes);
+
+         for (Nodes_t::const_iterator p = nodes.begin(); p != nodes.end(); ++p)
+         {
+            const osg::NodePathList paths = (*p)->getParentalNodePaths();
+
+            typedef osg::NodePathList::const_iterator iter_t;
+            for (iter_t path = paths.begin(); path != paths.end(); ++path)
+            {
+               if (path->empty() || hasObservedAncestor(*path))
+                  continue;
+
+               osg::Camera* camera =
+                  dynamic_cast<osg::Camera*>(path->front());
+
+               if (camera != 0 && camera->getView() == view)
+               {
+                  asyncPickPaths_.paths.push_back(
+                     RefNodePath_t(path->begin(), path->end()));
+               }
+            }
+         }
+
+         asyncPickPaths_.owner = view;
+         asyncPickPaths_.sceneRevision = sceneRevision_;
+         asyncPickPaths_.valid = true;
+      }
+
+      // The matrices along the paths may have changed, so the roots are
+      // always made again
+      PickTraversal::Roots_t roots;
+
+      typedef std::vector<RefNodePath_t>::const_iterator pathIter_t;
+      for (pathIter_t p = asyncPickPaths_.paths.begin();
+           p != asyncPickPaths_.paths.end();
+           ++p)
+      {
+         PickTraversal::Root root;
+         if (PickTraversal::makeRoot(osg::NodePath(p->begin(), p->end()),
+                                     root, pickLODScale_))
+         {
+            roots.push_back(root);
+         }
+      }
+
+      // Only culling is done here; the worker just intersects the triangles
+      // captured, never touching the scene graph, which can thus change
+      // freely while it runs
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+
+      PickTraversal traversal;
+      traversal.setLODScale(pickLODScale_);
+      traversal.setTriangleCache(triangleCache_.get());
+
+      typedef NodeMasks_t::const_iterator maskIter_t;
+      for (maskIter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+      {
+         traversal.start(roots, x, y, *p);
+         traversal.resume();
+
+         request.candidates.push_back(traversal.getCandidates());
+         request.hits.push_back(traversal.getHits());
+      }
+
+      asyncPicker_->post();
+      asyncPickView_ = view;
+   }
+
+
+
+   // - EventHandler::setMouseView ---------------------------------------------
+   void EventHandler::setMouseView(const osg::View* view)
+   {
+      mouseView_ = view;
+
+      // Picking in progress was for the other view; pick again in this one
+      hoverTraversal_.reset();
+      hysteresisCount_ = 0;
+      pickDirty_ = true;
+   }
+
+
+
+   // - EventHandler::fetchAsyncPick -------------------------------------------
+   bool EventHandler::fetchAsyncPick(osg::View* view, PickResult& result)
+   {
+      const AsyncPicker::Result* asyncResult = asyncPicker_->fetch();
+
+      if (asyncResult == 0)
+         return false;
+
+      // Discard results for another view (the mouse pointer changed views)
+      if (asyncPickView_ != view)
+         return false;
+
+      typedef std::vector<PickTraversal::Hits_t>::const_iterator iter_t;
+      for (iter_t p = asyncResult->hits.begin();
+           p != asyncResult->hits.end();
+           ++p)
+      {
+         if (selectHit(view->getCamera(), *p, result))
+            break;
+      }
+
+      return true;
+   }
+
+
+
+   // - EventHandler::hasObservedAncestor --------------------------------------
+   bool EventHandler::hasObservedAncestor(const osg::NodePath& nodePath)
+   {
+      for (std::size_t i = 0; i + 1 < nodePath.size(); ++i)
+      {
+         if (signals_.find(NodePtr(nodePath[i])) != signals_.end())
+            return true;
+      }
+
+      return false;
+   }
+
+
+
+   // - EventHandler::resumeHoverPick ------------------------------------------
+   bool EventHandler::resumeHoverPick(osg::View* view, PickResult& result)
+   {
+      const osg::Timer* timer = osg::Timer::instance();
+      const osg::Timer_t startTick = timer->tick();
+
+      float cameraX = hoverX_;
+      float cameraY = hoverY_;
+      osg::Camera* camera = PickTraversal::findCamera(view, cameraX, cameraY);
+
+      while (true)
+      {
+         const double remaining =
+            pickBudget_ - timer->delta_s(startTick, timer->tick());
+
+         if (remaining <= 0.0 || !hoverTraversal_.resume(remaining))
+            return false;
+
+         // Done with this mask. Do we need to try the next one?
+         if (selectHit(camera, hoverTraversal_.getHits(), result))
+            return true;
+
+         if (++hoverMaskIndex_ >= pickingMasks_.size())
+            return true;
+
+         hoverTraversal_.start(camera, cameraX, cameraY,
+                               pickingMasks_[hoverMaskIndex_]);
+      }
+   }
+
+
+
+   // - EventHandler::isPickDue ------------------------------------------------
+   bool EventHandler::isPickDue(osg::View* view,
+                                const osgGA::GUIEventAdapter& ea)
+   {
+      bool due = true;
+
+      switch (pickSchedule_)
+      {
+         case PICK_EVERY_FRAME:
+            due = true;
+            break;
+
+         case PICK_ON_MOTION:
+            due = pointerMoved_;
+            break;
+
+         case PICK_ON_CHANGE:
+            // Always check the camera, so that the stored matrices are kept
+            // up to date
+            due = hasCameraChanged(view) || pointerMoved_ || pickDirty_;
+            break;
+
+         case PICK_AT_MAX_RATE:
+            due = timeOfLastPick_ < 0.0
+               || ea.getTime() - timeOfLastPick_ >= 1.0 / maxPickRate_;
+            break;
+      }
+
+      if (due)
+      {
+         pointerMoved_ = false;
+         pickDirty_ = false;
+         timeOfLastPick_ = ea.getTime();
+      }
+
+      return due;
+   }
+
+
+
+   // - EventHandler::hasCameraChanged -----------------------------------------
+   bool EventHandler::hasCameraChanged(osg::View* view)
+   {
+      const osg::Camera* camera = view->getCamera();
+      const osg::Viewport* vp = camera->getViewport();
+
+      const osg::Vec4d viewport = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      const bool changed = camera->getViewMatrix() != lastViewMatrix_
+         || camera->getProjectionMatrix() != lastProjectionMatrix_
+         || viewport != lastViewport_;
+
+      lastViewMatrix_ = camera->getViewMatrix();
+      lastProjectionMatrix_ = camera->getProjectionMatrix();
+      lastViewport_ = viewport;
+
+      return changed;
+   }
+
+
+
+   // - EventHandler::getWindowCoords ------------------------------------------
+   void EventHandler::getWindowCoords(
+      osg::View* view, const osgGA::GUIEventAdapter& ea, float& x, float& y)
+   {
+      getWindowCoords(view, ea.getXnormalized(), ea.getYnormalized(), x, y);
+   }
+
+
+
+   // - EventHandler::getWindowCoords ------------------------------------------
+   void EventHandler::getWindowCoords(osg::View* view,
+                                      float xNormalized, float yNormalized,
+                                      float& x, float& y)
+   {
+      const osg::Viewport* vp = view->getCamera()->getViewport();
+
+      // Without a master viewport (like in display walls, where each slave
+      // has its own), osgViewer reports events in the master's clip space,
+      // which is also what an identity window matrix gives everywhere else
+      if (vp == 0)
+      {
+         x = xNormalized;
+         y = yNormalized;
+         return;
+      }
+
+      x = vp->x() + static_cast<int>(
+         vp->width() * (xNormalized * 0.5f + 0.5f));
+      y = vp->y() + static_cast<int>(
+         vp->height() * (yNormalized * 0.5f + 0.5f));
+   }
+
+
+
+   // - EventHandler::pickAtEvent ----------------------------------------------
+   PickResult EventHandler::pickAtEvent(
+      osg::View* view, const osgGA::GUIEventAdapter& ea)
+   {
+      if (view == 0)
+      {
+         PickResult current;
+         current.node = mouse_.node;
+         current.hit = mouse_.hit;
+         current.hasHit = true;
+         return current;
+      }
+
+      float x, y;
+      getWindowCoords(view, ea, x, y);
+
+      return pickAt(view, x, y);
+   }
+
+
+
+   // - EventHandler::pick -----------------------------------------------------
+   void EventHandler::pick(osg::View* view, float x, float y,
+                           PickResult& result)
+   {
+      assert(pickerRadius_ >= 0.0 && "Cannot use negative picker radius");
+
+      if (overlayPicking_ && pickerRadius_ == 0.0
+          && pickOverlay(view, x, y, result))
+      {
+         return;
+      }
+
+      if (pickerRadius_ > 0.0)
+         pickPolytope(view, x, y, result);
+      else
+         pickLine(view, x, y, result);
+   }
+
+
+
+   // - EventHandler::pickLine -------------------------------------------------
+   void EventHandler::pickLine(osg::View* view, float x, float y,
+                               PickResult& result)
+   {
+      if (pickService_.valid())
+      {
+         const float masterX = x;
+         const float masterY = y;
+         const osg::Camera* camera = PickTraversal::findCamera(view, x, y);
+
+         typedef NodeMasks_t::const_iterator iter_t;
+         for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+         {
+            if (selectHit(camera,
+                          pickService_->pick(view, masterX, masterY, *p),
+                          result))
             {
-               for (iter_t hit = hitList.begin(); hit != hitList.end(); ++hit)
-               {
-                  if (IsFrontFacing(view->getCamera(), *hit))
-                  {
-                     theHit = hit;
-                     break;
-                  }
-               }
+               break;
             }
-            else // !ignoreBackFaces_
+         }
+
+         return;
+      }
+
+      osg::Camera* camera = PickTraversal::findCamera(view, x, y);
+
+      if (pickThreadPool_.valid() && pickingMasks_.size() > 1)
+      {
+         std::vector<PickTask> tasks;
+         tasks.reserve(pickingMasks_.size());
+         PickThreadPool::Tasks_t taskPtrs;
+
+         typedef NodeMasks_t::const_iterator iter_t;
+         for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+         {
+            tasks.push_back(PickTask(camera, x, y, *p, pickLODScale_));
+            taskPtrs.push_back(&tasks.back());
+         }
+
+         pickThreadPool_->run(taskPtrs);
+
+         // Merge in mask priority order
+         typedef std::vector<PickTask>::const_iterator taskIter_t;
+         for (taskIter_t p = tasks.begin(); p != tasks.end(); ++p)
+         {
+            if (selectHit(camera, p->getHits(), result))
+               break;
+         }
+
+         return;
+      }
+
+      PickTraversal traversal;
+      traversal.setLODScale(pickLODScale_);
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+      {
+         traversal.start(camera, x, y, *p);
+         traversal.resume();
+
+         if (selectHit(camera, traversal.getHits(), result))
+            break;
+      }
+   }
+
+
+
+   // - EventHandler::pickBatch ------------------------------------------------
+   void EventHandler::pickBatch(osg::View* view,
+                                const std::vector<osg::Vec2>& points,
+                                std::vector<PickResult>& results)
+   {
+      results.assign(points.size(), PickResult());
+
+      // The batch traversal skips HUDs, so points over them are resolved
+      // first, one by one
+      PickTraversal::Roots_t absoluteRoots;
+      getAbsoluteRoots(view->getCamera(), absoluteRoots);
+
+      // The other points, grouped by the camera showing them
+      std::vector<osg::Camera*> cameras;
+      std::vector< std::vector<std::size_t> > indices;
+      std::vector<BatchPickTraversal::Segments_t> segments;
+
+      for (std::size_t i = 0; i < points.size(); ++i)
+      {
+         float x = points[i].x();
+         float y = points[i].y();
+
+         if ((overlayPicking_ && pickOverlay(view, x, y, results[i]))
+             || pickRoots(view, absoluteRoots, x, y, results[i]))
+         {
+            continue;
+         }
+
+         // Each point is picked through the camera showing it, in its own
+         // window coordinates
+         osg::Camera* camera = PickTraversal::findCamera(view, x, y);
+
+         const std::size_t batch =
+            std::find(cameras.begin(), cameras.end(), camera)
+            - cameras.begin();
+
+         if (batch == cameras.size())
+         {
+            cameras.push_back(camera);
+            indices.push_back(std::vector<std::size_t>());
+            segments.push_back(BatchPickTraversal::Segments_t());
+         }
+
+         indices[batch].push_back(i);
+         segments[batch].push_back(
+            BatchPickTraversal::makeSegment(*camera, x, y));
+      }
+
+      // Pick all other points together, in one batch per camera
+      std::vector<PickResult> batchPicks;
+
+      for (std::size_t b = 0; b < cameras.size(); ++b)
+      {
+         pickBatch(view, segments[b], batchPicks, cameras[b]);
+
+         for (std::size_t j = 0; j < indices[b].size(); ++j)
+            results[indices[b][j]] = batchPicks[j];
+      }
+   }
+
+
+
+   // - EventHandler::pickBatch ------------------------------------------------
+   void EventHandler::pickBatch(osg::View* view,
+                                const BatchPickTraversal::Segments_t& segments,
+                                std::vector<PickResult>& results,
+                                osg::Camera* camera)
+   {
+      results.assign(segments.size(), PickResult());
+
+      if (camera == 0)
+         camera = view->getCamera();
+
+      // The indices of the segments that didn't hit anything yet
+      std::vector<std::size_t> pending;
+      pending.reserve(segments.size());
+      for (std::size_t i = 0; i < segments.size(); ++i)
+         pending.push_back(i);
+
+      BatchPickTraversal::Segments_t pendingSegments;
+      BatchPickTraversal::Hits_t hits;
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin();
+           p != pickingMasks_.end() && !pending.empty();
+           ++p)
+      {
+         pendingSegments.clear();
+         for (std::size_t i = 0; i < pending.size(); ++i)
+            pendingSegments.push_back(segments[pending[i]]);
+
+         runBatchPick(camera, pendingSegments, *p, hits);
+
+         std::vector<std::size_t> stillPending;
+
+         for (std::size_t i = 0; i < pending.size(); ++i)
+         {
+            if (!hits[i].hasHit)
             {
-               theHit = hitList.begin();
+               stillPending.push_back(pending[i]);
+               continue;
             }
 
-            if (theHit != hitList.end())
+            PickResult& result = results[pending[i]];
+            result.node = getObservedNode(hits[i].intersection.nodePath);
+            result.hit = hits[i].intersection;
+            result.hasHit = true;
+         }
+
+         pending.swap(stillPending);
+      }
+   }
+
+
+
+   // - EventHandler::runBatchPick ---------------------------------------------
+   void EventHandler::runBatchPick(
+      osg::Camera* camera, const BatchPickTraversal::Segments_t& segments,
+      osg::Node::NodeMask mask, BatchPickTraversal::Hits_t& hits)
+   {
+      if (!pickThreadPool_.valid() || segments.size() <= BATCH_PICK_CHUNK_SIZE)
+      {
+         BatchPickTraversal traversal;
+         traversal.setLODScale(pickLODScale_);
+         traversal.setTriangleCache(triangleCache_.get());
+         hits = traversal.pick(camera, segments, mask, ignoreBackFaces_);
+         return;
+      }
+
+      const std::size_t numChunks =
+         (segments.size() + BATCH_PICK_CHUNK_SIZE - 1) / BATCH_PICK_CHUNK_SIZE;
+
+      std::vector<BatchPickTask> tasks(
+         numChunks,
+         BatchPickTask(camera, mask, ignoreBackFaces_, pickLODScale_,
+                       triangleCache_.get()));
+      PickThreadPool::Tasks_t taskPtrs;
+
+      for (std::size_t i = 0; i < numChunks; ++i)
+      {
+         const std::size_t begin = i * BATCH_PICK_CHUNK_SIZE;
+         const std::size_t end =
+            std::min(begin + BATCH_PICK_CHUNK_SIZE, segments.size());
+
+         tasks[i].segments.assign(segments.begin() + begin,
+                                  segments.begin() + end);
+         taskPtrs.push_back(&tasks[i]);
+      }
+
+      pickThreadPool_->run(taskPtrs);
+
+      hits.clear();
+      hits.reserve(segments.size());
+
+      typedef std::vector<BatchPickTask>::const_iterator iter_t;
+      for (iter_t p = tasks.begin(); p != tasks.end(); ++p)
+         hits.insert(hits.end(), p->getHits().begin(), p->getHits().end());
+   }
+
+
+
+   // - EventHandler::selectHit ------------------------------------------------
+   bool EventHandler::selectHit(const osg::Camera* camera,
+                                const PickTraversal::Hits_t& hits,
+                                PickResult& result)
+   {
+      if (hits.empty())
+         return false;
+
+      typedef PickTraversal::Hits_t::const_iterator iter_t;
+
+      iter_t theHit = hits.end();
+
+      if (ignoreBackFaces_ && hits.size() >= 2)
+      {
+         for (iter_t hit = hits.begin(); hit != hits.end(); ++hit)
+         {
+            if (IsFrontFacing(camera, hit->intersection))
             {
-               currentNodeUnderMouse = getObservedNode(theHit->nodePath);
-               assert(signals_.find(currentNodeUnderMouse) != signals_.end()
-                      && "'getObservedNode()' returned an invalid value!");
+               theHit = hit;
+               break;
+            }
+         }
+      }
+      else // !ignoreBackFaces_
+      {
+         theHit = hits.begin();
+      }
 
-               currentPositionUnderMouse = theHit->getLocalIntersectPoint();
+      if (theHit == hits.end())
+         return false;
 
-               hitUnderMouse_ = Intersection_t(*theHit);
+      // Among hits at about the same depth (like z-fighting surfaces),
+      // prefer the node currently under the mouse pointer
+      if (depthTieTolerance_ > 0.0 && mouse_.node.valid()
+          && getObservedNode(theHit->intersection.nodePath) != mouse_.node)
+      {
+         const double maxRatio = theHit->ratio + depthTieTolerance_;
 
+         for (iter_t hit = theHit + 1;
+              hit != hits.end() && hit->ratio <= maxRatio;
+              ++hit)
+         {
+            if (getObservedNode(hit->intersection.nodePath) == mouse_.node
+                && (!ignoreBackFaces_
+                    || IsFrontFacing(camera, hit->intersection)))
+            {
+               theHit = hit;
                break;
             }
-         }  // if (hitList.size() > 0)
-      } // for (...pickingMasks_...)
+         }
+      }
 
-      prevNodeUnderMouse_ = nodeUnderMouse_;
-      prevPositionUnderMouse_ = positionUnderMouse_;
+      result.node = getObservedNode(theHit->intersection.nodePath);
+      assert(signals_.find(result.node) != signals_.end()
+             && "'getObservedNode()' returned an invalid value!");
 
-      nodeUnderMouse_ = currentNodeUnderMouse;
-      positionUnderMouse_ = currentPositionUnderMouse;
+      result.hit = theHit->intersection;
+      result.hasHit = true;
+
+      return true;
    }
 
 
 
-   // - EventHandler::updatePickingDataPolytope --------------------------------
-   void EventHandler::updatePickingDataPolytope(
-      osg::View* view, const osgGA::GUIEventAdapter& ea)
+   // - EventHandler::pickPolytope ---------------------------------------------
+   void EventHandler::pickPolytope(osg::View* view, float x, float y,
+                                   PickResult& result)
    {
-      const osg::Viewport* vp = view->getCamera()->getViewport();
-
-      const float x = vp->x() + static_cast<int>(
-         vp->width() * (ea.getXnormalized() * 0.5f + 0.5f));
-      const float y = vp->y() + static_cast<int>(
-         vp->height() * (ea.getYnormalized() * 0.5f + 0.5f));
+      osg::Camera* camera = PickTraversal::findCamera(view, x, y);
+      const osg::Viewport* vp = camera->getViewport();
 
-      NodePtr currentNodeUnderMouse;
-      osg::Vec3 currentPositionUnderMouse;
+      // Without a viewport, window coordinates are clip coordinates, which
+      // span two units in each direction
+      const double width = vp != 0 ? vp->width() : 2.0;
+      const double height = vp != 0 ? vp->height() : 2.0;
 
       typedef NodeMasks_t::const_iterator iter_t;
       for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
       {
-         const float dx = vp->width() * pickerRadius_;
-         const float dy = (vp->height() / vp->width()) * dx;
+         const float dx = width * pickerRadius_;
+         const float dy = (height / width) * dx;
          osg::ref_ptr<osgUtil::PolytopeIntersector> picker(
             new osgUtil::PolytopeIntersector(
                osgUtil::Intersector::WINDOW, x-dx, y-dy, x+dx, y+dy));
 
          osgUtil::IntersectionVisitor iv(picker);
          iv.setTraversalMask(*p);
+         iv.setLODSelectionMode(
+            osgUtil::IntersectionVisitor
+               ::USE_EYE_POINT_FOR_LOD_LEVEL_SELECTION);
 
-         view->getCamera()->accept(iv);
+         camera->accept(iv);
 
-         const osgUtil::PolytopeIntersector::Intersections hitList =
+         const osgUtil::PolytopeIntersector::Intersections& hitList =
             picker->getIntersections();
 
          if (hitList.size() == 0)
@@ -547,20 +3193,182 @@ namespace OSGUIsh
 
          iter_t theHit = hitList.begin();
 
-         currentNodeUnderMouse = getObservedNode(theHit->nodePath);
-         assert(signals_.find(currentNodeUnderMouse) != signals_.end()
+         result.node = getObservedNode(theHit->nodePath);
+         assert(signals_.find(result.node) != signals_.end()
                 && "'getObservedNode()' returned an invalid value!");
 
-         currentPositionUnderMouse = theHit->localIntersectionPoint;
+         result.hit = Intersection_t(*theHit);
+         result.hasHit = true;
+
+         break;
+      }
+   }
+
+
+
+   // - EventHandler::pickOverlay ----------------------------------------------
+   bool EventHandler::pickOverlay(osg::View* view, float x, float y,
+                                  PickResult& result)
+   {
+      osg::Camera* camera = view->getCamera();
+
+      if (overlayIndex_.needsRebuild(camera))
+      {
+         Nodes_t nodes;
+         getRegisteredNodes(nodes);
+
+         overlayIndex_.rebuild(camera, nodes, pickLODScale_);
+      }
+
+      if (overlayIndex_.isEmpty())
+         return false;
+
+      OverlayIndex::Items_t items;
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+      {
+         overlayIndex_.findItems(x, y, *p, items);
+
+         if (items.empty())
+            continue;
+
+         if (overlayGeometry_)
+         {
+            PickTraversal::Roots_t roots;
+            roots.reserve(items.size());
+
+            typedef OverlayIndex::Items_t::const_iterator itemIter_t;
+            for (itemIter_t item = items.begin(); item != items.end(); ++item)
+               roots.push_back((*item)->root);
+
+            PickTraversal traversal;
+            traversal.setLODScale(pickLODScale_);
+            traversal.start(roots, x, y, *p);
+            traversal.resume();
+
+            if (selectHit(camera, traversal.getHits(), result))
+               return true;
+
+            continue;
+         }
+
+         // Hit the nearest rectangle, at the depth of its nearest point
+         const OverlayIndex::Item& item = *items.front();
+         const PickTraversal::Root& root = item.root;
+
+         osg::Matrixd fromWindow;
+         fromWindow.invert(root.view * root.projection * root.window);
+
+         Intersection_t& hit = result.hit;
+         hit.nodePath.assign(root.path.begin(), root.path.end());
+         hit.worldIntersectionPoint =
+            osg::Vec3d(x, y, item.depth) * fromWindow;
+         hit.worldIntersectionNormal = osg::Vec3(0.0, 0.0, 0.0);
+         hit.localIntersectionPoint = hit.worldIntersectionPoint
+            * osg::computeWorldToLocal(hit.nodePath);
+         hit.localIntersectionNormal = osg::Vec3(0.0, 0.0, 0.0);
+
+         result.node = item.node;
+         result.hasHit = true;
+
+         return true;
+      }
+
+      return false;
+   }
+
+
+
+   // - EventHandler::getAbsoluteRoots -----------------------------------------
+   void EventHandler::getAbsoluteRoots(osg::Camera* camera,
+                                       PickTraversal::Roots_t& roots)
+   {
+      roots.clear();
 
-         hitUnderMouse_ = *theHit;
+      if (!absolutePaths_.isValidFor(camera, sceneRevision_))
+      {
+         absolutePaths_.paths.clear();
+
+         Nodes_t nodes;
+         getRegisteredNodes(nodes);
+
+         typedef Nodes_t::const_iterator iter_t;
+         for (iter_t p = nodes.begin(); p != nodes.end(); ++p)
+         {
+            const osg::NodePathList paths = (*p)->getParentalNodePaths();
+
+            typedef osg::NodePathList::const_iterator pathIter_t;
+            for (pathIter_t path = paths.begin(); path != paths.end(); ++path)
+            {
+               if (path->empty() || path->front() != camera)
+                  continue;
+
+               // Skip the camera itself, which is absolute, too
+               bool isAbsolute = false;
+               for (std::size_t i = 1; i < path->size() && !isAbsolute; ++i)
+               {
+                  const osg::Transform* transform = (*path)[i]->asTransform();
+
+                  isAbsolute =
+                     dynamic_cast<const osg::Projection*>((*path)[i]) != 0
+                     || (transform != 0 && transform->getReferenceFrame()
+                         != osg::Transform::RELATIVE_RF);
+               }
+
+               if (isAbsolute)
+               {
+                  absolutePaths_.paths.push_back(
+                     RefNodePath_t(path->begin(), path->end()));
+               }
+            }
+         }
+
+         absolutePaths_.owner = camera;
+         absolutePaths_.sceneRevision = sceneRevision_;
+         absolutePaths_.valid = true;
       }
 
-      prevNodeUnderMouse_ = nodeUnderMouse_;
-      prevPositionUnderMouse_ = positionUnderMouse_;
+      // The matrices along the paths may have changed, so the roots are
+      // always made again
+      typedef std::vector<RefNodePath_t>::const_iterator iter_t;
+      for (iter_t p = absolutePaths_.paths.begin();
+           p != absolutePaths_.paths.end();
+           ++p)
+      {
+         PickTraversal::Root root;
+         if (PickTraversal::makeRoot(osg::NodePath(p->begin(), p->end()),
+                                     root, pickLODScale_))
+         {
+            roots.push_back(root);
+         }
+      }
+   }
+
+
+
+   // - EventHandler::pickRoots ------------------------------------------------
+   bool EventHandler::pickRoots(osg::View* view,
+                                const PickTraversal::Roots_t& roots,
+                                float x, float y, PickResult& result)
+   {
+      if (roots.empty())
+         return false;
+
+      PickTraversal traversal;
+      traversal.setLODScale(pickLODScale_);
+
+      typedef NodeMasks_t::const_iterator iter_t;
+      for (iter_t p = pickingMasks_.begin(); p != pickingMasks_.end(); ++p)
+      {
+         traversal.start(roots, x, y, *p);
+         traversal.resume();
+
+         if (selectHit(view->getCamera(), traversal.getHits(), result))
+            return true;
+      }
 
-      nodeUnderMouse_ = currentNodeUnderMouse;
-      positionUnderMouse_ = currentPositionUnderMouse;
+      return false;
    }
 
 } // namespace OSGUIsh
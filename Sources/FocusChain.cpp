@@ -0,0 +1,254 @@
+/******************************************************************************\
+* FocusChain.cpp                                                               *
+* The sequence in which nodes get the focus with Tab and Shift-Tab.            *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/FocusChain.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <OSGUIsh/PickTraversal.hpp>
+
+
+namespace OSGUIsh
+{
+   // - FocusChain::FocusChain -------------------------------------------------
+   FocusChain::FocusChain(Order order, float rowHeight)
+      : order_(order), rowHeight_(rowHeight), lastLink_(0), valid_(false),
+        viewport_(-1.0, -1.0, -1.0, -1.0)
+   {
+      assert(rowHeight_ > 0.0f && "Row height must be positive");
+   }
+
+
+
+   // - FocusChain::setOrder ---------------------------------------------------
+   void FocusChain::setOrder(Order order, float rowHeight)
+   {
+      assert(rowHeight > 0.0f && "Row height must be positive");
+
+      order_ = order;
+      rowHeight_ = rowHeight;
+      valid_ = false;
+   }
+
+
+
+   // - FocusChain::setTabIndex ------------------------------------------------
+   void FocusChain::setTabIndex(const NodePtr& node, int tabIndex)
+   {
+      if (tabIndex == 0)
+         tabIndices_.erase(node);
+      else
+         tabIndices_[node] = tabIndex;
+
+      valid_ = false;
+   }
+
+
+
+   // - FocusChain::needsRebuild -----------------------------------------------
+   bool FocusChain::needsRebuild(const osg::Camera* camera) const
+   {
+      if (!valid_)
+         return true;
+
+      if (order_ != ORDER_SCREEN_POSITION)
+         return false;
+
+      const osg::Viewport* vp = camera->getViewport();
+
+      const osg::Vec4d viewport = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      return camera->getViewMatrix() != viewMatrix_
+         || camera->getProjectionMatrix() != projectionMatrix_
+         || viewport != viewport_;
+   }
+
+
+
+   // - FocusChain::rebuild ----------------------------------------------------
+   void FocusChain::rebuild(osg::Camera* camera, const Nodes_t& nodes)
+   {
+      const osg::Viewport* vp = camera->getViewport();
+
+      valid_ = true;
+      viewMatrix_ = camera->getViewMatrix();
+      projectionMatrix_ = camera->getProjectionMatrix();
+      viewport_ = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      std::vector<SortKey> keys;
+      keys.reserve(nodes.size());
+
+      typedef Nodes_t::const_iterator iter_t;
+      for (iter_t p = nodes.begin(); p != nodes.end(); ++p)
+      {
+         if (!p->valid())
+            continue;
+
+         SortKey key;
+         key.node = *p;
+         key.tabIndex = 0;
+         key.visible = false;
+         key.row = 0;
+         key.x = 0.0f;
+
+         const std::map<NodePtr, int>::const_iterator tabIndexIter =
+            tabIndices_.find(*p);
+
+         if (tabIndexIter != tabIndices_.end())
+            key.tabIndex = tabIndexIter->second;
+
+         if (key.tabIndex < 0)
+            continue;
+         else if (key.tabIndex == 0)
+            key.tabIndex = std::numeric_limits<int>::max();
+
+         const osg::NodePathList paths = (*p)->getParentalNodePaths();
+
+         if (paths.empty())
+         {
+            keys.push_back(key);
+            continue;
+         }
+
+         // Prefer the first instance under the camera, if any
+         osg::NodePathList::const_iterator path = paths.begin();
+         while (path != paths.end()
+                && (path->empty() || path->front() != camera))
+         {
+            ++path;
+         }
+
+         if (path == paths.end())
+            path = paths.begin();
+
+         for (std::size_t i = 0; i + 1 < path->size(); ++i)
+         {
+            const osg::Group* group = (*path)[i]->asGroup();
+            key.path.push_back(
+               group != 0 ? group->getChildIndex((*path)[i + 1]) : 0);
+         }
+
+         PickTraversal::Root root;
+         if (order_ == ORDER_SCREEN_POSITION && vp != 0
+             && PickTraversal::makeRoot(*path, root))
+         {
+            const osg::BoundingSphere& bs = (*p)->getBound();
+            const osg::Vec4d center =
+               osg::Vec4d(bs.center().x(), bs.center().y(), bs.center().z(),
+                          1.0)
+               * (root.model * root.view * root.projection * root.window);
+
+            if (center.w() > 0.0)
+            {
+               const float x = center.x() / center.w();
+               const float y = center.y() / center.w();
+
+               key.visible = x >= vp->x() && x < vp->x() + vp->width()
+                  && y >= vp->y() && y < vp->y() + vp->height();
+
+               key.row = static_cast<int>(
+                  std::floor((vp->y() + vp->height() - y) / rowHeight_));
+               key.x = x;
+            }
+         }
+
+         keys.push_back(key);
+      }
+
+      std::stable_sort(keys.begin(), keys.end());
+
+      const std::size_t numLinks = keys.size();
+
+      links_.resize(numLinks);
+      linksByNode_.clear();
+      lastLink_ = 0;
+
+      for (std::size_t i = 0; i < numLinks; ++i)
+      {
+         links_[i].node = keys[i].node;
+         links_[i].next = (i + 1) % numLinks;
+         links_[i].previous = (i + numLinks - 1) % numLinks;
+         linksByNode_[keys[i].node.get()] = i;
+      }
+   }
+
+
+
+   // - FocusChain::getNext ----------------------------------------------------
+   NodePtr FocusChain::getNext(const NodePtr& from) const
+   {
+      if (links_.empty())
+         return NodePtr();
+
+      const std::size_t link = findLink(from);
+
+      lastLink_ = link < links_.size() ? links_[link].next : 0;
+
+      return links_[lastLink_].node;
+   }
+
+
+
+   // - FocusChain::getPrevious ------------------------------------------------
+   NodePtr FocusChain::getPrevious(const NodePtr& from) const
+   {
+      if (links_.empty())
+         return NodePtr();
+
+      const std::size_t link = findLink(from);
+
+      lastLink_ = link < links_.size()
+         ? links_[link].previous
+         : links_.size() - 1;
+
+      return links_[lastLink_].node;
+   }
+
+
+
+   // - FocusChain::findLink ---------------------------------------------------
+   std::size_t FocusChain::findLink(const NodePtr& node) const
+   {
+      if (lastLink_ < links_.size() && links_[lastLink_].node == node)
+         return lastLink_;
+
+      const std::map<const osg::Node*, std::size_t>::const_iterator
+         p = linksByNode_.find(node.get());
+
+      return p != linksByNode_.end() ? p->second : links_.size();
+   }
+
+
+
+   // - FocusChain::SortKey::operator< -----------------------------------------
+   bool FocusChain::SortKey::operator<(const SortKey& other) const
+   {
+      if (tabIndex != other.tabIndex)
+         return tabIndex < other.tabIndex;
+
+      if (visible != other.visible)
+         return visible;
+
+      if (visible && row != other.row)
+         return row < other.row;
+
+      if (visible && x != other.x)
+         return x < other.x;
+
+      return path < other.path;
+   }
+
+} // namespace OSGUIsh
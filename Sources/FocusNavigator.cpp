@@ -0,0 +1,273 @@
+/******************************************************************************\
+* FocusNavigator.cpp                                                           *
+* Finds the registered node in a given screen direction.                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/FocusNavigator.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <OSGUIsh/PickTraversal.hpp>
+
+
+namespace OSGUIsh
+{
+   // - FocusNavigator::FocusNavigator -----------------------------------------
+   FocusNavigator::FocusNavigator(float cellSize)
+      : cellSize_(cellSize), numColumns_(0), numRows_(0), valid_(false),
+        viewport_(-1.0, -1.0, -1.0, -1.0)
+   {
+      assert(cellSize_ > 0.0f && "Grid cell size must be positive");
+   }
+
+
+
+   // - FocusNavigator::needsRebuild -------------------------------------------
+   bool FocusNavigator::needsRebuild(const osg::Camera* camera) const
+   {
+      if (!valid_)
+         return true;
+
+      const osg::Viewport* vp = camera->getViewport();
+
+      const osg::Vec4d viewport = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      return camera->getViewMatrix() != viewMatrix_
+         || camera->getProjectionMatrix() != projectionMatrix_
+         || viewport != viewport_;
+   }
+
+
+
+   // - FocusNavigator::rebuild ------------------------------------------------
+   void FocusNavigator::rebuild(osg::Camera* camera, const Nodes_t& nodes)
+   {
+      const osg::Viewport* vp = camera->getViewport();
+
+      valid_ = true;
+      viewMatrix_ = camera->getViewMatrix();
+      projectionMatrix_ = camera->getProjectionMatrix();
+      viewport_ = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      items_.clear();
+      itemsByNode_.clear();
+      cells_.clear();
+      numColumns_ = 0;
+      numRows_ = 0;
+
+      if (vp == 0)
+         return;
+
+      numColumns_ = std::max(
+         1, static_cast<int>(std::ceil(vp->width() / cellSize_)));
+      numRows_ = std::max(
+         1, static_cast<int>(std::ceil(vp->height() / cellSize_)));
+
+      cells_.resize(numColumns_ * numRows_);
+
+      typedef Nodes_t::const_iterator iter_t;
+      for (iter_t p = nodes.begin(); p != nodes.end(); ++p)
+      {
+         if (!p->valid())
+            continue;
+
+         const osg::NodePathList paths = (*p)->getParentalNodePaths();
+         const osg::BoundingSphere& bs = (*p)->getBound();
+
+         typedef osg::NodePathList::const_iterator pathIter_t;
+         for (pathIter_t path = paths.begin(); path != paths.end(); ++path)
+         {
+            PickTraversal::Root root;
+            if (path->empty() || path->front() != camera
+                || !PickTraversal::makeRoot(*path, root))
+            {
+               continue;
+            }
+
+            const osg::Vec4d center =
+               osg::Vec4d(bs.center().x(), bs.center().y(), bs.center().z(),
+                          1.0)
+               * (root.model * root.view * root.projection * root.window);
+
+            if (center.w() <= 0.0)
+               continue; // behind the viewer
+
+            const osg::Vec2 position(center.x() / center.w(),
+                                     center.y() / center.w());
+
+            if (position.x() < vp->x()
+                || position.x() >= vp->x() + vp->width()
+                || position.y() < vp->y()
+                || position.y() >= vp->y() + vp->height())
+            {
+               continue; // not visible
+            }
+
+            Item item;
+            item.node = *p;
+            item.position = position;
+
+            const std::size_t index = items_.size();
+            items_.push_back(item);
+            itemsByNode_[p->get()] = index;
+
+            cells_[getRow(position.y()) * numColumns_
+                   + getColumn(position.x())].push_back(index);
+
+            break; // only the first instance is indexed
+         }
+      }
+   }
+
+
+
+   // - FocusNavigator::findNeighbor -------------------------------------------
+   NodePtr FocusNavigator::findNeighbor(const NodePtr& from,
+                                        Direction direction) const
+   {
+      if (items_.empty())
+         return NodePtr();
+
+      const std::map<const osg::Node*, std::size_t>::const_iterator
+         fromIter = itemsByNode_.find(from.get());
+
+      // Not starting from an indexed node: take the one nearest to the
+      // viewport center. (This doesn't happen often, so a linear search is
+      // fine.)
+      if (fromIter == itemsByNode_.end())
+      {
+         const osg::Vec2 center(viewport_.x() + viewport_.z() / 2.0,
+                                viewport_.y() + viewport_.w() / 2.0);
+
+         std::size_t nearest = 0;
+         for (std::size_t i = 1; i < items_.size(); ++i)
+         {
+            if ((items_[i].position - center).length2()
+                < (items_[nearest].position - center).length2())
+            {
+               nearest = i;
+            }
+         }
+
+         return items_[nearest].node;
+      }
+
+      const std::size_t fromIndex = fromIter->second;
+      const osg::Vec2 origin = items_[fromIndex].position;
+      const int originColumn = getColumn(origin.x());
+      const int originRow = getRow(origin.y());
+
+      osg::Vec2 along;
+      switch (direction)
+      {
+         case NAVIGATE_LEFT: along = osg::Vec2(-1.0f, 0.0f); break;
+         case NAVIGATE_RIGHT: along = osg::Vec2(1.0f, 0.0f); break;
+         case NAVIGATE_UP: along = osg::Vec2(0.0f, 1.0f); break;
+         case NAVIGATE_DOWN: along = osg::Vec2(0.0f, -1.0f); break;
+      }
+
+      const osg::Vec2 across(-along.y(), along.x());
+
+      std::size_t best = fromIndex;
+      float bestScore = std::numeric_limits<float>::max();
+
+      // Visit the cells in square rings around the origin cell. Nodes in
+      // ring 'r' are at least 'r - 1' cells away, and scores are never less
+      // than distances; so, the search can stop when that bound is reached.
+      const int numRings = std::max(numColumns_, numRows_);
+
+      for (int r = 0; r < numRings; ++r)
+      {
+         if (bestScore <= (r - 1) * cellSize_)
+            break;
+
+         for (int row = originRow - r; row <= originRow + r; ++row)
+         {
+            if (row < 0 || row >= numRows_)
+               continue;
+
+            // Skip the rows entirely behind the origin
+            if ((direction == NAVIGATE_UP && row < originRow)
+                || (direction == NAVIGATE_DOWN && row > originRow))
+            {
+               continue;
+            }
+
+            // Inner rows of the ring have just two cells
+            const bool isEdgeRow =
+               row == originRow - r || row == originRow + r;
+            const int step = isEdgeRow ? 1 : 2 * r;
+
+            for (int col = originColumn - r; col <= originColumn + r;
+                 col += step)
+            {
+               if (col < 0 || col >= numColumns_)
+                  continue;
+
+               // Skip the columns entirely behind the origin
+               if ((direction == NAVIGATE_LEFT && col > originColumn)
+                   || (direction == NAVIGATE_RIGHT && col < originColumn))
+               {
+                  continue;
+               }
+
+               const Cell_t& cell = cells_[row * numColumns_ + col];
+
+               for (std::size_t i = 0; i < cell.size(); ++i)
+               {
+                  const osg::Vec2 d = items_[cell[i]].position - origin;
+                  const float distAlong = d * along;
+
+                  if (cell[i] == fromIndex || distAlong <= 0.0f)
+                     continue;
+
+                  const float score =
+                     distAlong + 2.0f * std::fabs(d * across);
+
+                  if (score < bestScore)
+                  {
+                     best = cell[i];
+                     bestScore = score;
+                  }
+               }
+            }
+         }
+      }
+
+      return best != fromIndex ? items_[best].node : NodePtr();
+   }
+
+
+
+   // - FocusNavigator::getColumn ----------------------------------------------
+   int FocusNavigator::getColumn(float x) const
+   {
+      const int col =
+         static_cast<int>(std::floor((x - viewport_.x()) / cellSize_));
+
+      return std::min(std::max(col, 0), numColumns_ - 1);
+   }
+
+
+
+   // - FocusNavigator::getRow -------------------------------------------------
+   int FocusNavigator::getRow(float y) const
+   {
+      const int row =
+         static_cast<int>(std::floor((y - viewport_.y()) / cellSize_));
+
+      return std::min(std::max(row, 0), numRows_ - 1);
+   }
+
+} // namespace OSGUIsh
@@ -10,14 +10,55 @@
 \******************************************************************************/
 
 #include <OSGUIsh/FocusPolicy.hpp>
+#include <cassert>
 
 namespace OSGUIsh
 {
    // - FocusPolicy::FocusPolicy -----------------------------------------------
-   FocusPolicy::FocusPolicy(NodePtr& focusedNode)
-      : focusedNode_(focusedNode)
+   FocusPolicy::FocusPolicy(unsigned eventMask)
+      : eventMask_(eventMask), fallback_(0)
    {
       // empty...
    }
 
+
+
+   // - FocusPolicy::~FocusPolicy ----------------------------------------------
+   FocusPolicy::~FocusPolicy()
+   {
+      // empty...
+   }
+
+
+
+   // - FocusPolicy::setFallback -----------------------------------------------
+   void FocusPolicy::setFallback(FocusPolicy* fallback)
+   {
+      for (FocusPolicy* p = fallback; p != 0; p = p->fallback_)
+         assert(p != this && "Focus policy chains cannot have cycles");
+
+      fallback_ = fallback;
+   }
+
+
+
+   // - FocusPolicy::decideFocus -----------------------------------------------
+   bool FocusPolicy::decideFocus(const osgGA::GUIEventAdapter& ea,
+                                 const NodePtr nodeUnderMouse,
+                                 NodePtr& focusedNode)
+   {
+      const unsigned eventType = ea.getEventType();
+
+      for (FocusPolicy* p = this; p != 0; p = p->fallback_)
+      {
+         if ((p->eventMask_ & eventType) != 0
+             && p->updateFocus(ea, nodeUnderMouse, focusedNode))
+         {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
 } // namespace OSGUIsh
@@ -0,0 +1,87 @@
+/******************************************************************************\
+* Gesture.cpp                                                                  *
+* The description of a gesture to be recognized.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/Gesture.hpp>
+#include <cassert>
+
+
+namespace OSGUIsh
+{
+   // - Gesture::multiClick ----------------------------------------------------
+   Gesture Gesture::multiClick(unsigned clickCount, unsigned button,
+                               double interval, float tolerance)
+   {
+      assert(clickCount > 0 && "A multi-click needs at least one click");
+      assert(interval >= 0.0 && "Multi-click interval cannot be negative");
+
+      Gesture gesture;
+      gesture.kind = MULTI_CLICK;
+      gesture.button = button;
+      gesture.clickCount = clickCount;
+      gesture.delay = interval;
+      gesture.repeatInterval = 0.0;
+      gesture.tolerance = tolerance;
+
+      return gesture;
+   }
+
+
+
+   // - Gesture::longPress -----------------------------------------------------
+   Gesture Gesture::longPress(unsigned button, double delay, float tolerance)
+   {
+      Gesture gesture;
+      gesture.kind = LONG_PRESS;
+      gesture.button = button;
+      gesture.clickCount = 0;
+      gesture.delay = delay;
+      gesture.repeatInterval = 0.0;
+      gesture.tolerance = tolerance;
+
+      return gesture;
+   }
+
+
+
+   // - Gesture::holdRepeat ----------------------------------------------------
+   Gesture Gesture::holdRepeat(unsigned button, double delay,
+                               double repeatInterval, float tolerance)
+   {
+      assert(repeatInterval > 0.0 && "Repeat interval must be positive");
+
+      Gesture gesture;
+      gesture.kind = HOLD_REPEAT;
+      gesture.button = button;
+      gesture.clickCount = 0;
+      gesture.delay = delay;
+      gesture.repeatInterval = repeatInterval;
+      gesture.tolerance = tolerance;
+
+      return gesture;
+   }
+
+
+
+   // - Gesture::hoverDwell ----------------------------------------------------
+   Gesture Gesture::hoverDwell(double delay, float tolerance)
+   {
+      Gesture gesture;
+      gesture.kind = HOVER_DWELL;
+      gesture.button = 0;
+      gesture.clickCount = 0;
+      gesture.delay = delay;
+      gesture.repeatInterval = 0.0;
+      gesture.tolerance = tolerance;
+
+      return gesture;
+   }
+
+} // namespace OSGUIsh
@@ -15,8 +15,8 @@
 namespace OSGUIsh
 {
    // - ManualFocusPolicy::ManualFocusPolicy -----------------------------------
-   ManualFocusPolicy::ManualFocusPolicy(NodePtr& focusedNode)
-      : FocusPolicy(focusedNode)
+   ManualFocusPolicy::ManualFocusPolicy()
+      : FocusPolicy(0)
    {
       // empty
    }
@@ -24,10 +24,12 @@ namespace OSGUIsh
 
 
    // - ManualFocusPolicy::updateFocus -----------------------------------------
-   void ManualFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
-                                       const NodePtr nodeUnderMouse)
+   bool ManualFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
+                                       const NodePtr nodeUnderMouse,
+                                       NodePtr& focusedNode)
    {
       // Do nothing. That's what "manual" is about.
+      return false;
    }
 
 } // namespace OSGUIsh
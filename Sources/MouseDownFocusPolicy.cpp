@@ -15,8 +15,8 @@
 namespace OSGUIsh
 {
    // - MouseDownFocusPolicy::MouseDownFocusPolicy -----------------------------
-   MouseDownFocusPolicy::MouseDownFocusPolicy(NodePtr& focusedNode)
-      : FocusPolicy(focusedNode)
+   MouseDownFocusPolicy::MouseDownFocusPolicy()
+      : FocusPolicy(osgGA::GUIEventAdapter::PUSH)
    {
       // empty...
    }
@@ -24,11 +24,12 @@ namespace OSGUIsh
 
 
    // - MouseDownFocusPolicy::updateFocus --------------------------------------
-   void MouseDownFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
-                                          const NodePtr nodeUnderMouse)
+   bool MouseDownFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
+                                          const NodePtr nodeUnderMouse,
+                                          NodePtr& focusedNode)
    {
-      if (ea.getEventType() == osgGA::GUIEventAdapter::PUSH)
-         setFocusedNode (nodeUnderMouse);
+      focusedNode = nodeUnderMouse;
+      return true;
    }
 
 } // namespace OSGUIsh
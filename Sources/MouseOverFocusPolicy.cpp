@@ -15,8 +15,11 @@
 namespace OSGUIsh
 {
    // - MouseOverFocusPolicy::MouseOverFocusPolicy -----------------------------
-   MouseOverFocusPolicy::MouseOverFocusPolicy(NodePtr& focusedNode)
-      : FocusPolicy(focusedNode)
+   MouseOverFocusPolicy::MouseOverFocusPolicy()
+      : FocusPolicy(osgGA::GUIEventAdapter::FRAME
+                    | osgGA::GUIEventAdapter::PUSH
+                    | osgGA::GUIEventAdapter::RELEASE
+                    | osgGA::GUIEventAdapter::SCROLL)
    {
       // empty...
    }
@@ -24,10 +27,12 @@ namespace OSGUIsh
 
 
    // - MouseOverFocusPolicy::updateFocus --------------------------------------
-   void MouseOverFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
-                                          const NodePtr nodeUnderMouse)
+   bool MouseOverFocusPolicy::updateFocus(const osgGA::GUIEventAdapter& ea,
+                                          const NodePtr nodeUnderMouse,
+                                          NodePtr& focusedNode)
    {
-      setFocusedNode(nodeUnderMouse);
+      focusedNode = nodeUnderMouse;
+      return true;
    }
 
 } // namespace OSGUIsh
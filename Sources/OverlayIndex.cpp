@@ -0,0 +1,387 @@
+/******************************************************************************\
+* OverlayIndex.cpp                                                             *
+* A 2D index of the registered nodes in HUDs and other overlays.               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/OverlayIndex.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <osg/ComputeBoundsVisitor>
+
+
+namespace
+{
+   /**
+    * Compares overlay items for sorting: nearest first and, at the same
+    * depth, deepest in the scene graph first.
+    */
+   bool IsItemInFront(const OSGUIsh::OverlayIndex::Item* a,
+                      const OSGUIsh::OverlayIndex::Item* b)
+   {
+      if (a->depth != b->depth)
+         return a->depth < b->depth;
+
+      return a->root.path.size() > b->root.path.size();
+   }
+
+} // (anonymous) namespace
+
+
+namespace OSGUIsh
+{
+   // - OverlayIndex::OverlayIndex ---------------------------------------------
+   OverlayIndex::OverlayIndex(float cellSize)
+      : cellSize_(cellSize), gridX_(0.0f), gridY_(0.0f), numColumns_(0),
+        numRows_(0), valid_(false), lodScale_(1.0f),
+        viewport_(-1.0, -1.0, -1.0, -1.0)
+   {
+      assert(cellSize_ > 0.0f && "Grid cell size must be positive");
+   }
+
+
+
+   // - OverlayIndex::needsRebuild ---------------------------------------------
+   bool OverlayIndex::needsRebuild(const osg::Camera* camera) const
+   {
+      if (!valid_)
+         return true;
+
+      const osg::Viewport* vp = camera->getViewport();
+
+      const osg::Vec4d viewport = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      if (viewport != viewport_)
+         return true;
+
+      typedef std::vector<CameraState>::const_iterator iter_t;
+      for (iter_t p = cameras_.begin(); p != cameras_.end(); ++p)
+      {
+         const osg::Viewport* overlayVP = p->camera->getViewport();
+
+         const osg::Vec4d overlayViewport = overlayVP != 0
+            ? osg::Vec4d(overlayVP->x(), overlayVP->y(),
+                         overlayVP->width(), overlayVP->height())
+            : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+         if (p->camera->getViewMatrix() != p->viewMatrix
+             || p->camera->getProjectionMatrix() != p->projectionMatrix
+             || overlayViewport != p->viewport)
+         {
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+
+
+   // - OverlayIndex::invalidateIfMoved ----------------------------------------
+   void OverlayIndex::invalidateIfMoved()
+   {
+      if (!valid_)
+         return;
+
+      typedef std::vector<Item>::const_iterator iter_t;
+      for (iter_t p = items_.begin(); p != items_.end(); ++p)
+      {
+         if (hasMoved(*p))
+         {
+            valid_ = false;
+            return;
+         }
+      }
+
+      for (iter_t p = hiddenItems_.begin(); p != hiddenItems_.end(); ++p)
+      {
+         if (hasMoved(*p))
+         {
+            valid_ = false;
+            return;
+         }
+      }
+   }
+
+
+
+   // - OverlayIndex::rebuild --------------------------------------------------
+   void OverlayIndex::rebuild(osg::Camera* camera, const Nodes_t& nodes,
+                              float lodScale)
+   {
+      const osg::Viewport* vp = camera->getViewport();
+
+      assert(lodScale > 0.0f && "LOD scale must be positive");
+
+      valid_ = true;
+      lodScale_ = lodScale;
+      viewport_ = vp != 0
+         ? osg::Vec4d(vp->x(), vp->y(), vp->width(), vp->height())
+         : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+      items_.clear();
+      hiddenItems_.clear();
+      cells_.clear();
+      cameras_.clear();
+      numColumns_ = 0;
+      numRows_ = 0;
+
+      const float inf = std::numeric_limits<float>::max();
+
+      float gridXMax = -inf;
+      float gridYMax = -inf;
+      gridX_ = inf;
+      gridY_ = inf;
+
+      typedef Nodes_t::const_iterator iter_t;
+      for (iter_t p = nodes.begin(); p != nodes.end(); ++p)
+      {
+         if (!p->valid())
+            continue;
+
+         // Find the first instance under the camera
+         const osg::NodePathList paths = (*p)->getParentalNodePaths();
+
+         osg::NodePathList::const_iterator path = paths.begin();
+         while (path != paths.end()
+                && (path->empty() || path->front() != camera))
+         {
+            ++path;
+         }
+
+         if (path == paths.end())
+            continue;
+
+         const osg::Camera* overlay = getOverlayCamera(*path);
+
+         Item item;
+         if (overlay == 0
+             || !PickTraversal::makeRoot(*path, item.root, lodScale_))
+         {
+            continue;
+         }
+
+         // The bounding box is in the coordinates of the node's parent
+         osg::ComputeBoundsVisitor cbv;
+         (*p)->accept(cbv);
+         const osg::BoundingBox& box = cbv.getBoundingBox();
+
+         if (!box.valid())
+            continue;
+
+         const osg::Matrixd toWindow = item.root.model * item.root.view
+            * item.root.projection * item.root.window;
+
+         item.node = *p;
+         item.bound = (*p)->getBound();
+         item.xMin = inf;
+         item.yMin = inf;
+         item.xMax = -inf;
+         item.yMax = -inf;
+         item.depth = inf;
+
+         for (unsigned i = 0; i < 8; ++i)
+         {
+            const osg::Vec3d corner = osg::Vec3d(box.corner(i)) * toWindow;
+
+            item.xMin = std::min(item.xMin, static_cast<float>(corner.x()));
+            item.yMin = std::min(item.yMin, static_cast<float>(corner.y()));
+            item.xMax = std::max(item.xMax, static_cast<float>(corner.x()));
+            item.yMax = std::max(item.yMax, static_cast<float>(corner.y()));
+            item.depth = std::min(item.depth, static_cast<float>(corner.z()));
+         }
+
+         // Clip to the overlay's viewport
+         const osg::Vec3d clipMin = osg::Vec3d(-1.0, -1.0, 0.0)
+            * item.root.window;
+         const osg::Vec3d clipMax = osg::Vec3d(1.0, 1.0, 0.0)
+            * item.root.window;
+
+         item.xMin = std::max(item.xMin, static_cast<float>(clipMin.x()));
+         item.yMin = std::max(item.yMin, static_cast<float>(clipMin.y()));
+         item.xMax = std::min(item.xMax, static_cast<float>(clipMax.x()));
+         item.yMax = std::min(item.yMax, static_cast<float>(clipMax.y()));
+
+         if (item.xMin > item.xMax || item.yMin > item.yMax)
+         {
+            hiddenItems_.push_back(item); // not visible, for now
+            continue;
+         }
+
+         items_.push_back(item);
+
+         gridX_ = std::min(gridX_, item.xMin);
+         gridY_ = std::min(gridY_, item.yMin);
+         gridXMax = std::max(gridXMax, item.xMax);
+         gridYMax = std::max(gridYMax, item.yMax);
+
+         // Remember the camera, to detect when it changes
+         std::vector<CameraState>::const_iterator state = cameras_.begin();
+         while (state != cameras_.end() && state->camera.get() != overlay)
+            ++state;
+
+         if (state == cameras_.end())
+         {
+            const osg::Viewport* overlayVP = overlay->getViewport();
+
+            CameraState newState;
+            newState.camera = overlay;
+            newState.viewMatrix = overlay->getViewMatrix();
+            newState.projectionMatrix = overlay->getProjectionMatrix();
+            newState.viewport = overlayVP != 0
+               ? osg::Vec4d(overlayVP->x(), overlayVP->y(),
+                            overlayVP->width(), overlayVP->height())
+               : osg::Vec4d(-1.0, -1.0, -1.0, -1.0);
+
+            cameras_.push_back(newState);
+         }
+      }
+
+      if (items_.empty())
+         return;
+
+      numColumns_ = std::max(
+         1, static_cast<int>(std::ceil((gridXMax - gridX_) / cellSize_)));
+      numRows_ = std::max(
+         1, static_cast<int>(std::ceil((gridYMax - gridY_) / cellSize_)));
+
+      cells_.resize(numColumns_ * numRows_);
+
+      for (std::size_t i = 0; i < items_.size(); ++i)
+      {
+         const Item& item = items_[i];
+
+         for (int row = getRow(item.yMin); row <= getRow(item.yMax); ++row)
+         {
+            for (int col = getColumn(item.xMin);
+                 col <= getColumn(item.xMax);
+                 ++col)
+            {
+               cells_[row * numColumns_ + col].push_back(i);
+            }
+         }
+      }
+   }
+
+
+
+   // - OverlayIndex::findItems ------------------------------------------------
+   void OverlayIndex::findItems(float x, float y,
+                                osg::Node::NodeMask traversalMask,
+                                Items_t& items) const
+   {
+      items.clear();
+
+      if (cells_.empty()
+          || x < gridX_ || x > gridX_ + numColumns_ * cellSize_
+          || y < gridY_ || y > gridY_ + numRows_ * cellSize_)
+      {
+         return;
+      }
+
+      const Cell_t& cell = cells_[getRow(y) * numColumns_ + getColumn(x)];
+
+      for (std::size_t i = 0; i < cell.size(); ++i)
+      {
+         const Item& item = items_[cell[i]];
+
+         if (x < item.xMin || x > item.xMax || y < item.yMin || y > item.yMax)
+            continue;
+
+         bool traversed = true;
+         for (std::size_t j = 0; j < item.root.path.size(); ++j)
+         {
+            if ((item.root.path[j]->getNodeMask() & traversalMask) == 0)
+            {
+               traversed = false;
+               break;
+            }
+         }
+
+         if (traversed)
+            items.push_back(&item);
+      }
+
+      std::stable_sort(items.begin(), items.end(), IsItemInFront);
+   }
+
+
+
+   // - OverlayIndex::getOverlayCamera -----------------------------------------
+   const osg::Camera* OverlayIndex::getOverlayCamera(
+      const osg::NodePath& path)
+   {
+      // The first node is the camera the path is viewed through, and the last
+      // one is the indexed node itself; neither counts as an overlay camera
+      for (std::size_t i = path.size() - 1; i > 1; --i)
+      {
+         const osg::Node* node = path[i-1];
+
+         if (dynamic_cast<const osg::Projection*>(node) != 0)
+            return 0;
+
+         const osg::Camera* camera = dynamic_cast<const osg::Camera*>(node);
+
+         if (camera == 0)
+            continue;
+
+         double left, right, bottom, top, zNear, zFar;
+
+         if (camera->getReferenceFrame() == osg::Transform::ABSOLUTE_RF
+             && camera->getProjectionMatrixAsOrtho(left, right, bottom, top,
+                                                   zNear, zFar))
+         {
+            return camera;
+         }
+
+         return 0;
+      }
+
+      return 0;
+   }
+
+
+
+   // - OverlayIndex::hasMoved -------------------------------------------------
+   bool OverlayIndex::hasMoved(const Item& item) const
+   {
+      if (item.node->getBound() != item.bound)
+         return true;
+
+      const osg::NodePath path(item.root.path.begin(), item.root.path.end());
+
+      PickTraversal::Root root;
+      return !PickTraversal::makeRoot(path, root, lodScale_)
+         || root.model != item.root.model;
+   }
+
+
+
+   // - OverlayIndex::getColumn ------------------------------------------------
+   int OverlayIndex::getColumn(float x) const
+   {
+      const int col = static_cast<int>(std::floor((x - gridX_) / cellSize_));
+
+      return std::min(std::max(col, 0), numColumns_ - 1);
+   }
+
+
+
+   // - OverlayIndex::getRow ---------------------------------------------------
+   int OverlayIndex::getRow(float y) const
+   {
+      const int row = static_cast<int>(std::floor((y - gridY_) / cellSize_));
+
+      return std::min(std::max(row, 0), numRows_ - 1);
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,152 @@
+/******************************************************************************\
+* PickService.cpp                                                              *
+* Picking results shared among event handlers.                                 *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/PickService.hpp>
+#include <osg/FrameStamp>
+
+
+namespace OSGUIsh
+{
+   // - PickService::PickService -----------------------------------------------
+   PickService::PickService()
+   { }
+
+
+
+   // - PickService::~PickService ----------------------------------------------
+   PickService::~PickService()
+   { }
+
+
+
+   // - PickService::pick ------------------------------------------------------
+   const PickTraversal::Hits_t& PickService::pick(
+      osg::View* view, float x, float y, osg::Node::NodeMask mask)
+   {
+      ViewData& data = getViewData(view);
+
+      typedef std::vector<CacheEntry>::const_iterator iter_t;
+      for (iter_t p = data.cache.begin(); p != data.cache.end(); ++p)
+      {
+         if (p->x == x && p->y == y && p->mask == mask)
+            return p->hits;
+      }
+
+      float cameraX = x;
+      float cameraY = y;
+      osg::Camera* camera = PickTraversal::findCamera(view, cameraX, cameraY);
+
+      traversal_.start(camera, cameraX, cameraY, mask);
+      traversal_.resume();
+
+      CacheEntry* entry;
+
+      if (data.cache.size() < CACHE_SIZE)
+      {
+         data.cache.push_back(CacheEntry());
+         entry = &data.cache.back();
+      }
+      else
+      {
+         entry = &data.cache[data.nextEntry];
+         data.nextEntry = (data.nextEntry + 1) % CACHE_SIZE;
+      }
+
+      entry->x = x;
+      entry->y = y;
+      entry->mask = mask;
+      entry->hits = traversal_.getHits();
+
+      return entry->hits;
+   }
+
+
+
+   // - PickService::publishMousePick ------------------------------------------
+   void PickService::publishMousePick(osg::View* view, float x, float y,
+                                      const PickResult& result)
+   {
+      ViewData& data = getViewData(view);
+
+      data.hasMousePick = true;
+      data.mousePick.frameNumber = data.frameNumber;
+      data.mousePick.x = x;
+      data.mousePick.y = y;
+      data.mousePick.result = result;
+   }
+
+
+
+   // - PickService::getMousePick ----------------------------------------------
+   const PickService::MousePick*
+   PickService::getMousePick(const osg::View* view) const
+   {
+      const std::map<const osg::View*, ViewData>::const_iterator p =
+         views_.find(view);
+
+      if (p == views_.end() || !p->second.hasMousePick
+          || p->second.frameNumber != getFrameNumber(view))
+      {
+         return 0;
+      }
+
+      return &p->second.mousePick;
+   }
+
+
+
+   // - PickService::markSceneDirty --------------------------------------------
+   void PickService::markSceneDirty()
+   {
+      views_.clear();
+   }
+
+
+
+   // - PickService::setLODScale -----------------------------------------------
+   void PickService::setLODScale(float scale)
+   {
+      traversal_.setLODScale(scale);
+      views_.clear();
+   }
+
+
+
+   // - PickService::getViewData -----------------------------------------------
+   PickService::ViewData& PickService::getViewData(osg::View* view)
+   {
+      const unsigned frameNumber = getFrameNumber(view);
+
+      const std::map<const osg::View*, ViewData>::iterator p =
+         views_.find(view);
+
+      if (p != views_.end() && p->second.frameNumber == frameNumber)
+         return p->second;
+
+      ViewData& data = views_[view];
+      data.frameNumber = frameNumber;
+      data.cache.clear();
+      data.nextEntry = 0;
+      data.hasMousePick = false;
+
+      return data;
+   }
+
+
+
+   // - PickService::getFrameNumber --------------------------------------------
+   unsigned PickService::getFrameNumber(const osg::View* view)
+   {
+      const osg::FrameStamp* frameStamp = view->getFrameStamp();
+      return frameStamp != 0 ? frameStamp->getFrameNumber() : 0;
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,182 @@
+/******************************************************************************\
+* PickThreadPool.cpp                                                           *
+* A small work-stealing thread pool for picking.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/PickThreadPool.hpp>
+#include <OpenThreads/ScopedLock>
+
+
+namespace OSGUIsh
+{
+   // - PickThreadPool::Worker::Worker -----------------------------------------
+   PickThreadPool::Worker::Worker(PickThreadPool& pool, std::size_t index)
+      : pool_(pool), index_(index)
+   { }
+
+
+
+   // - PickThreadPool::Worker::run --------------------------------------------
+   void PickThreadPool::Worker::run()
+   {
+      while (true)
+      {
+         Entry entry;
+         if (pool_.takeTask(index_, entry))
+         {
+            runTask(entry);
+            continue;
+         }
+
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(pool_.sleepMutex_);
+
+         while (pool_.queued_ == 0 && pool_.done_ == 0)
+            pool_.workAvailable_.wait(&pool_.sleepMutex_);
+
+         if (pool_.done_ != 0)
+            break;
+      }
+   }
+
+
+
+   // - PickThreadPool::PickThreadPool -----------------------------------------
+   PickThreadPool::PickThreadPool(unsigned numThreads)
+      : queued_(0), done_(0), nextWorker_(0)
+   {
+      // Tasks reference and unreference nodes from the worker threads
+      osg::Referenced::setThreadSafeReferenceCounting(true);
+
+      if (numThreads == 0)
+      {
+         const int numProcessors = OpenThreads::GetNumberOfProcessors();
+         numThreads = numProcessors > 1 ? numProcessors - 1 : 1;
+      }
+
+      for (unsigned i = 0; i < numThreads; ++i)
+      {
+         workers_.push_back(new Worker(*this, i));
+         workers_.back()->startThread();
+      }
+   }
+
+
+
+   // - PickThreadPool::~PickThreadPool ----------------------------------------
+   PickThreadPool::~PickThreadPool()
+   {
+      {
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sleepMutex_);
+         done_.exchange(1);
+         workAvailable_.broadcast();
+      }
+
+      typedef std::vector<Worker*>::iterator iter_t;
+      for (iter_t p = workers_.begin(); p != workers_.end(); ++p)
+      {
+         (*p)->join();
+         delete *p;
+      }
+   }
+
+
+
+   // - PickThreadPool::run ----------------------------------------------------
+   void PickThreadPool::run(const Tasks_t& tasks)
+   {
+      if (tasks.empty())
+         return;
+
+      Batch batch;
+      batch.remaining.exchange(tasks.size());
+
+      // Distribute the tasks among the workers, round robin
+      {
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(queuingMutex_);
+
+         typedef Tasks_t::const_iterator iter_t;
+         for (iter_t p = tasks.begin(); p != tasks.end(); ++p)
+         {
+            Worker& worker = *workers_[nextWorker_];
+            nextWorker_ = (nextWorker_ + 1) % workers_.size();
+
+            Entry entry = { *p, &batch };
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> queueLock(
+               worker.queueMutex);
+            worker.queue.push_back(entry);
+            ++queued_;
+         }
+      }
+
+      {
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(sleepMutex_);
+         workAvailable_.broadcast();
+      }
+
+      // Help while waiting; the calling thread has no queue, so it steals
+      Entry entry;
+      while (batch.remaining != 0 && takeTask(workers_.size(), entry))
+         runTask(entry);
+
+      batch.finished.block();
+   }
+
+
+
+   // - PickThreadPool::takeTask -----------------------------------------------
+   bool PickThreadPool::takeTask(std::size_t index, Entry& entry)
+   {
+      // Own queue first, from the back
+      if (index < workers_.size())
+      {
+         Worker& worker = *workers_[index];
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(worker.queueMutex);
+         if (!worker.queue.empty())
+         {
+            entry = worker.queue.back();
+            worker.queue.pop_back();
+            --queued_;
+            return true;
+         }
+      }
+
+      // Then steal from the front of the others
+      for (std::size_t i = 0; i < workers_.size(); ++i)
+      {
+         const std::size_t victimIndex = (index + 1 + i) % workers_.size();
+         if (victimIndex == index)
+            continue;
+
+         Worker& victim = *workers_[victimIndex];
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(victim.queueMutex);
+         if (!victim.queue.empty())
+         {
+            entry = victim.queue.front();
+            victim.queue.pop_front();
+            --queued_;
+            return true;
+         }
+      }
+
+      return false;
+   }
+
+
+
+   // - PickThreadPool::runTask ------------------------------------------------
+   void PickThreadPool::runTask(const Entry& entry)
+   {
+      entry.task->run();
+
+      if (--entry.batch->remaining == 0)
+         entry.batch->finished.release();
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,862 @@
+/******************************************************************************\
+* PickTraversal.cpp                                                            *
+* A picking traversal that can be suspended and resumed.                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/PickTraversal.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <osg/Billboard>
+#include <osg/PagedLOD>
+#include <osg/Switch>
+#include <osg/Timer>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+
+
+namespace
+{
+   /// Checks whether a window position is inside a camera's viewport.
+   bool IsInViewport(const osg::Camera& camera, float x, float y)
+   {
+      const osg::Viewport* vp = camera.getViewport();
+
+      return vp == 0
+         || (x >= vp->x() && x < vp->x() + vp->width()
+             && y >= vp->y() && y < vp->y() + vp->height());
+   }
+
+} // (anonymous) namespace
+
+
+namespace OSGUIsh
+{
+   // - PickTraversal::PickTraversal -------------------------------------------
+   PickTraversal::PickTraversal()
+      : x_(0.0f), y_(0.0f), traversalMask_(0xFFFFFFFF), ignoredNode_(0),
+        lodScale_(1.0f), running_(false)
+   {
+      // empty...
+   }
+
+
+
+   // - PickTraversal::start ---------------------------------------------------
+   void PickTraversal::start(osg::Camera* camera, float x, float y,
+                             osg::Node::NodeMask traversalMask)
+   {
+      stack_.clear();
+      hits_.clear();
+      candidates_.clear();
+
+      x_ = x;
+      y_ = y;
+      traversalMask_ = traversalMask;
+      running_ = true;
+
+      if ((camera->getNodeMask() & traversalMask_) == 0)
+         return;
+
+      osg::ref_ptr<CameraSpace> space(new CameraSpace());
+      space->view = camera->getViewMatrix();
+      space->projection = camera->getProjectionMatrix();
+      if (camera->getViewport() != 0)
+         space->window = camera->getViewport()->computeWindowMatrix();
+      space->lodScale = camera->getLODScale();
+      computeWorldSegment(*space);
+
+      osg::ref_ptr<PathLink> path(new PathLink(camera, 0));
+
+      pushChildren(*camera, path.get(), space.get(), 0);
+   }
+
+
+
+   // - PickTraversal::start ---------------------------------------------------
+   void PickTraversal::start(const Roots_t& roots, float x, float y,
+                             osg::Node::NodeMask traversalMask)
+   {
+      stack_.clear();
+      hits_.clear();
+      candidates_.clear();
+
+      x_ = x;
+      y_ = y;
+      traversalMask_ = traversalMask;
+      running_ = true;
+
+      // Pushed in reverse order, so that they are visited in the given order
+      typedef Roots_t::const_reverse_iterator iter_t;
+      for (iter_t p = roots.rbegin(); p != roots.rend(); ++p)
+      {
+         if (p->path.empty())
+            continue;
+
+         // Build the path to the root's parent, checking the node masks (the
+         // root itself is checked when visited)
+         osg::ref_ptr<PathLink> parentPath;
+         bool valid = true;
+
+         for (std::size_t i = 0; i < p->path.size() - 1; ++i)
+         {
+            if ((p->path[i]->getNodeMask() & traversalMask_) == 0)
+            {
+               valid = false;
+               break;
+            }
+
+            const osg::Camera* camera =
+               dynamic_cast<const osg::Camera*>(p->path[i].get());
+
+            if (camera != 0 && !IsInViewport(*camera, x_, y_))
+            {
+               valid = false;
+               break;
+            }
+
+            parentPath = new PathLink(p->path[i].get(), parentPath.get());
+         }
+
+         if (!valid)
+            continue;
+
+         Frame frame;
+         frame.path = new PathLink(p->path.back().get(), parentPath.get());
+         frame.space = new CameraSpace();
+         frame.space->view = p->view;
+         frame.space->projection = p->projection;
+         frame.space->window = p->window;
+         frame.space->lodScale = p->lodScale;
+         computeWorldSegment(*frame.space);
+
+         osg::Matrixd inverseModel;
+         if (!inverseModel.invert(p->model))
+            continue;
+
+         frame.model = new osg::RefMatrix(p->model);
+         frame.start = frame.space->worldStart * inverseModel;
+         frame.end = frame.space->worldEnd * inverseModel;
+
+         stack_.push_back(frame);
+      }
+   }
+
+
+
+   // - PickTraversal::makeRoot ------------------------------------------------
+   bool PickTraversal::makeRoot(const osg::NodePath& path, Root& root,
+                                float lodScale)
+   {
+      assert(lodScale > 0.0f && "LOD scale must be positive");
+
+      if (path.empty())
+         return false;
+
+      osg::Camera* camera = dynamic_cast<osg::Camera*>(path.front());
+      if (camera == 0)
+         return false;
+
+      CameraSpace space;
+      space.view = camera->getViewMatrix();
+      space.projection = camera->getProjectionMatrix();
+      if (camera->getViewport() != 0)
+         space.window = camera->getViewport()->computeWindowMatrix();
+      space.lodScale = camera->getLODScale();
+
+      osg::ref_ptr<osg::RefMatrix> model;
+
+      // Accumulate everything from the camera to the root's parent, as the
+      // traversal would do
+      for (std::size_t i = 1; i < path.size() - 1; ++i)
+      {
+         osg::Node* node = path[i];
+
+         if (osg::Camera* nested = dynamic_cast<osg::Camera*>(node))
+         {
+            enterCamera(*nested, space, model);
+         }
+         else if (osg::Projection* projection =
+                  dynamic_cast<osg::Projection*>(node))
+         {
+            space.projection = projection->getMatrix();
+         }
+         else if (osg::Transform* transform = node->asTransform())
+         {
+            model = model.valid()
+               ? new osg::RefMatrix(*model)
+               : new osg::RefMatrix();
+            transform->computeLocalToWorldMatrix(*model, 0);
+
+            if (transform->getReferenceFrame() != osg::Transform::RELATIVE_RF)
+               space.view.makeIdentity();
+         }
+         else if (osg::Switch* theSwitch = dynamic_cast<osg::Switch*>(node))
+         {
+            if (!theSwitch->getValue(theSwitch->getChildIndex(path[i+1])))
+               return false;
+         }
+         else if (osg::LOD* lod = dynamic_cast<osg::LOD*>(node))
+         {
+            std::vector<unsigned> children;
+            selectLODChildren(
+               *lod, model.valid() ? *model * space.view : space.view,
+               space.projection, space.window, space.lodScale * lodScale,
+               children);
+
+            if (std::find(children.begin(), children.end(),
+                          lod->getChildIndex(path[i+1])) == children.end())
+            {
+               return false;
+            }
+         }
+      }
+
+      root.path.assign(path.begin(), path.end());
+      root.view = space.view;
+      root.projection = space.projection;
+      root.window = space.window;
+      root.model = model.valid() ? osg::Matrixd(*model) : osg::Matrixd();
+      root.lodScale = space.lodScale;
+
+      return true;
+   }
+
+
+
+   // - PickTraversal::findCamera ----------------------------------------------
+   osg::Camera* PickTraversal::findCamera(osg::View* view, float& x, float& y)
+   {
+      osg::Camera* master = view->getCamera();
+      const osg::Viewport* masterViewport = master->getViewport();
+
+      if (view->getNumSlaves() == 0)
+         return master;
+
+      // From the master's window coordinates (its clip coordinates, if it
+      // has no viewport) to world coordinates (on the near plane), and then
+      // to each slave's window coordinates
+      osg::Matrixd masterWindow;
+      if (masterViewport != 0)
+         masterWindow = masterViewport->computeWindowMatrix();
+
+      osg::Matrixd inverseMasterVPW;
+      if (!inverseMasterVPW.invert(master->getViewMatrix()
+                                   * master->getProjectionMatrix()
+                                   * masterWindow))
+      {
+         return master;
+      }
+
+      const osg::Vec3d world = osg::Vec3d(x, y, 0.0) * inverseMasterVPW;
+
+      for (unsigned i = view->getNumSlaves(); i > 0; --i)
+      {
+         osg::Camera* slave = view->getSlave(i-1)._camera.get();
+
+         if (slave == 0 || slave->getViewport() == 0
+             || !slave->getAllowEventFocus()
+             || slave->getRenderTargetImplementation()
+                != osg::Camera::FRAME_BUFFER)
+         {
+            continue;
+         }
+
+         const osg::Vec3d window = world
+            * (slave->getViewMatrix() * slave->getProjectionMatrix()
+               * slave->getViewport()->computeWindowMatrix());
+
+         if (IsInViewport(*slave, window.x(), window.y()))
+         {
+            x = window.x();
+            y = window.y();
+            return slave;
+         }
+      }
+
+      return master;
+   }
+
+
+
+   // - PickTraversal::selectLODChildren ---------------------------------------
+   void PickTraversal::selectLODChildren(const osg::LOD& lod,
+                                         const osg::Matrixd& modelView,
+                                         const osg::Matrixd& projection,
+                                         const osg::Matrixd& window,
+                                         float lodScale,
+                                         std::vector<unsigned>& children)
+   {
+      children.clear();
+
+      double requiredRange;
+
+      if (lod.getRangeMode() == osg::LOD::DISTANCE_FROM_EYE_POINT)
+      {
+         // Distance in the LOD's coordinates, like the cull traversal
+         osg::Matrixd inverseModelView;
+         inverseModelView.invert(modelView);
+         const osg::Vec3d eye = osg::Vec3d(0.0, 0.0, 0.0) * inverseModelView;
+
+         requiredRange = (osg::Vec3d(lod.getCenter()) - eye).length()
+            * lodScale;
+      }
+      else // PIXEL_SIZE_ON_SCREEN
+      {
+         // The pixel size vector, computed just like
+         // osg::CullingSet::computePixelSizeVector() does. The window matrix
+         // holds half of the viewport size in its diagonal.
+         const osg::Matrixd& m = modelView;
+         const osg::Matrixd& p = projection;
+         const double halfWidth = window(0,0);
+         const double halfHeight = window(1,1);
+
+         const double p00 = p(0,0) * halfWidth;
+         const double p20_00 = (p(2,0) + p(2,3)) * halfWidth;
+         const osg::Vec3d scale00(m(0,0) * p00 + m(0,2) * p20_00,
+                                  m(1,0) * p00 + m(1,2) * p20_00,
+                                  m(2,0) * p00 + m(2,2) * p20_00);
+
+         const double p10 = p(1,1) * halfHeight;
+         const double p20_10 = (p(2,1) + p(2,3)) * halfHeight;
+         const osg::Vec3d scale10(m(0,1) * p10 + m(0,2) * p20_10,
+                                  m(1,1) * p10 + m(1,2) * p20_10,
+                                  m(2,1) * p10 + m(2,2) * p20_10);
+
+         const double scaleRatio = 0.7071067811
+            / std::sqrt(scale00.length2() + scale10.length2());
+
+         const double psvX = m(0,2) * p(2,3) * scaleRatio;
+         const double psvY = m(1,2) * p(2,3) * scaleRatio;
+         const double psvZ = m(2,2) * p(2,3) * scaleRatio;
+         const double psvW = (m(3,2) * p(2,3) + m(3,3) * p(3,3)) * scaleRatio;
+
+         // Then, the same as osg::CullStack::clampedPixelSize()
+         const osg::BoundingSphere& bs = lod.getBound();
+         const osg::Vec3d center(bs.center());
+
+         requiredRange = std::fabs(
+            bs.radius() / (center.x() * psvX + center.y() * psvY
+                           + center.z() * psvZ + psvW))
+            / lodScale;
+      }
+
+      bool missingChild = false;
+
+      for (unsigned i = 0; i < lod.getNumRanges(); ++i)
+      {
+         if (lod.getMinRange(i) <= requiredRange
+             && requiredRange < lod.getMaxRange(i))
+         {
+            if (i < lod.getNumChildren())
+               children.push_back(i);
+            else
+               missingChild = true;
+         }
+      }
+
+      const unsigned lastChild = lod.getNumChildren() - 1;
+
+      if (missingChild && lod.getNumChildren() > 0
+          && dynamic_cast<const osg::PagedLOD*>(&lod) != 0
+          && (children.empty() || children.back() != lastChild))
+      {
+         children.push_back(lastChild);
+      }
+   }
+
+
+
+   // - PickTraversal::getNestedLODScale ---------------------------------------
+   float PickTraversal::getNestedLODScale(const osg::Camera& camera,
+                                          float parentScale)
+   {
+      if ((camera.getInheritanceMask() & osg::CullSettings::LOD_SCALE) != 0)
+         return parentScale;
+
+      return camera.getLODScale();
+   }
+
+
+
+   // - PickTraversal::resume --------------------------------------------------
+   bool PickTraversal::resume(double timeLimit)
+   {
+      if (!running_)
+         return true;
+
+      const osg::Timer* timer = osg::Timer::instance();
+      const osg::Timer_t startTick = timer->tick();
+      bool visitedAny = false;
+
+      while (!stack_.empty())
+      {
+         if (visitedAny && timeLimit > 0.0
+             && timer->delta_s(startTick, timer->tick()) >= timeLimit)
+         {
+            return false;
+         }
+
+         const Frame frame = stack_.back();
+         stack_.pop_back();
+
+         visit(frame);
+         visitedAny = true;
+      }
+
+      std::stable_sort(hits_.begin(), hits_.end());
+      running_ = false;
+
+      return true;
+   }
+
+
+
+   // - PickTraversal::enterCamera ---------------------------------------------
+   void PickTraversal::enterCamera(const osg::Camera& camera,
+                                   CameraSpace& space,
+                                   osg::ref_ptr<osg::RefMatrix>& model)
+   {
+      if (camera.getReferenceFrame() == osg::Transform::RELATIVE_RF)
+      {
+         if (camera.getTransformOrder() == osg::Camera::POST_MULTIPLY)
+         {
+            space.projection = space.projection * camera.getProjectionMatrix();
+            space.view = space.view * camera.getViewMatrix();
+         }
+         else // pre multiply
+         {
+            space.projection = camera.getProjectionMatrix() * space.projection;
+            space.view = camera.getViewMatrix() * space.view;
+         }
+      }
+      else // an absolute camera
+      {
+         space.projection = camera.getProjectionMatrix();
+         space.view = camera.getViewMatrix();
+         model = 0;
+      }
+
+      if (camera.getViewport() != 0)
+         space.window = camera.getViewport()->computeWindowMatrix();
+
+      space.lodScale = getNestedLODScale(camera, space.lodScale);
+   }
+
+
+
+   // - PickTraversal::reset ---------------------------------------------------
+   void PickTraversal::reset()
+   {
+      stack_.clear();
+      hits_.clear();
+      candidates_.clear();
+      running_ = false;
+   }
+
+
+
+   // - PickTraversal::computeWorldSegment -------------------------------------
+   void PickTraversal::computeWorldSegment(CameraSpace& space) const
+   {
+      osg::Matrixd inverseVPW;
+      inverseVPW.invert(space.view * space.projection * space.window);
+
+      space.worldStart = osg::Vec3d(x_, y_, 0.0) * inverseVPW;
+      space.worldEnd = osg::Vec3d(x_, y_, 1.0) * inverseVPW;
+   }
+
+
+
+   // - PickTraversal::pushChildren --------------------------------------------
+   void PickTraversal::pushChildren(osg::Group& group, PathLink* path,
+                                    CameraSpace* space, osg::RefMatrix* model,
+                                    const osg::Vec3d& start,
+                                    const osg::Vec3d& end)
+   {
+      osg::Switch* theSwitch = dynamic_cast<osg::Switch*>(&group);
+
+      // Pushed in reverse order, so that they are visited in the usual order
+      for (unsigned i = group.getNumChildren(); i > 0; --i)
+      {
+         if (theSwitch != 0 && !theSwitch->getValue(i-1))
+            continue;
+
+         Frame frame;
+         frame.path = new PathLink(group.getChild(i-1), path);
+         frame.space = space;
+         frame.model = model;
+         frame.start = start;
+         frame.end = end;
+
+         stack_.push_back(frame);
+      }
+   }
+
+
+
+   // - PickTraversal::pushChildren --------------------------------------------
+   void PickTraversal::pushChildren(osg::Group& group, PathLink* path,
+                                    CameraSpace* space, osg::RefMatrix* model)
+   {
+      if (model == 0)
+      {
+         pushChildren(group, path, space, model,
+                      space->worldStart, space->worldEnd);
+      }
+      else
+      {
+         osg::Matrixd inverseModel;
+         if (!inverseModel.invert(*model))
+            return; // singular matrix, nothing under it can be picked
+
+         pushChildren(group, path, space, model,
+                      space->worldStart * inverseModel,
+                      space->worldEnd * inverseModel);
+      }
+   }
+
+
+
+   // - PickTraversal::visit ---------------------------------------------------
+   void PickTraversal::visit(const Frame& frame)
+   {
+      osg::Node& node = *frame.path->node;
+
+      if ((node.getNodeMask() & traversalMask_) == 0 || &node == ignoredNode_)
+         return;
+
+      // Cameras and projections change the coordinate system in ways that
+      // make the bounding sphere test meaningless here
+      if (osg::Camera* camera = dynamic_cast<osg::Camera*>(&node))
+      {
+         visitCamera(frame, *camera);
+         return;
+      }
+
+      if (osg::Projection* projection = dynamic_cast<osg::Projection*>(&node))
+      {
+         visitProjection(frame, *projection);
+         return;
+      }
+
+      osg::Transform* transform = node.asTransform();
+
+      const bool isAbsolute = transform != 0
+         && transform->getReferenceFrame() != osg::Transform::RELATIVE_RF;
+
+      if (!isAbsolute && !intersects(node.getBound(), frame.start, frame.end))
+         return;
+
+      if (osg::Geode* geode = dynamic_cast<osg::Geode*>(&node))
+      {
+         intersectGeode(frame, *geode);
+      }
+      else if (osg::LOD* lod = dynamic_cast<osg::LOD*>(&node))
+      {
+         visitLOD(frame, *lod);
+      }
+      else if (transform != 0)
+      {
+         osg::ref_ptr<osg::RefMatrix> model(
+            frame.model.valid()
+            ? new osg::RefMatrix(*frame.model)
+            : new osg::RefMatrix());
+
+         transform->computeLocalToWorldMatrix(*model, 0);
+
+         // Like osgUtil::IntersectionVisitor, absolute transforms replace
+         // the view matrix with an identity, too
+         osg::ref_ptr<CameraSpace> space(frame.space);
+
+         if (isAbsolute)
+         {
+            space = new CameraSpace(*frame.space);
+            space->view.makeIdentity();
+            computeWorldSegment(*space);
+         }
+
+         pushChildren(*transform, frame.path.get(), space.get(), model.get());
+      }
+      else if (osg::Group* group = node.asGroup())
+      {
+         pushChildren(*group, frame.path.get(), frame.space.get(),
+                      frame.model.get(), frame.start, frame.end);
+      }
+   }
+
+
+
+   // - PickTraversal::visitCamera ---------------------------------------------
+   void PickTraversal::visitCamera(const Frame& frame, osg::Camera& camera)
+   {
+      // Render to texture cameras show nothing at the picked position, and
+      // insets show nothing outside their viewports
+      if (camera.getRenderTargetImplementation() != osg::Camera::FRAME_BUFFER
+          || !IsInViewport(camera, x_, y_))
+      {
+         return;
+      }
+
+      osg::ref_ptr<CameraSpace> space(new CameraSpace(*frame.space));
+      osg::ref_ptr<osg::RefMatrix> model(frame.model);
+
+      enterCamera(camera, *space, model);
+      computeWorldSegment(*space);
+
+      pushChildren(camera, frame.path.get(), space.get(), model.get());
+   }
+
+
+
+   // - PickTraversal::visitLOD ------------------------------------------------
+   void PickTraversal::visitLOD(const Frame& frame, osg::LOD& lod)
+   {
+      const CameraSpace& space = *frame.space;
+
+      std::vector<unsigned> children;
+      selectLODChildren(
+         lod, frame.model.valid() ? *frame.model * space.view : space.view,
+         space.projection, space.window, space.lodScale * lodScale_,
+         children);
+
+      // Pushed in reverse order, so that they are visited in the usual order
+      for (std::size_t i = children.size(); i > 0; --i)
+      {
+         Frame child;
+         child.path = new PathLink(lod.getChild(children[i-1]),
+                                   frame.path.get());
+         child.space = frame.space;
+         child.model = frame.model;
+         child.start = frame.start;
+         child.end = frame.end;
+
+         stack_.push_back(child);
+      }
+   }
+
+
+
+   // - PickTraversal::visitProjection -----------------------------------------
+   void PickTraversal::visitProjection(const Frame& frame,
+                                       osg::Projection& projection)
+   {
+      osg::ref_ptr<CameraSpace> space(new CameraSpace(*frame.space));
+      space->projection = projection.getMatrix();
+
+      computeWorldSegment(*space);
+
+      pushChildren(projection, frame.path.get(), space.get(),
+                   frame.model.get());
+   }
+
+
+
+   // - PickTraversal::intersectGeode ------------------------------------------
+   void PickTraversal::intersectGeode(const Frame& frame, osg::Geode& geode)
+   {
+      const bool isBillboard = dynamic_cast<osg::Billboard*>(&geode) != 0;
+
+      // Capture what intersectCandidates() needs; nothing in it will change
+      // along with the scene graph
+      if (triangleCache_.valid() && !isBillboard)
+      {
+         candidates_.push_back(Candidate());
+
+         Candidate& candidate = candidates_.back();
+         candidate.nodePath = makeNodePath(frame.path.get());
+         candidate.pathRef = frame.path.get();
+         candidate.model = frame.model;
+         candidate.start = frame.start;
+         candidate.end = frame.end;
+
+         for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
+         {
+            candidate.triangles.push_back(
+               triangleCache_->get(*geode.getDrawable(i)));
+         }
+
+         return;
+      }
+
+      // The segment is already in the Geode's coordinates, so this is a
+      // simple MODEL coordinates intersection, with no matrices involved
+      osg::ref_ptr<osgUtil::LineSegmentIntersector> picker(
+         new osgUtil::LineSegmentIntersector(frame.start, frame.end));
+
+      osgUtil::IntersectionVisitor iv(picker.get());
+      iv.setTraversalMask(traversalMask_);
+
+      // No matrices are pushed, so billboards need to be told where the eye
+      // is, in the Geode's coordinates
+      if (isBillboard)
+      {
+         osg::Matrixd inverseModelView;
+         inverseModelView.invert(
+            frame.model.valid()
+            ? *frame.model * frame.space->view
+            : frame.space->view);
+
+         iv.setReferenceEyePoint(osg::Vec3d(0.0, 0.0, 0.0) * inverseModelView);
+         iv.setReferenceEyePointCoordinateFrame(osgUtil::Intersector::MODEL);
+      }
+
+      geode.accept(iv);
+
+      const osgUtil::LineSegmentIntersector::Intersections& hitList =
+         picker->getIntersections();
+
+      if (hitList.empty())
+         return;
+
+      const osg::NodePath nodePath = makeNodePath(frame.path.get());
+
+      osg::Matrixd inverseModel;
+      if (frame.model.valid())
+         inverseModel.invert(*frame.model);
+
+      typedef osgUtil::LineSegmentIntersector::Intersections::const_iterator
+         iter_t;
+
+      for (iter_t p = hitList.begin(); p != hitList.end(); ++p)
+      {
+         Hit hit;
+         hit.ratio = p->ratio;
+         hit.pathRef = frame.path.get();
+
+         Intersection_t& i = hit.intersection;
+         i.nodePath = nodePath;
+         i.localIntersectionPoint = p->localIntersectionPoint;
+         i.localIntersectionNormal = p->localIntersectionNormal;
+
+         if (frame.model.valid())
+         {
+            i.worldIntersectionPoint =
+               i.localIntersectionPoint * (*frame.model);
+            i.worldIntersectionNormal = osg::Matrixd::transform3x3(
+               inverseModel, i.localIntersectionNormal);
+            i.worldIntersectionNormal.normalize();
+         }
+         else
+         {
+            i.worldIntersectionPoint = i.localIntersectionPoint;
+            i.worldIntersectionNormal = i.localIntersectionNormal;
+         }
+
+         hits_.push_back(hit);
+      }
+   }
+
+
+
+   // - PickTraversal::intersectCandidates -------------------------------------
+   void PickTraversal::intersectCandidates(const Candidates_t& candidates,
+                                           bool cullBackFaces, Hits_t& hits)
+   {
+      typedef Candidates_t::const_iterator iter_t;
+      for (iter_t p = candidates.begin(); p != candidates.end(); ++p)
+      {
+         osg::Matrixd inverseModel;
+         if (p->model.valid())
+            inverseModel.invert(*p->model);
+
+         for (std::size_t d = 0; d < p->triangles.size(); ++d)
+         {
+            const TriangleCache::Triangles& triangles = *p->triangles[d];
+
+            float ratio = 1.0f;
+            const std::size_t tri =
+               triangles.intersect(p->start, p->end, cullBackFaces, ratio);
+
+            if (tri == triangles.size())
+               continue;
+
+            Hit hit;
+            hit.ratio = ratio;
+            hit.pathRef = p->pathRef;
+
+            Intersection_t& i = hit.intersection;
+            i.nodePath = p->nodePath;
+            i.localIntersectionPoint = p->start + (p->end - p->start) * ratio;
+            i.localIntersectionNormal = triangles.getNormal(tri);
+            i.localIntersectionNormal.normalize();
+
+            if (p->model.valid())
+            {
+               i.worldIntersectionPoint =
+                  i.localIntersectionPoint * (*p->model);
+               i.worldIntersectionNormal = osg::Matrixd::transform3x3(
+                  inverseModel, i.localIntersectionNormal);
+               i.worldIntersectionNormal.normalize();
+            }
+            else
+            {
+               i.worldIntersectionPoint = i.localIntersectionPoint;
+               i.worldIntersectionNormal = i.localIntersectionNormal;
+            }
+
+            hits.push_back(hit);
+         }
+      }
+   }
+
+
+
+   // - PickTraversal::makeNodePath --------------------------------------------
+   osg::NodePath PickTraversal::makeNodePath(const PathLink* path)
+   {
+      osg::NodePath nodePath;
+
+      for (const PathLink* p = path; p != 0; p = p->parent.get())
+         nodePath.push_back(p->node.get());
+
+      std::reverse(nodePath.begin(), nodePath.end());
+
+      return nodePath;
+   }
+
+
+
+   // - PickTraversal::intersects ----------------------------------------------
+   bool PickTraversal::intersects(const osg::BoundingSphere& bs,
+                                  const osg::Vec3d& start,
+                                  const osg::Vec3d& end)
+   {
+      // Same test used by osgUtil::LineSegmentIntersector
+      if (!bs.valid())
+         return true;
+
+      const osg::Vec3d sm = start - osg::Vec3d(bs.center());
+      const double c = sm.length2() - bs.radius2();
+      if (c < 0.0)
+         return true;
+
+      const osg::Vec3d se = end - start;
+      const double a = se.length2();
+      const double b = (sm * se) * 2.0;
+      double d = b*b - 4.0*a*c;
+      if (d < 0.0)
+         return false;
+
+      d = std::sqrt(d);
+
+      const double div = 1.0 / (2.0*a);
+      const double r1 = (-b-d) * div;
+      const double r2 = (-b+d) * div;
+
+      if (r1 <= 0.0 && r2 <= 0.0)
+         return false;
+
+      if (r1 >= 1.0 && r2 >= 1.0)
+         return false;
+
+      return true;
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,31 @@
+/******************************************************************************\
+* PointerSource.cpp                                                            *
+* Sources of pointing rays other than the mouse.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/PointerSource.hpp>
+
+
+namespace OSGUIsh
+{
+   // - PointerSource::~PointerSource ------------------------------------------
+   PointerSource::~PointerSource()
+   {
+      // empty...
+   }
+
+
+
+   // - PointerSource::getButtonMask -------------------------------------------
+   unsigned PointerSource::getButtonMask()
+   {
+      return 0;
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,52 @@
+/******************************************************************************\
+* RayPointerSource.cpp                                                         *
+* A pointer source whose segment and buttons are set explicitly.               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/RayPointerSource.hpp>
+
+
+namespace OSGUIsh
+{
+   // - RayPointerSource::RayPointerSource -------------------------------------
+   RayPointerSource::RayPointerSource()
+      : active_(false), buttonMask_(0)
+   {
+      // empty...
+   }
+
+
+
+   // - RayPointerSource::setSegment -------------------------------------------
+   void RayPointerSource::setSegment(const osg::Vec3d& start,
+                                     const osg::Vec3d& end)
+   {
+      segment_ = BatchPickTraversal::Segment(start, end);
+      active_ = true;
+   }
+
+
+
+   // - RayPointerSource::getSegment -------------------------------------------
+   bool RayPointerSource::getSegment(osg::View*, const osgGA::GUIEventAdapter&,
+                                     BatchPickTraversal::Segment& segment)
+   {
+      segment = segment_;
+      return active_;
+   }
+
+
+
+   // - RayPointerSource::getButtonMask ----------------------------------------
+   unsigned RayPointerSource::getButtonMask()
+   {
+      return buttonMask_;
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,577 @@
+/******************************************************************************\
+* RegionSelector.cpp                                                           *
+* Finds the registered nodes inside a rectangle or lasso.                      *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/RegionSelector.hpp>
+#include <algorithm>
+#include <cmath>
+#include <set>
+#include <osg/Geode>
+#include <osg/NodeVisitor>
+#include <osg/Projection>
+#include <osg/TriangleFunctor>
+#include <OSGUIsh/PickTraversal.hpp>
+
+
+namespace
+{
+   /**
+    * Returns the orientation of the triangle formed by three points: positive
+    * if counterclockwise, negative if clockwise, zero if collinear.
+    */
+   float Orientation(const osg::Vec2& a, const osg::Vec2& b,
+                     const osg::Vec2& c)
+   {
+      return (b.x() - a.x()) * (c.y() - a.y())
+         - (b.y() - a.y()) * (c.x() - a.x());
+   }
+
+
+
+   /// Checks whether two line segments (\c a0 to \c a1, \c b0 to \c b1) cross.
+   bool SegmentsCross(const osg::Vec2& a0, const osg::Vec2& a1,
+                      const osg::Vec2& b0, const osg::Vec2& b1)
+   {
+      const float o0 = Orientation(a0, a1, b0);
+      const float o1 = Orientation(a0, a1, b1);
+      const float o2 = Orientation(b0, b1, a0);
+      const float o3 = Orientation(b0, b1, a1);
+
+      return ((o0 > 0.0f) != (o1 > 0.0f)) && ((o2 > 0.0f) != (o3 > 0.0f));
+   }
+
+
+
+   /// Returns the signed distance from a point to a plane (both homogeneous).
+   double Distance(const osg::Vec4d& plane, const osg::Vec4d& point)
+   {
+      return plane.x() * point.x() + plane.y() * point.y()
+         + plane.z() * point.z() + plane.w() * point.w();
+   }
+
+} // (anonymous) namespace
+
+
+namespace OSGUIsh
+{
+   /**
+    * A visitor that checks whether any triangle of a subgraph is inside the
+    * region of a \c RegionSelector. Subgraphs whose bounding spheres are
+    * entirely inside or outside the region sub-frustum are not traversed.
+    */
+   class RegionSelector::TriangleTest: public osg::NodeVisitor
+   {
+      public:
+         TriangleTest(const RegionSelector& selector,
+                      const osg::Matrixd& toWindow)
+            : osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+              selector_(selector), toWindow_(toWindow), found_(false)
+         {
+            setTraversalMask(selector.traversalMask_);
+            triangles_.test = this;
+         }
+
+         /// Was any triangle found inside the region?
+         bool found() const { return found_; }
+
+         virtual void apply(osg::Node& node)
+         {
+            if (enter(node))
+               traverse(node);
+         }
+
+         virtual void apply(osg::Transform& transform)
+         {
+            // Nested cameras used for HUDs are in a different space
+            if (transform.getReferenceFrame() != osg::Transform::RELATIVE_RF
+                || !enter(transform))
+            {
+               return;
+            }
+
+            osg::Matrixd localToParent;
+            transform.computeLocalToWorldMatrix(localToParent, this);
+
+            const osg::Matrixd savedToWindow = toWindow_;
+            toWindow_ = localToParent * toWindow_;
+            traverse(transform);
+            toWindow_ = savedToWindow;
+         }
+
+         virtual void apply(osg::Projection&)
+         {
+            // Not under this camera's projection; ignore it
+         }
+
+         virtual void apply(osg::Geode& geode)
+         {
+            if (!enter(geode))
+               return;
+
+            for (unsigned i = 0; i < geode.getNumDrawables() && !found_; ++i)
+               geode.getDrawable(i)->accept(triangles_);
+         }
+
+      private:
+         /// Tests the triangles given by an \c osg::TriangleFunctor.
+         struct Triangles
+         {
+            void operator()(const osg::Vec3& v0, const osg::Vec3& v1,
+                            const osg::Vec3& v2)
+            {
+               if (test->found_)
+                  return;
+
+               const osg::Matrixd& m = test->toWindow_;
+
+               test->found_ = test->selector_.overlaps(
+                  osg::Vec4d(v0.x(), v0.y(), v0.z(), 1.0) * m,
+                  osg::Vec4d(v1.x(), v1.y(), v1.z(), 1.0) * m,
+                  osg::Vec4d(v2.x(), v2.y(), v2.z(), 1.0) * m);
+            }
+
+            void operator()(const osg::Vec3& v0, const osg::Vec3& v1,
+                            const osg::Vec3& v2, bool)
+            { (*this)(v0, v1, v2); }
+
+            TriangleTest* test;
+         };
+
+         /**
+          * Classifies a node bounding sphere, deciding whether it must be
+          * traversed. Nodes entirely inside the region sub-frustum are
+          * considered found without further tests.
+          */
+         bool enter(const osg::Node& node)
+         {
+            if (found_)
+               return false;
+
+            switch (selector_.classify(node.getBound(), toWindow_))
+            {
+               case INSIDE:
+                  found_ = true;
+                  return false;
+
+               case OUTSIDE:
+                  return false;
+
+               default:
+                  return true;
+            }
+         }
+
+         const RegionSelector& selector_;
+         osg::Matrixd toWindow_;
+         bool found_;
+         osg::TriangleFunctor<Triangles> triangles_;
+   };
+
+
+
+   // - RegionSelector::RegionSelector -----------------------------------------
+   RegionSelector::RegionSelector()
+      : traversalMask_(0xFFFFFFFF), hasRegion_(false)
+   { }
+
+
+
+   // - RegionSelector::setCandidates ------------------------------------------
+   void RegionSelector::setCandidates(osg::Camera* camera,
+                                      const Nodes_t& nodes,
+                                      osg::Node::NodeMask traversalMask,
+                                      Nodes_t& removed)
+   {
+      removed.clear();
+
+      std::set<osg::Node*> selected;
+
+      typedef Candidates_t::const_iterator candIter_t;
+      for (candIter_t p = candidates_.begin(); p != candidates_.end(); ++p)
+      {
+         if (p->selected)
+            selected.insert(p->node.get());
+      }
+
+      candidates_.clear();
+      candidates_.reserve(nodes.size());
+
+      typedef Nodes_t::const_iterator iter_t;
+      for (iter_t p = nodes.begin(); p != nodes.end(); ++p)
+      {
+         if (!p->valid())
+            continue;
+
+         Candidate candidate;
+         candidate.node = *p;
+         candidate.selected = selected.erase(p->get()) > 0;
+
+         const osg::NodePathList paths = (*p)->getParentalNodePaths();
+
+         typedef osg::NodePathList::const_iterator pathIter_t;
+         for (pathIter_t path = paths.begin(); path != paths.end(); ++path)
+         {
+            PickTraversal::Root root;
+            if (path->empty() || path->front() != camera
+                || !PickTraversal::makeRoot(*path, root))
+            {
+               continue;
+            }
+
+            candidate.toWindow.push_back(
+               root.model * root.view * root.projection * root.window);
+         }
+
+         candidates_.push_back(candidate);
+      }
+
+      // Selected nodes that are no longer candidates leave the selection
+      removed.assign(selected.begin(), selected.end());
+
+      traversalMask_ = traversalMask;
+
+      // The placement of the candidates may have changed, so the next
+      // update cannot be incremental
+      hasRegion_ = false;
+   }
+
+
+
+   // - RegionSelector::selectRectangle ----------------------------------------
+   void RegionSelector::selectRectangle(const osg::Vec2& corner1,
+                                        const osg::Vec2& corner2,
+                                        Nodes_t& added, Nodes_t& removed)
+   {
+      Region region;
+      region.xMin = std::min(corner1.x(), corner2.x());
+      region.xMax = std::max(corner1.x(), corner2.x());
+      region.yMin = std::min(corner1.y(), corner2.y());
+      region.yMax = std::max(corner1.y(), corner2.y());
+
+      bool testSelected = true;
+      bool testUnselected = true;
+
+      // Nodes touching a rectangle also touch any rectangle containing it
+      if (hasRegion_ && region_.lasso.empty())
+      {
+         const bool grows = region.xMin <= region_.xMin
+            && region.xMax >= region_.xMax
+            && region.yMin <= region_.yMin
+            && region.yMax >= region_.yMax;
+
+         const bool shrinks = region.xMin >= region_.xMin
+            && region.xMax <= region_.xMax
+            && region.yMin >= region_.yMin
+            && region.yMax <= region_.yMax;
+
+         testSelected = !grows;
+         testUnselected = !shrinks;
+      }
+
+      select(region, testSelected, testUnselected, added, removed);
+   }
+
+
+
+   // - RegionSelector::selectLasso --------------------------------------------
+   void RegionSelector::selectLasso(const Polygon_t& lasso,
+                                    Nodes_t& added, Nodes_t& removed)
+   {
+      Region region;
+      region.lasso = lasso;
+
+      if (lasso.size() < 3)
+      {
+         // Not a polygon yet; an empty bounding rectangle selects nothing
+         region.xMin = region.xMax = region.yMin = region.yMax = 0.0f;
+      }
+      else
+      {
+         region.xMin = region.xMax = lasso[0].x();
+         region.yMin = region.yMax = lasso[0].y();
+
+         typedef Polygon_t::const_iterator iter_t;
+         for (iter_t p = lasso.begin(); p != lasso.end(); ++p)
+         {
+            region.xMin = std::min(region.xMin, p->x());
+            region.xMax = std::max(region.xMax, p->x());
+            region.yMin = std::min(region.yMin, p->y());
+            region.yMax = std::max(region.yMax, p->y());
+         }
+      }
+
+      select(region, true, true, added, removed);
+   }
+
+
+
+   // - RegionSelector::clear --------------------------------------------------
+   void RegionSelector::clear(Nodes_t& removed)
+   {
+      removed.clear();
+
+      typedef Candidates_t::iterator iter_t;
+      for (iter_t p = candidates_.begin(); p != candidates_.end(); ++p)
+      {
+         if (p->selected)
+         {
+            p->selected = false;
+            removed.push_back(p->node);
+         }
+      }
+
+      hasRegion_ = false;
+   }
+
+
+
+   // - RegionSelector::getSelection -------------------------------------------
+   void RegionSelector::getSelection(Nodes_t& selection) const
+   {
+      selection.clear();
+
+      typedef Candidates_t::const_iterator iter_t;
+      for (iter_t p = candidates_.begin(); p != candidates_.end(); ++p)
+      {
+         if (p->selected)
+            selection.push_back(p->node);
+      }
+   }
+
+
+
+   // - RegionSelector::select -------------------------------------------------
+   void RegionSelector::select(const Region& region, bool testSelected,
+                               bool testUnselected,
+                               Nodes_t& added, Nodes_t& removed)
+   {
+      added.clear();
+      removed.clear();
+
+      region_ = region;
+      hasRegion_ = true;
+
+      // The sub-frustum, in homogeneous window coordinates: x >= xMin * w,
+      // x <= xMax * w, and so on; 0 <= z <= w bounds the depth range
+      planes_[0] = osg::Vec4d(1.0, 0.0, 0.0, -region.xMin);
+      planes_[1] = osg::Vec4d(-1.0, 0.0, 0.0, region.xMax);
+      planes_[2] = osg::Vec4d(0.0, 1.0, 0.0, -region.yMin);
+      planes_[3] = osg::Vec4d(0.0, -1.0, 0.0, region.yMax);
+      planes_[4] = osg::Vec4d(0.0, 0.0, 1.0, 0.0);
+      planes_[5] = osg::Vec4d(0.0, 0.0, -1.0, 1.0);
+
+      typedef Candidates_t::iterator iter_t;
+      for (iter_t p = candidates_.begin(); p != candidates_.end(); ++p)
+      {
+         if (p->selected ? !testSelected : !testUnselected)
+            continue;
+
+         const bool inside = isInside(*p);
+
+         if (inside != p->selected)
+         {
+            p->selected = inside;
+            (inside ? added : removed).push_back(p->node);
+         }
+      }
+   }
+
+
+
+   // - RegionSelector::isInside -----------------------------------------------
+   bool RegionSelector::isInside(const Candidate& candidate) const
+   {
+      if ((candidate.node->getNodeMask() & traversalMask_) == 0)
+         return false;
+
+      typedef std::vector<osg::Matrixd>::const_iterator iter_t;
+      for (iter_t p = candidate.toWindow.begin();
+           p != candidate.toWindow.end();
+           ++p)
+      {
+         switch (classify(candidate.node->getBound(), *p))
+         {
+            case INSIDE:
+               return true;
+
+            case OUTSIDE:
+               break;
+
+            case BOUNDARY:
+            {
+               TriangleTest test(*this, *p);
+               candidate.node->accept(test);
+               if (test.found())
+                  return true;
+               break;
+            }
+         }
+      }
+
+      return false;
+   }
+
+
+
+   // - RegionSelector::classify -----------------------------------------------
+   RegionSelector::Classification RegionSelector::classify(
+      const osg::BoundingSphere& bs, const osg::Matrixd& toWindow) const
+   {
+      if (!bs.valid())
+         return OUTSIDE;
+
+      Classification result = INSIDE;
+
+      for (int i = 0; i < 6; ++i)
+      {
+         // The plane in the bounding sphere coordinates
+         const osg::Vec4d plane = toWindow * planes_[i];
+
+         const double length = std::sqrt(plane.x() * plane.x()
+                                         + plane.y() * plane.y()
+                                         + plane.z() * plane.z());
+         if (length == 0.0)
+         {
+            result = BOUNDARY;
+            continue;
+         }
+
+         const double distance = Distance(
+            plane, osg::Vec4d(bs.center().x(), bs.center().y(),
+                              bs.center().z(), 1.0)) / length;
+
+         if (distance < -bs.radius())
+            return OUTSIDE;
+         else if (distance < bs.radius())
+            result = BOUNDARY;
+      }
+
+      // Inside the sub-frustum of the bounding rectangle is not necessarily
+      // inside a lasso
+      if (result == INSIDE && !region_.lasso.empty())
+         result = BOUNDARY;
+
+      return result;
+   }
+
+
+
+   // - RegionSelector::overlaps -----------------------------------------------
+   bool RegionSelector::overlaps(const osg::Vec4d& v0, const osg::Vec4d& v1,
+                                 const osg::Vec4d& v2) const
+   {
+      // Clip the triangle against the sub-frustum
+      std::vector<osg::Vec4d> polygon;
+      polygon.reserve(9);
+      polygon.push_back(v0);
+      polygon.push_back(v1);
+      polygon.push_back(v2);
+
+      std::vector<osg::Vec4d> clipped;
+      clipped.reserve(9);
+
+      for (int i = 0; i < 6 && !polygon.empty(); ++i)
+      {
+         clipped.clear();
+
+         for (std::size_t j = 0; j < polygon.size(); ++j)
+         {
+            const osg::Vec4d& a = polygon[j];
+            const osg::Vec4d& b = polygon[(j + 1) % polygon.size()];
+            const double da = Distance(planes_[i], a);
+            const double db = Distance(planes_[i], b);
+
+            if (da >= 0.0)
+               clipped.push_back(a);
+
+            if ((da >= 0.0) != (db >= 0.0))
+            {
+               const double t = da / (da - db);
+               clipped.push_back(osg::Vec4d(a.x() + (b.x() - a.x()) * t,
+                                            a.y() + (b.y() - a.y()) * t,
+                                            a.z() + (b.z() - a.z()) * t,
+                                            a.w() + (b.w() - a.w()) * t));
+            }
+         }
+
+         polygon.swap(clipped);
+      }
+
+      if (polygon.empty())
+         return false;
+
+      // For a rectangle, the sub-frustum is exactly the region
+      if (region_.lasso.empty())
+         return true;
+
+      // For a lasso, compare the clipped triangle (a convex polygon) with the
+      // lasso, in window coordinates
+      Polygon_t projected;
+      projected.reserve(polygon.size());
+
+      typedef std::vector<osg::Vec4d>::const_iterator iter_t;
+      for (iter_t p = polygon.begin(); p != polygon.end(); ++p)
+      {
+         if (p->w() <= 0.0)
+            return false; // degenerate region
+
+         projected.push_back(osg::Vec2(p->x() / p->w(), p->y() / p->w()));
+
+         if (isInPolygon(projected.back(), region_.lasso))
+            return true;
+      }
+
+      const Polygon_t& lasso = region_.lasso;
+
+      if (projected.size() >= 3 && isInPolygon(lasso[0], projected))
+         return true;
+
+      for (std::size_t i = 0; i < projected.size(); ++i)
+      {
+         const osg::Vec2& a0 = projected[i];
+         const osg::Vec2& a1 = projected[(i + 1) % projected.size()];
+
+         for (std::size_t j = 0; j < lasso.size(); ++j)
+         {
+            if (SegmentsCross(a0, a1, lasso[j], lasso[(j + 1) % lasso.size()]))
+               return true;
+         }
+      }
+
+      return false;
+   }
+
+
+
+   // - RegionSelector::isInPolygon --------------------------------------------
+   bool RegionSelector::isInPolygon(const osg::Vec2& point,
+                                    const Polygon_t& polygon)
+   {
+      bool inside = false;
+
+      for (std::size_t i = 0, j = polygon.size() - 1;
+           i < polygon.size();
+           j = i++)
+      {
+         const osg::Vec2& a = polygon[i];
+         const osg::Vec2& b = polygon[j];
+
+         if ((a.y() > point.y()) != (b.y() > point.y())
+             && point.x() < (b.x() - a.x()) * (point.y() - a.y())
+                / (b.y() - a.y()) + a.x())
+         {
+            inside = !inside;
+         }
+      }
+
+      return inside;
+   }
+
+} // namespace OSGUIsh
@@ -0,0 +1,137 @@
+/******************************************************************************\
+* TimerWheel.cpp                                                               *
+* A hashed timing wheel.                                                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/TimerWheel.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+
+namespace OSGUIsh
+{
+   // - TimerWheel::TimerWheel -------------------------------------------------
+   TimerWheel::TimerWheel(double resolution, std::size_t numSlots)
+      : resolution_(resolution), slots_(numSlots), numEntries_(0),
+        currentTick_(0)
+   {
+      assert(resolution_ > 0.0 && "Timer wheel resolution must be positive");
+      assert(numSlots > 0 && "Timer wheel must have at least one slot");
+   }
+
+
+
+   // - TimerWheel::schedule ---------------------------------------------------
+   void TimerWheel::schedule(TimerId id, double time)
+   {
+      pending_[id] = time;
+
+      // Timers in the past go to the current slot, which is the first one
+      // visited by the next advance()
+      const long tick = std::max(getTick(time), currentTick_);
+
+      Entry entry = { id, time };
+      slots_[tick % slots_.size()].push_back(entry);
+      ++numEntries_;
+   }
+
+
+
+   // - TimerWheel::cancel -----------------------------------------------------
+   void TimerWheel::cancel(TimerId id)
+   {
+      // The slot entry is discarded when the slot is visited
+      pending_.erase(id);
+   }
+
+
+
+   // - TimerWheel::advance ----------------------------------------------------
+   void TimerWheel::advance(double now, TimerIds_t& expired)
+   {
+      expired.clear();
+
+      const long nowTick = std::max(getTick(now), currentTick_);
+
+      if (pending_.empty())
+      {
+         // Nothing to do; but canceled entries may still be lying around
+         if (numEntries_ > 0)
+         {
+            for (std::size_t i = 0; i < slots_.size(); ++i)
+               slots_[i].clear();
+
+            numEntries_ = 0;
+         }
+
+         currentTick_ = nowTick;
+         return;
+      }
+
+      // Visit the slots from the last tick to this one, but each one at most
+      // once (if more than a full turn has elapsed)
+      const long lastTick =
+         std::min(nowTick, currentTick_
+                  + static_cast<long>(slots_.size()) - 1);
+
+      std::vector< std::pair<double, TimerId> > due;
+
+      for (long tick = currentTick_; tick <= lastTick; ++tick)
+      {
+         Slot_t& slot = slots_[tick % slots_.size()];
+
+         for (std::size_t i = 0; i < slot.size(); )
+         {
+            const std::map<TimerId, double>::iterator p =
+               pending_.find(slot[i].id);
+
+            const bool isStale = p == pending_.end()
+               || p->second != slot[i].time;
+
+            if (!isStale && slot[i].time > now)
+            {
+               ++i; // for a later turn
+               continue;
+            }
+
+            if (!isStale)
+            {
+               due.push_back(std::make_pair(slot[i].time, slot[i].id));
+               pending_.erase(p);
+            }
+
+            slot[i] = slot.back();
+            slot.pop_back();
+            --numEntries_;
+         }
+      }
+
+      currentTick_ = nowTick;
+
+      std::stable_sort(due.begin(), due.end());
+
+      expired.reserve(due.size());
+      for (std::size_t i = 0; i < due.size(); ++i)
+         expired.push_back(due[i].second);
+   }
+
+
+
+   // - TimerWheel::getTick ----------------------------------------------------
+   long TimerWheel::getTick(double time) const
+   {
+      // Event times are not negative; but just in case...
+      return time > 0.0
+         ? static_cast<long>(std::floor(time / resolution_))
+         : 0;
+   }
+
+} // namespace OSGUIsh
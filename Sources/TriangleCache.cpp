@@ -0,0 +1,301 @@
+/******************************************************************************\
+* TriangleCache.cpp                                                            *
+* A cache of the triangles of drawables, laid out for fast intersection.       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#include <OSGUIsh/TriangleCache.hpp>
+#include <osg/Geometry>
+#include <osg/TriangleFunctor>
+#include <OpenThreads/ScopedLock>
+
+#if defined(__SSE__) || defined(_M_X64) \
+   || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#  define OSGUISH_USE_SSE
+#  include <xmmintrin.h>
+#endif
+
+
+namespace OSGUIsh
+{
+   // - TriangleCache::Triangles::operator() -----------------------------------
+   void TriangleCache::Triangles::operator()(const osg::Vec3& v0,
+                                             const osg::Vec3& v1,
+                                             const osg::Vec3& v2)
+   {
+      v0x.push_back(v0.x()); v0y.push_back(v0.y()); v0z.push_back(v0.z());
+
+      e1x.push_back(v1.x() - v0.x());
+      e1y.push_back(v1.y() - v0.y());
+      e1z.push_back(v1.z() - v0.z());
+
+      e2x.push_back(v2.x() - v0.x());
+      e2y.push_back(v2.y() - v0.y());
+      e2z.push_back(v2.z() - v0.z());
+   }
+
+
+
+   // - TriangleCache::Triangles::pad ------------------------------------------
+   void TriangleCache::Triangles::pad()
+   {
+      // Degenerate triangles (null edges) are never hit
+      while (size() % 4 != 0)
+         (*this)(osg::Vec3(), osg::Vec3(), osg::Vec3());
+   }
+
+
+
+   // - TriangleCache::Triangles::intersect ------------------------------------
+   std::size_t
+   TriangleCache::Triangles::intersect(const osg::Vec3d& start,
+                                       const osg::Vec3d& end,
+                                       bool cullBackFaces, float& ratio) const
+   {
+      // Moller-Trumbore, with the segment direction not normalized, so that
+      // the distance found is directly the ratio along the segment. The
+      // determinant is positive for front-facing triangles.
+      const Triangles& tris = *this;
+      const std::size_t numTris = tris.size();
+      const osg::Vec3d dir = end - start;
+
+      std::size_t theHit = numTris;
+
+#ifdef OSGUISH_USE_SSE
+
+      const __m128 zero = _mm_setzero_ps();
+      const __m128 one = _mm_set1_ps(1.0f);
+
+      const __m128 ox = _mm_set1_ps(static_cast<float>(start.x()));
+      const __m128 oy = _mm_set1_ps(static_cast<float>(start.y()));
+      const __m128 oz = _mm_set1_ps(static_cast<float>(start.z()));
+      const __m128 dx = _mm_set1_ps(static_cast<float>(dir.x()));
+      const __m128 dy = _mm_set1_ps(static_cast<float>(dir.y()));
+      const __m128 dz = _mm_set1_ps(static_cast<float>(dir.z()));
+
+      for (std::size_t i = 0; i < numTris; i += 4)
+      {
+         const __m128 e1x = _mm_loadu_ps(&tris.e1x[i]);
+         const __m128 e1y = _mm_loadu_ps(&tris.e1y[i]);
+         const __m128 e1z = _mm_loadu_ps(&tris.e1z[i]);
+         const __m128 e2x = _mm_loadu_ps(&tris.e2x[i]);
+         const __m128 e2y = _mm_loadu_ps(&tris.e2y[i]);
+         const __m128 e2z = _mm_loadu_ps(&tris.e2z[i]);
+
+         // p = dir x e2; det = e1 . p
+         const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+         const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+         const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+         const __m128 det = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)),
+            _mm_mul_ps(e1z, pz));
+
+         // s = start - v0; u = (s . p) / det
+         const __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(&tris.v0x[i]));
+         const __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(&tris.v0y[i]));
+         const __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(&tris.v0z[i]));
+
+         const __m128 invDet = _mm_div_ps(one, det);
+
+         const __m128 u = _mm_mul_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)),
+                       _mm_mul_ps(sz, pz)),
+            invDet);
+
+         // q = s x e1; v = (dir . q) / det; t = (e2 . q) / det
+         const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+         const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+         const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+         const __m128 v = _mm_mul_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                       _mm_mul_ps(dz, qz)),
+            invDet);
+
+         const __m128 t = _mm_mul_ps(
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                       _mm_mul_ps(e2z, qz)),
+            invDet);
+
+         __m128 valid = cullBackFaces
+            ? _mm_cmpgt_ps(det, zero)
+            : _mm_cmpneq_ps(det, zero);
+
+         valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+         valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+         valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), one));
+         valid = _mm_and_ps(valid, _mm_cmpge_ps(t, zero));
+         valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(ratio)));
+
+         const int lanes = _mm_movemask_ps(valid);
+         if (lanes == 0)
+            continue;
+
+         float ts[4];
+         _mm_storeu_ps(ts, t);
+
+         for (int k = 0; k < 4; ++k)
+         {
+            if ((lanes & (1 << k)) != 0 && ts[k] < ratio)
+            {
+               ratio = ts[k];
+               theHit = i + k;
+            }
+         }
+      }
+
+#else // !OSGUISH_USE_SSE
+
+      const osg::Vec3 s0(start);
+      const osg::Vec3 d(dir);
+
+      for (std::size_t i = 0; i < numTris; ++i)
+      {
+         const osg::Vec3 e1(tris.e1x[i], tris.e1y[i], tris.e1z[i]);
+         const osg::Vec3 e2(tris.e2x[i], tris.e2y[i], tris.e2z[i]);
+
+         const osg::Vec3 p = d ^ e2;
+         const float det = e1 * p;
+
+         if (cullBackFaces ? det <= 0.0f : det == 0.0f)
+            continue;
+
+         const float invDet = 1.0f / det;
+         const osg::Vec3 s = s0 - osg::Vec3(tris.v0x[i], tris.v0y[i],
+                                            tris.v0z[i]);
+
+         const float u = (s * p) * invDet;
+         if (u < 0.0f || u > 1.0f)
+            continue;
+
+         const osg::Vec3 q = s ^ e1;
+
+         const float v = (d * q) * invDet;
+         if (v < 0.0f || u + v > 1.0f)
+            continue;
+
+         const float t = (e2 * q) * invDet;
+         if (t >= 0.0f && t < ratio)
+         {
+            ratio = t;
+            theHit = i;
+         }
+      }
+
+#endif // OSGUISH_USE_SSE
+
+      return theHit;
+   }
+
+
+
+   // - TriangleCache::Triangles::getNormal ------------------------------------
+   osg::Vec3d TriangleCache::Triangles::getNormal(std::size_t i) const
+   {
+      return osg::Vec3d(e1x[i], e1y[i], e1z[i])
+         ^ osg::Vec3d(e2x[i], e2y[i], e2z[i]);
+   }
+
+
+
+   // - TriangleCache::Signature::Signature ------------------------------------
+   TriangleCache::Signature::Signature(osg::Drawable& drawable)
+      : vertices(0), verticesModified(0), numPrimitiveSets(0),
+        primitivesModified(0), boundMin(drawable.getBound()._min),
+        boundMax(drawable.getBound()._max)
+   {
+      const osg::Geometry* geometry = drawable.asGeometry();
+      if (geometry == 0)
+         return;
+
+      vertices = geometry->getVertexArray();
+      if (vertices != 0)
+         verticesModified = vertices->getModifiedCount();
+
+      numPrimitiveSets = geometry->getNumPrimitiveSets();
+      for (unsigned i = 0; i < numPrimitiveSets; ++i)
+         primitivesModified += geometry->getPrimitiveSet(i)->getModifiedCount();
+   }
+
+
+
+   // - TriangleCache::Signature::operator== -----------------------------------
+   bool TriangleCache::Signature::operator==(const Signature& other) const
+   {
+      return vertices == other.vertices
+         && verticesModified == other.verticesModified
+         && numPrimitiveSets == other.numPrimitiveSets
+         && primitivesModified == other.primitivesModified
+         && boundMin == other.boundMin
+         && boundMax == other.boundMax;
+   }
+
+
+
+   // - TriangleCache::get -----------------------------------------------------
+   TriangleCache::TrianglesPtr TriangleCache::get(osg::Drawable& drawable)
+   {
+      const Signature signature(drawable);
+
+      {
+         OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex_);
+
+         Entries_t::const_iterator p = entries_.find(&drawable);
+         if (p != entries_.end()
+             && p->second.drawable.get() == &drawable
+             && p->second.signature == signature)
+         {
+            return p->second.triangles;
+         }
+      }
+
+      // Extract the triangles without holding the lock, so that other threads
+      // can use the cache meanwhile
+      osg::ref_ptr<osg::TriangleFunctor<Triangles> > extractor =
+         new osg::TriangleFunctor<Triangles>();
+      drawable.accept(*extractor);
+      extractor->pad();
+
+      TrianglesPtr triangles = extractor.get();
+
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex_);
+
+      entries_.erase(&drawable);
+      entries_.insert(std::make_pair(
+         &drawable, Entry(drawable, signature, triangles.get())));
+
+      return triangles;
+   }
+
+
+
+   // - TriangleCache::prune ---------------------------------------------------
+   void TriangleCache::prune()
+   {
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex_);
+
+      for (Entries_t::iterator p = entries_.begin(); p != entries_.end(); )
+      {
+         if (p->second.drawable.get() == 0)
+            entries_.erase(p++);
+         else
+            ++p;
+      }
+   }
+
+
+
+   // - TriangleCache::clear ---------------------------------------------------
+   void TriangleCache::clear()
+   {
+      OpenThreads::ScopedLock<OpenThreads::Mutex> lock(mutex_);
+      entries_.clear();
+   }
+
+} // namespace OSGUIsh
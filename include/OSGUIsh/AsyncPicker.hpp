@@ -0,0 +1,145 @@
+/******************************************************************************\
+* AsyncPicker.hpp                                                              *
+* Picking on a worker thread.                                                  *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_ASYNC_PICKER_HPP_
+#define _OSGUISH_ASYNC_PICKER_HPP_
+
+#include <vector>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Block>
+#include <OpenThreads/Thread>
+#include <OSGUIsh/PickTraversal.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A worker thread that intersects the candidates collected by
+    * <tt>PickTraversal</tt>s that defer intersections (see \c
+    * PickTraversal::setTriangleCache()). This is used by the \c EventHandler
+    * to pick without blocking the thread running the event traversal. The
+    * worker never touches the scene graph: it works only with the snapshot
+    * of the scene captured by the candidates.
+    * <p>Communication with the worker is lock-free. There is a single request
+    * slot and two result buffers: the front buffer belongs to the consumer
+    * (the thread calling \c post() and \c fetch()), the back buffer belongs to
+    * the worker. An atomic state variable says who owns the request slot and
+    * when the buffers can be swapped. There is never more than one request in
+    * flight, so the worker never writes to the buffer being read.
+    * <p>A single thread must play the consumer role (which is naturally the
+    * case for the event traversal in \c osgViewer, regardless of the
+    * threading model).
+    */
+   class AsyncPicker: public OpenThreads::Thread
+   {
+      public:
+         /// A request for picking.
+         struct Request
+         {
+            /**
+             * The candidates to intersect, one element per node mask, in the
+             * order the masks are tried.
+             */
+            std::vector<PickTraversal::Candidates_t> candidates;
+
+            /**
+             * The hits already found by the traversals that collected the
+             * candidates, one element per node mask, as in \c candidates.
+             */
+            std::vector<PickTraversal::Hits_t> hits;
+
+            /**
+             * If \c true, all masks are tried; if \c false, picking stops at
+             * the first mask producing hits.
+             */
+            bool allMasks;
+
+            /// Are back-facing triangles ignored?
+            bool cullBackFaces;
+         };
+
+         /// The result of a picking request.
+         struct Result
+         {
+            /**
+             * The hits found, one element per node mask tried, in the same
+             * order as in the request.
+             */
+            std::vector<PickTraversal::Hits_t> hits;
+         };
+
+         /// Constructs the \c AsyncPicker and starts the worker thread.
+         AsyncPicker();
+
+         /// Stops the worker thread and destroys the \c AsyncPicker.
+         virtual ~AsyncPicker();
+
+         /**
+          * Checks whether a new request can be posted. This is \c true when
+          * the worker is not processing a request and when its last result
+          * was already fetched.
+          */
+         bool isIdle() const { return state_ == IDLE; }
+
+         /**
+          * Returns the request slot, which can be filled only while \c
+          * isIdle() is \c true.
+          */
+         Request& getRequest() { return request_; }
+
+         /**
+          * Hands the request in the request slot to the worker thread. Must be
+          * called only while \c isIdle() is \c true.
+          */
+         void post();
+
+         /**
+          * Fetches the result of the last request, if it is ready.
+          * @return A pointer to the result, or \c NULL if no new result is
+          *         available. The result remains valid until the next call to
+          *         \c fetch() returning non-\c NULL.
+          */
+         const Result* fetch();
+
+         /// The worker thread body (overrides virtual method).
+         virtual void run();
+
+      private:
+         /// The states of the communication with the worker thread.
+         enum State
+         {
+            IDLE,      ///< No request being processed, no result to fetch.
+            REQUESTED, ///< The worker owns the request slot.
+            READY      ///< The worker has published a result.
+         };
+
+         /// The current state (one of the \c State values).
+         OpenThreads::Atomic state_;
+
+         /// Set to a non-zero value to make the worker thread exit.
+         OpenThreads::Atomic done_;
+
+         /// Used to put the worker thread to sleep while there's no work.
+         OpenThreads::Block wakeUp_;
+
+         /// The request slot.
+         Request request_;
+
+         /// The two result buffers.
+         Result results_[2];
+
+         /// The index of the front buffer, owned by the consumer.
+         unsigned front_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_ASYNC_PICKER_HPP_
@@ -0,0 +1,215 @@
+/******************************************************************************\
+* BatchPickTraversal.hpp                                                       *
+* A picking traversal for many segments at once.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_BATCH_PICK_TRAVERSAL_HPP_
+#define _OSGUISH_BATCH_PICK_TRAVERSAL_HPP_
+
+#include <vector>
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/LOD>
+#include <osg/NodeVisitor>
+#include <osg/Projection>
+#include <OSGUIsh/TriangleCache.hpp>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A traversal that picks a scene graph with many line segments at once,
+    * finding the nearest hit along each one of them. The scene graph is
+    * traversed only once for all segments: at each node, only the segments
+    * intersecting the node bounding sphere are passed down to its children,
+    * so that each subgraph is tested against the (typically small) batch of
+    * segments that can actually hit it. At each \c Geode, the triangles of
+    * each drawable are taken from a \c TriangleCache (so that they are
+    * extracted only when the drawable changes) and tested against all
+    * segments in the batch, four triangles at a time when SSE is available.
+    * <p>Nested cameras with an absolute reference frame and \c osg::Projection
+    * nodes (the usual way to make HUDs) are not traversed, since segments
+    * given in world coordinates have no meaning under them.
+    * <p>Like \c PickTraversal, this only picks what is drawn: \c osg::LOD
+    * children are selected as by the cull traversal, and nothing is ever
+    * requested from the database pager.
+    */
+   class BatchPickTraversal: public osg::NodeVisitor
+   {
+      public:
+         /// A line segment used for picking.
+         struct Segment
+         {
+            /// Constructs the \c Segment.
+            Segment() { }
+
+            /// Constructs the \c Segment.
+            Segment(const osg::Vec3d& theStart, const osg::Vec3d& theEnd)
+               : start(theStart), end(theEnd)
+            { }
+
+            /// The segment start point.
+            osg::Vec3d start;
+
+            /// The segment end point.
+            osg::Vec3d end;
+         };
+
+         /// A sequence of segments.
+         typedef std::vector<Segment> Segments_t;
+
+         /// The result of picking with one segment.
+         struct Hit
+         {
+            /// Constructs a \c Hit representing "nothing hit".
+            Hit() : hasHit(false), ratio(1.0) { }
+
+            /// Was anything hit?
+            bool hasHit;
+
+            /**
+             * The position of the hit along the segment: 0.0 is at its start,
+             * 1.0 is at its end. Meaningful only if \c hasHit is \c true.
+             */
+            double ratio;
+
+            /// The hit itself. Meaningful only if \c hasHit is \c true.
+            Intersection_t intersection;
+         };
+
+         /// A sequence of hits.
+         typedef std::vector<Hit> Hits_t;
+
+         /**
+          * Computes the segment corresponding to a point in window
+          * coordinates, going from the near to the far plane of a camera.
+          * @param camera The camera.
+          * @param x The horizontal position, in window coordinates.
+          * @param y The vertical position, in window coordinates.
+          * @return The segment, in the camera's world coordinates.
+          */
+         static Segment makeSegment(const osg::Camera& camera,
+                                    float x, float y);
+
+         /**
+          * Constructs a \c BatchPickTraversal. Nothing is traversed until \c
+          * pick() is called.
+          */
+         BatchPickTraversal();
+
+         /**
+          * Picks a camera's subgraph with a batch of segments.
+          * @param camera The camera whose subgraph will be traversed.
+          * @param segments The segments, in the camera's world coordinates.
+          * @param traversalMask The traversal mask; nodes whose node mask
+          *        has no bits in common with it are ignored.
+          * @param cullBackFaces If \c true, back-facing triangles are not
+          *        considered when looking for the nearest hit.
+          * @return One hit per segment, in the same order as \c segments.
+          */
+         const Hits_t& pick(osg::Camera* camera, const Segments_t& segments,
+                            osg::Node::NodeMask traversalMask,
+                            bool cullBackFaces = false);
+
+         /// Returns the hits found by the last call to \c pick().
+         const Hits_t& getHits() const { return hits_; }
+
+         /**
+          * Sets the scale applied to the camera's LOD scale when selecting
+          * \c osg::LOD children (see \c PickTraversal::setLODScale()).
+          */
+         void setLODScale(float scale) { lodScale_ = scale; }
+
+         /**
+          * Sets the cache of triangles used. By default, each \c
+          * BatchPickTraversal has its own cache; sharing one among several
+          * traversals (which can run in different threads) avoids extracting
+          * the same triangles again and again.
+          * @param cache The cache. Must not be \c NULL.
+          */
+         void setTriangleCache(TriangleCache* cache);
+
+         virtual void apply(osg::Node& node);
+         virtual void apply(osg::Transform& transform);
+         virtual void apply(osg::Geode& geode);
+         virtual void apply(osg::Projection& projection);
+         virtual void apply(osg::LOD& lod);
+
+      private:
+         /**
+          * A segment being traced, in the coordinates of the node being
+          * visited.
+          */
+         struct LocalSegment
+         {
+            /// The index of the segment in the batch.
+            std::size_t index;
+
+            /// The segment start point.
+            osg::Vec3d start;
+
+            /// The segment end point.
+            osg::Vec3d end;
+         };
+
+         /// A sequence of local segments.
+         typedef std::vector<LocalSegment> LocalSegments_t;
+
+         /**
+          * Selects, among the segments in \c segments_, the ones that
+          * intersect a bounding sphere.
+          * @return \c false if none does.
+          */
+         bool cullSegments(const osg::BoundingSphere& bs,
+                           LocalSegments_t& passed) const;
+
+         /// The segments being traced, in the current node coordinates.
+         LocalSegments_t segments_;
+
+         /**
+          * The matrix taking the current node coordinates to world
+          * coordinates.
+          */
+         osg::Matrixd model_;
+
+         /// Is \c model_ an identity matrix?
+         bool modelIsIdentity_;
+
+         /// The cache from which the triangles are taken.
+         osg::ref_ptr<TriangleCache> triangleCache_;
+
+         /// Are back-facing triangles ignored?
+         bool cullBackFaces_;
+
+         /// The view matrix of the camera being traversed.
+         osg::Matrixd view_;
+
+         /// The projection matrix of the camera being traversed.
+         osg::Matrixd projection_;
+
+         /// The window (viewport) matrix of the camera being traversed.
+         osg::Matrixd window_;
+
+         /// The scale applied to the camera's LOD scale.
+         float lodScale_;
+
+         /**
+          * The LOD scale of the cameras in effect for the node being visited
+          * (which nested cameras may change).
+          */
+         float cameraLODScale_;
+
+         /// The hits found so far, one per segment.
+         Hits_t hits_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_BATCH_PICK_TRAVERSAL_HPP_
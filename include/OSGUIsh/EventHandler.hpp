@@ -12,13 +12,27 @@
 #ifndef _OSGUISH_EVENT_HANDLER_HPP_
 #define _OSGUISH_EVENT_HANDLER_HPP_
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/signal.hpp>
 #include <osgGA/GUIEventHandler>
 #include <osgUtil/LineSegmentIntersector>
 #include <osg/View>
+#include <OSGUIsh/AsyncPicker.hpp>
+#include <OSGUIsh/BatchPickTraversal.hpp>
 #include <OSGUIsh/Events.hpp>
+#include <OSGUIsh/FocusChain.hpp>
+#include <OSGUIsh/FocusNavigator.hpp>
+#include <OSGUIsh/OverlayIndex.hpp>
 #include <OSGUIsh/FocusPolicy.hpp>
+#include <OSGUIsh/Gesture.hpp>
 #include <OSGUIsh/ManualFocusPolicy.hpp>
+#include <OSGUIsh/PickService.hpp>
+#include <OSGUIsh/PickThreadPool.hpp>
+#include <OSGUIsh/PickTraversal.hpp>
+#include <OSGUIsh/PointerSource.hpp>
+#include <OSGUIsh/RegionSelector.hpp>
+#include <OSGUIsh/TimerWheel.hpp>
+#include <OSGUIsh/TriangleCache.hpp>
 
 
 namespace OSGUIsh
@@ -40,8 +54,10 @@ namespace OSGUIsh
          /// Convenience constructor.
          HandlerParams(NodePtr nodeParam,
                        const osgGA::GUIEventAdapter& eventParam,
-                       const Intersection_t& hitParam)
-            : node(nodeParam), event(eventParam), hit(hitParam)
+                       const Intersection_t& hitParam,
+                       PointerId pointerParam = MOUSE_POINTER)
+            : node(nodeParam), event(eventParam), hit(hitParam),
+              pointer(pointerParam), consumed(false)
          { }
 
          /// The node generating the event.
@@ -66,8 +82,71 @@ namespace OSGUIsh
           *       since, perhaps, there will not be any registered node under
           *       the mouse pointer. Figuring out if \c hit contains valid and
           *       meaningful information is up to the user.
+          *       <p>For events generated by pointers other than the mouse, \c
+          *       hit is related to that pointer instead.
           */
          const Intersection_t& hit;
+
+         /**
+          * The pointer that generated the event. This is \c MOUSE_POINTER for
+          * mouse events (and for keyboard events); for events generated by
+          * a \c PointerSource, this is the ID returned by \c
+          * EventHandler::addPointerSource(); for events generated by a touch
+          * contact, this is an ID assigned when the contact begins, and valid
+          * until it ends.
+          */
+         PointerId pointer;
+
+         /**
+          * For drag and drop events (\c EVENT_DRAG_START, \c EVENT_DRAG, \c
+          * EVENT_DRAG_END and \c EVENT_DROP), the node being dragged.
+          * Invalid for other events.
+          */
+         NodePtr dragNode;
+
+         /**
+          * For drag and drop events, the drop target found by the last drop
+          * target probe (see \c EventHandler::setDropTargetProbeRate()). This
+          * is invalid if probing is disabled, or if no registered node was
+          * under the dragged one.
+          */
+         NodePtr dropTarget;
+
+         /**
+          * For \c EVENT_SCROLL, the sum of the scroll deltas in the frame.
+          * Positive values are right and up; each notch of a mouse wheel
+          * counts as one, while the deltas of \c
+          * osgGA::GUIEventAdapter::SCROLL_2D events are used as given by OSG.
+          * Zero for other events.
+          */
+         osg::Vec2 scrollDelta;
+
+         /**
+          * Set this to \c true in a handler to tell that the event was
+          * consumed. Then, \c EventHandler::handle() returns \c true (see \c
+          * EventHandler::setHandleReturnValue()), so that OSG doesn't pass the
+          * event to the other event handlers, like camera manipulators.
+          * Starts as \c false; the handlers connected to the same signal see
+          * the value set by the previous ones.
+          */
+         bool consumed;
+   };
+
+
+
+   /**
+    * A \c struct grouping the parameters passed to handlers of changes in the
+    * selection made with region selection (see \c
+    * EventHandler::setRegionSelection()).
+    */
+   struct SelectionParams
+   {
+      public:
+         /// The nodes that entered the selection.
+         Nodes_t added;
+
+         /// The nodes that left the selection.
+         Nodes_t removed;
    };
 
 
@@ -77,6 +156,25 @@ namespace OSGUIsh
     * has an internal list of nodes being "observed". Every observed node has a
     * collection of signals associated to it. These signals represent the events
     * that can be generated for the node.
+    * <p>When OSG provides multi-touch data (OSG 3.0 and later), each touch
+    * contact is handled as a separate pointer, with its own hover state:
+    * touching generates <tt>"MouseEnter"</tt> and <tt>"MouseDown"</tt>,
+    * dragging generates <tt>"MouseMove"</tt>, <tt>"MouseEnter"</tt> and
+    * <tt>"MouseLeave"</tt>, and lifting the finger generates
+    * <tt>"MouseUp"</tt>, <tt>"Click"</tt> (possibly <tt>"DoubleClick"</tt>)
+    * and <tt>"MouseLeave"</tt>, all of them for the left button. These events
+    * are generated while handling the next \c FRAME event, when all contacts
+    * are picked together in a single batch. (Multi-touch events are not
+    * handled as mouse events.)
+    * <p>The same \c EventHandler can be added to several views (like the
+    * views of an \c osgViewer::CompositeViewer). The mouse pointer belongs
+    * to the view that received the last pointer event (see \c
+    * getMouseView()); the picking and the events driven by the pointer
+    * (hover, drag, region selection, gestures, hover dwell, pointer sources
+    * and touch contacts) are handled only in the \c FRAME events of that
+    * view, so that the other views don't pick at the pointer position with
+    * their own cameras. The registered nodes, their signals and the picking
+    * structures attached to the scene are shared by all views.
     */
    class EventHandler: public osgGA::GUIEventHandler
    {
@@ -91,26 +189,55 @@ namespace OSGUIsh
           *        an \c osgUtil::PolytopeIntersector is used instead, with a
           *        "radius" given by the value of this parameter; this is less
           *        efficient, but can pick points and lines.
-          * @param kbdPolicyFactory The factory that will be used to create the
-          *        \c FocusPolicy used to automatically set the focus for
-          *        keyboard events.
-          * @param wheelPolicyFactory The factory that will be used to create
-          *        the \c FocusPolicy used to automatically set the focus for
-          *        mouse wheel events.
+          * @param kbdPolicy The \c FocusPolicy (or chain of policies) used to
+          *        automatically set the focus for keyboard events. Null (the
+          *        default) means that the focus is set manually. Not owned by
+          *        the \c EventHandler.
+          * @param wheelPolicy The \c FocusPolicy (or chain of policies) used to
+          *        automatically set the focus for mouse wheel events. Null (the
+          *        default) means that the focus is set manually. Not owned by
+          *        the \c EventHandler.
           */
-         EventHandler(double pickerRadius = 0.0,
-                      const FocusPolicyFactory& kbdPolicyFactory =
-                      FocusPolicyFactoryMason<ManualFocusPolicy>(),
-                      const FocusPolicyFactory& wheelPolicyFactory =
-                      FocusPolicyFactoryMason<ManualFocusPolicy>());
+         EventHandler(double pickerRadius = 0.0, FocusPolicy* kbdPolicy = 0,
+                      FocusPolicy* wheelPolicy = 0);
 
          /**
           * Handles upcoming events (overloads virtual method).
-          * @return See \c handleReturnValues_, please.
+          * @return \c true if OSG should not pass the event to other event
+          *         handlers. By default, this happens when a handler called
+          *         for the event sets \c HandlerParams::consumed (see \c
+          *         setHandleReturnValue()).
           */
          bool handle(const osgGA::GUIEventAdapter& ea,
                      osgGA::GUIActionAdapter&);
 
+         /// The possible return values of \c handle().
+         enum HandleReturnValue
+         {
+            RETURN_FALSE,      ///< Always return \c false.
+            RETURN_TRUE,       ///< Always return \c true.
+            RETURN_IF_CONSUMED ///< Return \c true if the event was consumed.
+         };
+
+         /**
+          * Sets what \c handle() returns for a given event type.
+          * <p>By default, \c handle() returns \c true for the events consumed
+          * by some handler (\c RETURN_IF_CONSUMED), except for \c FRAME
+          * events, for which it always returns \c false (since camera
+          * manipulators need them, and the signals triggered in \c FRAME
+          * events are mostly caused by earlier events anyway). Moving the
+          * keyboard focus with the focus chain or with spatial focus
+          * navigation also consumes the key event.
+          * <p>When a \c PUSH event is consumed, the \c DRAG and \c RELEASE
+          * events until all mouse buttons are released are consumed, too;
+          * this way, clicking and dragging a node doesn't move the camera.
+          * @param eventType The event type.
+          * @param value The value to return.
+          */
+         void setHandleReturnValue(
+            osgGA::GUIEventAdapter::EventType eventType,
+            HandleReturnValue value);
+
          /// A type representing a sequence of node masks.
          typedef std::vector<osg::Node::NodeMask> NodeMasks_t;
 
@@ -213,6 +340,34 @@ namespace OSGUIsh
 
          SignalPtr getSignal(const NodePtr node, Event signal);
 
+         /**
+          * Returns the signal triggered when a given key chord is pressed (or
+          * released) while a given node has the keyboard focus. Unlike the
+          * <tt>"KeyDown"</tt> and <tt>"KeyUp"</tt> signals, which are
+          * triggered for every key (and still are), only the slots connected
+          * to the chord are called. The signals are created on demand, and
+          * kept in a hash table looked up once per keyboard event.
+          * @param node The node. It must have been added with \c addNode().
+          * @param key The key, as returned by \c
+          *        osgGA::GUIEventAdapter::getKey(). Letters are not case
+          *        sensitive: the case OSG reports depends on Shift and Caps
+          *        Lock, so <tt>('a', MODKEY_SHIFT)</tt> and <tt>('A',
+          *        MODKEY_SHIFT)</tt> are the same chord, triggered by
+          *        Shift+A. For other keys, OSG reports the shifted symbol, and
+          *        so must \c key (for instance, <tt>('!', MODKEY_SHIFT)</tt>
+          *        for Shift+1 in a US layout).
+          * @param modKeyMask The modifier keys that must be pressed (and no
+          *        others), as \c osgGA::GUIEventAdapter::ModKeyMask flags. The
+          *        left and right shift, control, alt and meta keys are not
+          *        distinguished; other modifiers (including the lock keys) are
+          *        ignored.
+          * @param event Either \c EVENT_KEY_DOWN or \c EVENT_KEY_UP.
+          * @throw std::runtime_error If \c node was not added.
+          */
+         SignalPtr getKeySignal(const NodePtr node, int key,
+                                unsigned modKeyMask = 0,
+                                Event event = EVENT_KEY_DOWN);
+
          /**
           * Ignores or stops to ignore faces that are back-facing the viewer
           * when picking. It may be useful to ignore back faces when backface
@@ -223,35 +378,698 @@ namespace OSGUIsh
           *      to zero.
           */
          void ignoreBackFaces(bool ignore = true)
-         { ignoreBackFaces_ = ignore; }
+         { ignoreBackFaces_ = ignore; pickCache_.clear(); }
 
          /**
           * Manually sets the node that will receive keyboard events. Notice
           * that focus policies allow to set this automatically.
+          * <p>If the focus changes, the <tt>"FocusOut"</tt> and
+          * <tt>"FocusIn"</tt> signals are triggered, with a blank event (of
+          * type \c osgGA::GUIEventAdapter::NONE).
           */
          void setKeyboardFocus(const NodePtr node);
 
          /**
           * Sets the node that will receive mouse wheel events. Notice that
           * focus policies allow to set this automatically.
+          * <p>If the focus changes, the <tt>"WheelFocusOut"</tt> and
+          * <tt>"WheelFocusIn"</tt> signals are triggered, with a blank event
+          * (of type \c osgGA::GUIEventAdapter::NONE).
           */
          void setMouseWheelFocus(const NodePtr node);
 
          /**
-          * Sets the focus policy for keyboard events to a given one.
-          * @param policyFactory The factory that will be used to create the
-          *        actual policy.
+          * Sets the focus policy for keyboard events to a given one. Nothing
+          * is allocated, so policies can be switched freely at runtime.
+          * @param policy The policy (or the first policy of a chain). Null
+          *        means that the focus is set manually. Not owned by the \c
+          *        EventHandler, so it must be kept alive while in use.
           */
-         void setKeyboardFocusPolicy(const FocusPolicyFactory& policyFactory);
+         void setKeyboardFocusPolicy(FocusPolicy* policy);
 
          /**
           * Sets the focus policy for mouse wheel events to a given one.
-          * @param policyFactory The factory that will be used to create the
-          *        actual policy.
+          * Nothing is allocated, so policies can be switched freely at
+          * runtime.
+          * @param policy The policy (or the first policy of a chain). Null
+          *        means that the focus is set manually. Not owned by the \c
+          *        EventHandler, so it must be kept alive while in use.
+          */
+         void setMouseWheelFocusPolicy(FocusPolicy* policy);
+
+         /**
+          * Enables or disables spatial focus navigation: pressing one of the
+          * navigation keys moves the keyboard focus to the nearest registered
+          * node in the corresponding screen direction (as found by a \c
+          * FocusNavigator). The key is still reported, through
+          * <tt>"KeyDown"</tt>, to the node that had the focus.
+          * <p>The window positions of the registered nodes are kept in an
+          * index, rebuilt only when the camera changes, when nodes are added
+          * or when \c markSceneDirty() is called.
+          * @param enable Enable focus navigation? Default is disabled.
+          * @param leftKey The key moving the focus left, as an \c
+          *        osgGA::GUIEventAdapter::KeySymbol value.
+          * @param rightKey The key moving the focus right.
+          * @param upKey The key moving the focus up.
+          * @param downKey The key moving the focus down.
+          */
+         void setFocusNavigation(
+            bool enable = true,
+            int leftKey = osgGA::GUIEventAdapter::KEY_Left,
+            int rightKey = osgGA::GUIEventAdapter::KEY_Right,
+            int upKey = osgGA::GUIEventAdapter::KEY_Up,
+            int downKey = osgGA::GUIEventAdapter::KEY_Down);
+
+         /**
+          * Enables or disables the focus chain: pressing Tab moves the
+          * keyboard focus to the next node in the chain, and pressing
+          * Shift-Tab moves it to the previous one (see \c FocusChain). The key
+          * is still reported, through <tt>"KeyDown"</tt>, to the node that had
+          * the focus.
+          * <p>The chain is sorted only when nodes are added, when tab indices
+          * change, when \c markSceneDirty() is called or (if ordered by screen
+          * position) when the camera changes; moving along it costs constant
+          * time.
+          * @param enable Enable the focus chain? Default is disabled.
+          * @param order The order of the nodes with tab index zero.
+          * @param rowHeight For \c FocusChain::ORDER_SCREEN_POSITION, the
+          *        height of the screen rows, in pixels.
+          */
+         void setFocusChain(
+            bool enable = true,
+            FocusChain::Order order = FocusChain::ORDER_SCENE_GRAPH,
+            float rowHeight = 16.0f);
+
+         /**
+          * Sets the tab index of a node, which defines its position in the
+          * focus chain (see \c FocusChain::setTabIndex()).
+          * @param node The node.
+          * @param tabIndex The tab index. Nodes with positive tab indices come
+          *        first, in increasing order; nodes with tab index zero (the
+          *        default) come next, in the order chosen in \c
+          *        setFocusChain(); nodes with negative tab indices are left
+          *        out.
+          */
+         void setTabIndex(const NodePtr& node, int tabIndex);
+
+         /// The kinds of focus.
+         enum FocusKind
+         {
+            KEYBOARD_FOCUS,   ///< The focus for keyboard events.
+            MOUSE_WHEEL_FOCUS ///< The focus for mouse wheel and scroll events.
+         };
+
+         /**
+          * Sets how many nodes are remembered in the focus history. Whenever
+          * the focus moves, the node losing it is stored in the history (one
+          * for each kind of focus), a ring that keeps only the latest nodes.
+          * Changing the size clears the history.
+          * @param size The number of nodes remembered. Default is 8; zero
+          *        disables the history.
+          */
+         void setFocusHistorySize(std::size_t size);
+
+         /**
+          * Returns a node that had the focus before.
+          * @param kind The kind of focus.
+          * @param age Zero for the node that had the focus last, one for the
+          *        node before that one, and so on.
+          * @return The node; invalid if the history doesn't go that far back.
+          */
+         NodePtr getPreviousFocus(FocusKind kind, std::size_t age = 0) const;
+
+         /**
+          * Returns the focus to the node that had it last, removing it from the
+          * history (so that calling this again goes further back). Typically
+          * used when closing a popup. The usual focus signals are triggered,
+          * with a blank event (of type \c osgGA::GUIEventAdapter::NONE).
+          * @param kind The kind of focus.
+          * @return \c true if the focus was moved; \c false if the history
+          *         was empty.
+          */
+         bool restorePreviousFocus(FocusKind kind);
+
+         /**
+          * Picks the registered node at a given position, right now. This is
+          * the same picking used internally to generate events, so tools that
+          * need to know "what is there" can use it instead of running their
+          * own intersection passes.
+          * <p>Results are cached for the view's current frame (as given by
+          * its frame stamp), or until \c markSceneDirty() is called, so
+          * repeated queries at the same position within a frame are
+          * essentially free.
+          * <p>If the view has slave cameras (insets, tiles of a display wall,
+          * eyes of a stereo setup), the scene is picked through the one
+          * showing the given position, as found by \c
+          * PickTraversal::findCamera().
+          * @param view The view displaying the scene.
+          * @param x The horizontal position to pick, in the window
+          *        coordinates of the view's master camera.
+          * @param y The vertical position to pick, in the window
+          *        coordinates of the view's master camera.
+          * @return The pick result. Its \c node will be invalid if no
+          *         registered node is at the given position.
+          */
+         PickResult pickAt(osg::View* view, float x, float y);
+
+         /**
+          * Picks the registered nodes at many positions at once. This is much
+          * faster than calling \c pickAt() for each position, because the
+          * scene is traversed only once for all positions, and because
+          * triangles are tested by a vectorized kernel (see \c
+          * BatchPickTraversal).
+          * <p>Picking masks are honored just like in \c pickAt(), and the
+          * thread pool set by \c setPickThreadPool() is used to split large
+          * batches. Back faces are ignored if so configured.
+          * <p>Positions over overlays (if overlay picking is enabled) and
+          * over HUDs (nested cameras with an absolute reference frame, or \c
+          * osg::Projection nodes) are picked first, one by one, because the
+          * batch traversal cannot handle them. So, it pays to keep the number
+          * of registered nodes in HUDs small.
+          * @param view The view displaying the scene.
+          * @param points The positions to pick, in window coordinates.
+          * @param results Output parameter, where the results are stored, in
+          *        the same order as \c points.
+          * @note Results are not cached, and the picking radius is ignored:
+          *       each position is picked with a line segment.
+          */
+         void pickBatch(osg::View* view, const std::vector<osg::Vec2>& points,
+                        std::vector<PickResult>& results);
+
+         /**
+          * Picks the registered nodes along many line segments at once. This
+          * is just like the other version of \c pickBatch(), but takes
+          * arbitrary segments instead of window positions.
+          * @param view The view displaying the scene.
+          * @param segments The segments, in the world coordinates of \c
+          *        camera.
+          * @param results Output parameter, where the results are stored, in
+          *        the same order as \c segments.
+          * @param camera The camera whose subgraph is picked, and whose eye
+          *        point selects \c osg::LOD children (typically, the one the
+          *        segments were computed for, like a slave camera found by \c
+          *        PickTraversal::findCamera()). \c NULL (the default) means
+          *        the view's master camera.
+          * @note Since segments in world coordinates mean nothing under
+          *       them, HUDs (nested cameras with an absolute reference frame,
+          *       or \c osg::Projection nodes) are never picked by this
+          *       version.
+          */
+         void pickBatch(osg::View* view,
+                        const BatchPickTraversal::Segments_t& segments,
+                        std::vector<PickResult>& results,
+                        osg::Camera* camera = 0);
+
+         /**
+          * Tells this \c EventHandler that the scene has changed in a way that
+          * can change picking results (nodes moved, added, removed...). Cached
+          * picking results are discarded.
+          * @note Cached results are reused only within the frame they were
+          *       computed in, so calling this is necessary only if the scene
+          *       changes between two calls to \c pickAt() in the same frame.
+          */
+         void markSceneDirty();
+
+         /**
+          * The possible schedules for the picking done to generate
+          * <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt> and
+          * <tt>"MouseMove"</tt> events. Picking is always done while handling
+          * \c FRAME events (so, at most once per frame); the schedule just
+          * decides in which frames it is done.
+          */
+         enum PickSchedule
+         {
+            /// Picks in every frame. This is the default.
+            PICK_EVERY_FRAME,
+
+            /**
+             * Picks only in frames in which the mouse pointer moved (that
+             * is, when \c MOVE or \c DRAG events arrived since the previous
+             * pick). Nodes moving under a still mouse pointer will not
+             * generate events.
+             */
+            PICK_ON_MOTION,
+
+            /**
+             * Like \c PICK_ON_MOTION, but also picks when the camera changed
+             * or when the scene was marked as dirty with \c
+             * markSceneDirty().
+             */
+            PICK_ON_CHANGE,
+
+            /**
+             * Picks in every frame, but not more often than the rate set
+             * with \c setMaxPickRate().
+             */
+            PICK_AT_MAX_RATE
+         };
+
+         /**
+          * Sets the schedule used for picking.
+          * @param schedule The new picking schedule.
+          */
+         void setPickSchedule(PickSchedule schedule);
+
+         /**
+          * Sets the maximum picking rate used with the \c PICK_AT_MAX_RATE
+          * schedule.
+          * @param picksPerSecond The maximum number of picks per second. Must
+          *        be positive. The default is 30.
+          */
+         void setMaxPickRate(double picksPerSecond);
+
+         /**
+          * Sets the maximum time spent per frame in the picking done for
+          * <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt> and
+          * <tt>"MouseMove"</tt> events. When the picking traversal takes
+          * longer than this, it is suspended and resumed in the next frame.
+          * Meanwhile, the results of the previous picking are kept (in other
+          * words, these events may be generated a few frames late, but frame
+          * rate is not hurt by picking complex scenes).
+          * @param seconds The time budget, in seconds. Zero (the default)
+          *        means "no limit".
+          * @note Picking for other events (and picking with \c pickAt()) is
+          *       always done synchronously, regardless of this budget.
+          * @bug The budget works only if the picking radius is equals to zero.
+          */
+         void setPickBudget(double seconds);
+
+         /**
+          * Enables or disables asynchronous picking. When enabled, the picking
+          * done for <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt> and
+          * <tt>"MouseMove"</tt> events runs on a worker thread, so that the
+          * thread running the event traversal doesn't have to wait for it.
+          * The events are generated when the results are available (typically
+          * in the next frame).
+          * <p>The worker never touches the scene graph, so the application
+          * can change it freely (in the update traversal or anywhere else)
+          * while the worker runs. While handling the \c FRAME event, the
+          * registered subgraphs are culled against the picking segment, and
+          * everything needed to intersect the <tt>Geode</tt>s found is
+          * captured: their node paths, accumulated matrices and triangles.
+          * The worker only intersects this snapshot, so results reflect the
+          * scene as it was when the request was posted. Triangles are cached
+          * (see \c TriangleCache), so they are extracted only when a
+          * drawable is seen for the first time or changes; in these frames,
+          * the event traversal does take longer. Also, geometry not belonging
+          * to any registered node doesn't occlude registered nodes, and \c
+          * osg::Billboard nodes are intersected while capturing, not by the
+          * worker.
+          * @param enable Enable asynchronous picking? Default is disabled.
+          * @note Picking for other events (and picking with \c pickAt()) is
+          *       always done synchronously.
+          * @bug Asynchronous picking works only if the picking radius is
+          *      equals to zero.
+          */
+         void setAsyncPicking(bool enable = true);
+
+         /**
+          * Sets the thread pool used to run the picking traversals for
+          * several picking masks in parallel. When there is more than one
+          * picking mask, all masks are traversed simultaneously, and the
+          * results are merged in the order of the masks, just as if they were
+          * traversed sequentially. The same pool can be shared by the \c
+          * EventHandler of every view.
+          * @param pool The pool to use. \c NULL (the default) means that
+          *        picking is done in the calling thread only.
+          * @note This is used only for synchronous picking with zero picking
+          *       radius, without a picking budget.
+          */
+         void setPickThreadPool(PickThreadPool* pool);
+
+         /**
+          * Sets the \c PickService shared with other event handlers. When
+          * set, picking with a line segment is done through the service, so
+          * that positions already picked in the frame (by this or by any
+          * other handler sharing the service) are not traversed again; and
+          * the result of the picking done for the mouse pointer in each frame
+          * is published in the service, so that other handlers can use it.
+          * @param service The service to use. \c NULL (the default) means
+          *        that this \c EventHandler picks on its own.
+          * @note Only synchronous picking and picking with a budget publish
+          *       their results; when a service is used, the thread pool set
+          *       with \c setPickThreadPool() is not.
+          */
+         void setPickService(PickService* service);
+
+         /**
+          * Returns the view the mouse pointer is in: the view that received
+          * the last pointer event. \c NULL if no pointer event was received
+          * yet (in which case the pointer is handled in any view).
+          */
+         const osg::View* getMouseView() const { return mouseView_; }
+
+         /// Returns the \c PickService in use (possibly \c NULL).
+         PickService* getPickService() const { return pickService_.get(); }
+
+         /**
+          * Enables or disables the fast picking of overlays. Nodes viewed
+          * through overlay cameras (nested cameras with an absolute reference
+          * frame and an orthographic projection, like those used for HUDs)
+          * are then kept in a 2D index of their window rectangles (see \c
+          * OverlayIndex), and picked with rectangle tests before the scene is
+          * traversed. Overlays are drawn over the scene, so overlay hits are
+          * taken no matter the order of the picking masks; each node is
+          * picked only with the masks that would let a traversal reach it.
+          * <p>The index is rebuilt when an overlay camera or the viewport
+          * changes, when nodes are added, when \c markSceneDirty() is called,
+          * and when overlay nodes move (the transforms above them or their
+          * bounds are checked once per frame). Other changes, like switching
+          * overlay nodes on, require a call to \c markSceneDirty().
+          * @param enable Enable overlay picking? Default is disabled.
+          * @param testGeometry If \c false (the default), a node is hit
+          *        anywhere in the window rectangle covered by its bounding
+          *        box, which is exact for rectangular items like buttons and
+          *        labels. If \c true, the geometry of the nodes whose
+          *        rectangles contain the position is intersected, too (only
+          *        their subgraphs are traversed).
+          * @note Asynchronous picking and picking with a polytope don't use
+          *       the index.
+          */
+         void setOverlayPicking(bool enable, bool testGeometry = false);
+
+         /**
+          * Sets how detailed the \c osg::LOD children picked are. Picking
+          * always tests only the children drawn: those selected by the cull
+          * traversal from the camera's eye point (inactive \c osg::Switch
+          * children are skipped, too). This scale multiplies the camera's LOD
+          * scale, so that values larger than one pick coarser children than
+          * those drawn, which is cheaper. Picking never requests \c
+          * osg::PagedLOD children from the database pager; if a selected
+          * child is not loaded yet, the most detailed loaded one is picked.
+          * @param scale The scale. Default is 1.0.
+          * @note Picking with a polytope selects \c osg::LOD children by the
+          *       distance to the eye point, but ignores this scale, and picks
+          *       the most detailed loaded child of \c osg::PagedLOD nodes.
+          *       \c PickService has its own scale.
+          */
+         void setPickLODScale(float scale);
+
+         /**
+          * Adds a pointer source. From now on, the pointer source generates
+          * <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt>, <tt>"MouseMove"</tt>,
+          * <tt>"MouseDown"</tt>, <tt>"MouseUp"</tt>, <tt>"Click"</tt> and
+          * <tt>"DoubleClick"</tt> events just like the mouse, but with its own
+          * state (so, for instance, the mouse and a tracked wand can be over
+          * different nodes simultaneously). The \c pointer member of \c
+          * HandlerParams identifies the pointer generating the event.
+          * <p>All pointer sources are picked together, with a single \c
+          * BatchPickTraversal per frame (per picking mask), regardless of how
+          * many there are.
+          * @param source The pointer source.
+          * @return The ID of the new pointer.
+          */
+         PointerId addPointerSource(PointerSourcePtr source);
+
+         /**
+          * Removes a pointer source added by \c addPointerSource(). If the
+          * pointer was over a node, a <tt>"MouseLeave"</tt> event is
+          * generated for it in the next \c FRAME event.
+          * @param id The ID of the pointer to remove.
+          */
+         void removePointerSource(PointerId id);
+
+         /// The possible constraints for the motion of dragged nodes.
+         enum DragConstraint
+         {
+            /**
+             * Drag on the plane through the picked point, perpendicular to
+             * the picking ray. This is the default.
+             */
+            DRAG_ON_VIEW_PLANE,
+
+            /**
+             * Drag on the plane tangent to the picked surface, at the picked
+             * point. When the surface normal is not known (with a nonzero
+             * picking radius), the same as \c DRAG_ON_VIEW_PLANE.
+             */
+            DRAG_ON_SURFACE_PLANE,
+
+            /**
+             * Drag on the plane through the picked point, perpendicular to a
+             * given direction.
+             */
+            DRAG_ON_PLANE,
+
+            /**
+             * Drag along the line through the picked point, parallel to a
+             * given direction.
+             */
+            DRAG_ALONG_AXIS
+         };
+
+         /**
+          * Sets the constraint for the motion of dragged nodes. When a drag
+          * starts, the constraint is placed at the picked point; while
+          * dragging, the pointer position is projected onto it, and the
+          * projected point is passed to the \c EVENT_DRAG handlers (as \c
+          * hit.worldIntersectionPoint and \c hit.localIntersectionPoint).
+          * @param constraint The drag constraint.
+          * @param direction The plane normal (for \c DRAG_ON_PLANE) or the
+          *        axis direction (for \c DRAG_ALONG_AXIS), in world
+          *        coordinates. Ignored for other constraints.
+          */
+         void setDragConstraint(DragConstraint constraint,
+                                const osg::Vec3d& direction =
+                                osg::Vec3d(0.0, 0.0, 1.0));
+
+         /**
+          * Sets the rate at which the scene is picked, while dragging, to find
+          * the drop target (the registered node under the pointer, ignoring
+          * the dragged one). Besides, a last probe is done when the drag
+          * ends, to generate the \c EVENT_DROP event. No other picking is done
+          * while dragging.
+          * @param probesPerSecond The maximum number of probes per second.
+          *        Zero (the default) disables drop target probing (and
+          *        therefore \c EVENT_DROP events).
+          * @note Probing always uses a line segment, regardless of the
+          *       picking radius.
+          */
+         void setDropTargetProbeRate(double probesPerSecond);
+
+         /**
+          * Sets the distance the pointer must move with a button pressed over
+          * a node to start dragging it. Only nodes with drag and drop handlers
+          * (for \c EVENT_DRAG_START, \c EVENT_DRAG, \c EVENT_DRAG_END or \c
+          * EVENT_DROP) can be dragged; other nodes get their clicks (and keep
+          * getting mouse events) regardless of how much the pointer moves.
+          * @param pixels The distance, in pixels. The default is 4.
+          */
+         void setDragThreshold(float pixels);
+
+         /**
+          * Sets the maximum time between two clicks for them to generate a
+          * <tt>"DoubleClick"</tt> event. This is also the interval used by \c
+          * Gesture::multiClick() gestures created with the default interval.
+          * @param seconds The interval, in seconds. Must be positive. The
+          *        default is 0.3.
+          */
+         void setDoubleClickInterval(double seconds);
+
+         /// Returns the double-click interval, in seconds.
+         double getDoubleClickInterval() const { return doubleClickInterval_; }
+
+         /// The possible ways of selecting nodes by dragging a region.
+         enum RegionSelectionMode
+         {
+            /// No region selection. This is the default.
+            REGION_SELECTION_NONE,
+
+            /// Drag a rectangle, from the press position to the pointer.
+            REGION_SELECTION_RECTANGLE,
+
+            /// Drag a lasso, following the pointer.
+            REGION_SELECTION_LASSO
+         };
+
+         /**
+          * Enables or disables region selection. When enabled, pressing a
+          * given mouse button (with given modifier keys) starts dragging a
+          * region; while the region is dragged, the registered nodes touching
+          * it are selected, and changes in the selection are reported once
+          * per frame through the signal returned by \c
+          * getSelectionChangedSignal(). Releasing the button ends the drag,
+          * but the nodes remain selected until the next drag starts (or
+          * until \c clearSelection() is called).
+          * <p>The placement of the registered nodes is captured when the drag
+          * starts; if the scene changes during the drag, call \c
+          * markSceneDirty() to capture it again. Nodes are tested with all
+          * picking masks at once (their bitwise OR).
+          * @param mode The region selection mode.
+          * @param button The mouse button used to drag the region, as an \c
+          *        osgGA::GUIEventAdapter::MouseButtonMask value.
+          * @param modKeyMask The modifier keys (as \c
+          *        osgGA::GUIEventAdapter::ModKeyMask flags) of which at least
+          *        one must be pressed to start a drag. Zero means that no
+          *        modifier is necessary.
+          * @note Region selection doesn't affect other events: the button
+          *       press and release still generate <tt>"MouseDown"</tt>,
+          *       <tt>"MouseUp"</tt> and maybe <tt>"Click"</tt>.
+          * @see RegionSelector for the details of how nodes are tested.
+          */
+         void setRegionSelection(
+            RegionSelectionMode mode,
+            unsigned button = osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON,
+            unsigned modKeyMask = osgGA::GUIEventAdapter::MODKEY_SHIFT);
+
+         /// A signal reporting changes in the selection.
+         typedef boost::signal<void (SelectionParams&)> SelectionSignal_t;
+
+         /**
+          * Returns the signal reporting changes in the selection made with
+          * region selection. This is typically used to call \c connect() on
+          * the returned signal.
+          */
+         SelectionSignal_t& getSelectionChangedSignal()
+         { return selectionChangedSignal_; }
+
+         /**
+          * Gets the nodes selected with region selection.
+          * @param selection Output parameter, where the nodes are stored.
+          */
+         void getSelection(Nodes_t& selection) const;
+
+         /**
+          * Clears the selection made with region selection, reporting the
+          * change through the signal returned by \c
+          * getSelectionChangedSignal(). A drag in progress is canceled.
+          */
+         void clearSelection();
+
+         /**
+          * Adds a gesture to be recognized for a given node. Gestures are
+          * recognized for the mouse pointer only, and independently of the
+          * other signals (for instance, a \c Gesture::multiClick(2) gesture
+          * doesn't replace the <tt>"DoubleClick"</tt> signal, though both use
+          * the interval set by \c setDoubleClickInterval() unless the gesture
+          * sets its own). A node can have any number of gestures.
+          * <p>Timed gestures are driven by a timer wheel advanced in the \c
+          * FRAME events; so, they are recognized in the first frame after
+          * their time expires.
+          * @param node The node for which the gesture will be recognized. It
+          *        must have been added with \c addNode().
+          * @param gesture The gesture.
+          * @return The signal triggered when the gesture is recognized. The
+          *         \c hit passed to the handlers is the one for the node
+          *         under the mouse pointer.
+          * @throw std::runtime_error If \c node was not added.
+          */
+         SignalPtr addGesture(const NodePtr node, const Gesture& gesture);
+
+         /**
+          * Enables or disables the \c EVENT_HOVER_DWELL and \c
+          * EVENT_HOVER_CANCEL events. These are driven by a \c
+          * Gesture::HOVER_DWELL gesture (see \c addGesture()) shared by all
+          * nodes, recognized for the node under the pointer: \c
+          * EVENT_HOVER_DWELL is triggered when it is recognized, and \c
+          * EVENT_HOVER_CANCEL when the pointer then leaves the node or moves
+          * beyond the tolerance.
+          * @param delay How long the pointer must stay over a node, in
+          *        seconds. Zero (the default) disables these events.
+          * @param tolerance How far the pointer can move without restarting
+          *        the dwell, in pixels.
+          * @note These events are generated for the mouse pointer only, and
+          *       not while a node is being dragged.
           */
-         void setMouseWheelFocusPolicy(const FocusPolicyFactory& policyFactory);
+         void setHoverDwell(double delay, float tolerance = 4.0f);
+
+         /**
+          * Sets the hysteresis used to decide which node is under the mouse
+          * pointer. With hysteresis, when the pointer is over silhouette
+          * edges or z-fighting surfaces, the node under it doesn't alternate
+          * every frame (generating storms of <tt>"MouseEnter"</tt> and
+          * <tt>"MouseLeave"</tt> events).
+          * <p>When picking finds a different node (or no node), the current
+          * one is kept while the pointer is within \c pixels of the last
+          * position where the current node was picked, or until the
+          * different result is found in \c frames consecutive picks; the
+          * switch happens only when both conditions are exceeded.
+          * @param pixels The distance, in pixels. Zero disables this
+          *        condition.
+          * @param frames The number of consecutive picks. Zero or one
+          *        disable this condition.
+          * @param depthTieTolerance When several hits are within this depth
+          *        of the nearest one (as a fraction of the distance from the
+          *        near plane to the far plane), the one belonging to the
+          *        current node is preferred. Zero disables this.
+          * @note All parameters are zero by default, meaning no hysteresis.
+          *       Depth ties are resolved only with a zero picking radius.
+          */
+         void setHoverHysteresis(float pixels, unsigned frames = 0,
+                                 double depthTieTolerance = 0.0);
 
       private:
+         /// The buttons of a mouse (or of other pointers).
+         enum MouseButton
+         {
+            LEFT_MOUSE_BUTTON,   ///< The left button.
+            MIDDLE_MOUSE_BUTTON, ///< The middle button.
+            RIGHT_MOUSE_BUTTON,  ///< The right button.
+            MOUSE_BUTTON_COUNT   ///< The number of buttons in a mouse.
+         };
+
+         /// The state of a pointer (the mouse or a \c PointerSource).
+         struct PointerState
+         {
+            /// Constructs a \c PointerState for a given pointer.
+            explicit PointerState(PointerId theId = MOUSE_POINTER);
+
+            /// The pointer ID.
+            PointerId id;
+
+            /**
+             * The \c Intersection_t structure for the node currently under
+             * the pointer. (Respecting the \c ignoreBackFaces_ flag.)
+             */
+            Intersection_t hit;
+
+            /// The node currently under the pointer.
+            NodePtr node;
+
+            /**
+             * The position (in the object coordinate system) of \c node (the
+             * node currently under the pointer).
+             */
+            osg::Vec3 position;
+
+            /// The node previously under the pointer.
+            NodePtr prevNode;
+
+            /**
+             * The position (in the object coordinate system) of \c prevNode
+             * (the node previously under the pointer).
+             */
+            osg::Vec3 prevPosition;
+
+            /**
+             * An array indicating (for every button) which was the node that
+             * received the last mouse down event. This is used to identify
+             * clicks.
+             */
+            NodePtr nodeThatGotMouseDown[MOUSE_BUTTON_COUNT];
+
+            /**
+             * An array indicating (for every button) which was the node that
+             * received the last click event. This is used to identify double
+             * clicks.
+             */
+            NodePtr nodeThatGotClick[MOUSE_BUTTON_COUNT];
+
+            /**
+             * An array indicating (for every button) the time at which the
+             * last click event has happened. This is used to identify double
+             * clicks.
+             */
+            double timeOfLastClick[MOUSE_BUTTON_COUNT];
+
+            /**
+             * The buttons pressed, as \c
+             * osgGA::GUIEventAdapter::MouseButtonMask flags. Used only for
+             * pointer sources.
+             */
+            unsigned buttonMask;
+         };
+
          /**
           * Returns the first node in an \c osg::NodePath that is present in the
           * list of nodes being "observed" by this \c EventHandler. This is
@@ -265,6 +1083,12 @@ namespace OSGUIsh
           */
          NodePtr getObservedNode(const osg::NodePath& nodePath);
 
+         /**
+          * Returns the registered nodes (the ones added with \c addNode()).
+          * @param nodes Output parameter, receiving the nodes.
+          */
+         void getRegisteredNodes(Nodes_t& nodes) const;
+
          /**
           * Handles a \c FRAME event triggered by OSG. Signals triggered here
           * are <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt> and
@@ -276,40 +1100,119 @@ namespace OSGUIsh
                                const osgGA::GUIEventAdapter& ea);
 
          /**
-          * Handles a \c PUSH event triggered by OSG. The only signal triggered
-          * here is <tt>"MouseDown"</tt>, but this function also does
-          * bookkeeping related to other mouse signals.
+          * Handles the press of a pointer button (a \c PUSH event triggered
+          * by OSG, for the mouse). The only signal triggered here is
+          * <tt>"MouseDown"</tt>, but this function also does bookkeeping
+          * related to other mouse signals.
+          * @param pointer The pointer whose button was pressed.
+          * @param button The button pressed.
+          * @param ea The event generated by OSG.
+          * @param pick The result of picking at the pointer position.
+          */
+         void handlePushEvent(PointerState& pointer, MouseButton button,
+                              const osgGA::GUIEventAdapter& ea,
+                              const PickResult& pick);
+
+         /**
+          * Handles the release of a pointer button (a \c RELEASE event
+          * triggered by OSG, for the mouse). Signals triggered here are
+          * <tt>"MouseUp"</tt>, <tt>"Click"</tt> and <tt>"DoubleClick"</tt>.
+          * @param pointer The pointer whose button was released.
+          * @param button The button released.
           * @param ea The event generated by OSG.
+          * @param pick The result of picking at the pointer position.
+          */
+         void handleReleaseEvent(PointerState& pointer, MouseButton button,
+                                 const osgGA::GUIEventAdapter& ea,
+                                 const PickResult& pick);
+
+         /**
+          * Triggers the <tt>"MouseEnter"</tt>, <tt>"MouseLeave"</tt> and
+          * <tt>"MouseMove"</tt> signals for a pointer, according to its
+          * current and previous states.
+          * @param pointer The pointer.
+          * @param ea The \c FRAME event generated by OSG.
           */
-         void handlePushEvent(const osgGA::GUIEventAdapter& ea);
+         void triggerHoverEvents(const PointerState& pointer,
+                                 const osgGA::GUIEventAdapter& ea);
 
          /**
-          * Handles a \c RELEASE event triggered by OSG. Signals triggered here
-          * are <tt>"MouseUp"</tt>, <tt>"Click"</tt> and <tt>"DoubleClick"</tt>.
+          * Sets the result of picking for a pointer. The current state becomes
+          * the previous one.
+          */
+         void setPointerPick(PointerState& pointer, const PickResult& pick);
+
+         /**
+          * Handles a multi-touch event, updating \c touchContacts_. The
+          * events for the contacts are generated in the next \c FRAME
+          * event, by \c handleTouchContacts().
           * @param ea The event generated by OSG.
           */
-         void handleReleaseEvent(const osgGA::GUIEventAdapter& ea);
+         void handleTouchEvent(const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Picks with all touch contacts and triggers the events for them.
+          * Contacts over HUDs and other absolute subgraphs are picked one by
+          * one; all others are picked in a single batch.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         void handleTouchContacts(osg::View* view,
+                                  const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Picks with all pointer sources (in a single batch) and triggers
+          * the events for them.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         void handlePointerSources(osg::View* view,
+                                   const osgGA::GUIEventAdapter& ea);
 
          /**
-          * Handles a \c KEYDOWN event triggered by OSG. The only signal
-          * triggered here is <tt>"KeyDown"</tt>.
+          * Handles a \c KEYDOWN event triggered by OSG. Signals triggered
+          * here are <tt>"KeyDown"</tt> and the signal for the key chord, if
+          * any (see \c getKeySignal()).
           * @param ea The event generated by OSG.
           */
          void handleKeyDownEvent(const osgGA::GUIEventAdapter& ea);
 
          /**
-          * Handles a \c KEYUP event triggered by OSG. The only signal triggered
-          * here is <tt>"KeyUp"</tt>.
+          * Handles a \c KEYUP event triggered by OSG. Signals triggered here
+          * are <tt>"KeyUp"</tt> and the signal for the key chord, if any (see
+          * \c getKeySignal()).
           * @param ea The event generated by OSG.
           */
          void handleKeyUpEvent(const osgGA::GUIEventAdapter& ea);
 
+         /**
+          * Adds the delta of a scroll event to the one being accumulated for
+          * the frame. If the focus changed since the last scroll event, the
+          * accumulated delta is first flushed to the node that had it.
+          * @param ea The \c SCROLL event generated by OSG.
+          * @param delta The scroll delta.
+          * @param hit The hit for the node under the mouse pointer.
+          */
+         void accumulateScroll(const osgGA::GUIEventAdapter& ea,
+                               const osg::Vec2& delta,
+                               const Intersection_t& hit);
+
+         /**
+          * Triggers the <tt>"Scroll"</tt> signal with the accumulated scroll
+          * delta, and resets it.
+          */
+         void flushScroll(const osgGA::GUIEventAdapter& ea);
+
          /**
           * Handles a \c SCROLL event triggered by OSG. The signals triggered
-          * here are <tt>"ScrollUp"</tt> and <tt>"ScrollDown"</tt>.
+          * here are <tt>"ScrollUp"</tt> and <tt>"ScrollDown"</tt>; the scroll
+          * delta is accumulated for the <tt>"Scroll"</tt> signal, triggered
+          * in the next \c FRAME event.
           * @param ea The event generated by OSG.
+          * @param pick The result of picking at the event coordinates.
           */
-         void handleScrollEvent(const osgGA::GUIEventAdapter& ea);
+         void handleScrollEvent(const osgGA::GUIEventAdapter& ea,
+                                const PickResult& pick);
 
          /**
           * The "radius" of the picker. If zero, will use an \c
@@ -333,14 +1236,40 @@ namespace OSGUIsh
          NodeMasks_t pickingMasks_;
 
          /**
-          * The values to be returned by the \c handle() method, depending on
-          * the event type it is handling. Currently, this is not initialized,
-          * meaning that \c handle(), by default, returns \c false for all event
-          * types.
-          * @todo Implement a method like \c setHandleReturnValue(), so that the
-          *        user can configure this.
+          * The number of distinct event types: each type is a bit flag, so
+          * there is one for each bit, plus \c NONE.
+          */
+         static const std::size_t NUM_EVENT_TYPES = 33;
+
+         /**
+          * The values to be returned by the \c handle() method, indexed by the
+          * position of the bit of the event type (plus one; index zero is
+          * for \c NONE).
           */
-         std::map <osgGA::GUIEventAdapter::EventType, bool> handleReturnValues_;
+         HandleReturnValue handleReturnValues_[NUM_EVENT_TYPES];
+
+         /// Was the event being handled consumed by some handler?
+         bool eventConsumed_;
+
+         /**
+          * Was the last mouse button press consumed? If so, the following
+          * drags and releases are consumed too.
+          */
+         bool pressConsumed_;
+
+         /**
+          * Triggers a signal, taking note if the event was consumed.
+          * @param signal The signal.
+          * @param params The parameters passed to the handlers.
+          */
+         void triggerSignal(const SignalPtr& signal, HandlerParams& params);
+
+         /**
+          * Returns the value \c handle() must return for an event, after it
+          * was handled.
+          */
+         bool getHandleReturnValue(
+            osgGA::GUIEventAdapter::EventType eventType) const;
 
          /// Type mapping an event type to the signal object.
          typedef std::map <Event, SignalPtr> SignalCollection_t;
@@ -355,47 +1284,474 @@ namespace OSGUIsh
           */
          SignalsMap_t signals_;
 
+         //
+         // For the pointer events ("MouseEnter", "MouseLeave", "MouseMove",
+         // "MouseDown", "MouseUp", "Click" and "DoubleClick")
+         //
+
+         /// The state of the mouse pointer.
+         PointerState mouse_;
+
+         /**
+          * The view the mouse pointer is in (the view of the last pointer
+          * event); \c NULL before the first one. Only compared, never
+          * dereferenced.
+          */
+         const osg::View* mouseView_;
+
+         /// A pointer source and the state of its pointer.
+         struct PointerSourceEntry
+         {
+            /// The pointer source; \c NULL if it was removed.
+            PointerSourcePtr source;
+
+            /// The pointer state.
+            PointerState state;
+         };
+
+         /// Type mapping pointer IDs to pointer sources.
+         typedef std::map<PointerId, PointerSourceEntry> PointerSources_t;
+
+         /// The pointer sources added to this \c EventHandler.
+         PointerSources_t pointerSources_;
+
+         /// The ID to be given to the next pointer added.
+         PointerId nextPointerId_;
+
+         /// A touch contact (a finger on a touch screen).
+         struct TouchContact
+         {
+            /// Constructs a \c TouchContact.
+            TouchContact()
+               : xNormalized(0.0f), yNormalized(0.0f), began(false),
+                 ended(false)
+            { }
+
+            /// The pointer state.
+            PointerState state;
+
+            /// The horizontal position, normalized to [-1, 1].
+            float xNormalized;
+
+            /// The vertical position, normalized to [-1, 1] (upwards).
+            float yNormalized;
+
+            /// Has the contact began since the last \c FRAME?
+            bool began;
+
+            /// Has the contact ended since the last \c FRAME?
+            bool ended;
+         };
+
+         /// Type mapping touch point IDs (as given by OSG) to contacts.
+         typedef std::map<unsigned, TouchContact> TouchContacts_t;
+
+         /// The touch contacts currently active.
+         TouchContacts_t touchContacts_;
+
          /**
-          * The \c Intersection_t structure for the node currently under the
-          * mouse pointer. (Respecting the \c ignoreBackFaces_ flag.)
+          * The state of the last touch contact that ended. Its click
+          * bookkeeping is passed on to new contacts, so that double taps
+          * generate <tt>"DoubleClick"</tt> events.
           */
-         Intersection_t hitUnderMouse_;
+         PointerState lastTouch_;
 
          //
-         // For "MouseEnter", "MouseLeave", "MouseMove"
+         // For region selection
          //
 
-         /// The node currently under the mouse pointer.
-         NodePtr nodeUnderMouse_;
+         /**
+          * Starts dragging a region for region selection, at the position of
+          * a \c PUSH event.
+          * @param view The view displaying the scene.
+          * @param ea The event generated by OSG.
+          */
+         void beginRegionDrag(osg::View* view,
+                              const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Updates the region being dragged with the position of a \c DRAG
+          * or \c RELEASE event.
+          * @param view The view displaying the scene.
+          * @param ea The event generated by OSG.
+          */
+         void extendRegionDrag(osg::View* view,
+                               const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Updates the selection for the region being dragged, and triggers
+          * the signal reporting the changes, if any.
+          * @param view The view displaying the scene.
+          */
+         void updateRegionSelection(osg::View* view);
+
+         /**
+          * Captures the placement of the registered nodes in \c
+          * regionSelector_.
+          * @param view The view displaying the scene.
+          * @param removed Output parameter, where the selected nodes that can
+          *        no longer be selected are stored.
+          */
+         void captureRegionCandidates(osg::View* view, Nodes_t& removed);
+
+         /// The region selection mode.
+         RegionSelectionMode regionSelectionMode_;
+
+         /// The mouse button used for region selection.
+         unsigned regionSelectionButton_;
+
+         /// The modifier keys used for region selection.
+         unsigned regionSelectionModKeyMask_;
+
+         /// Finds the nodes inside the region.
+         RegionSelector regionSelector_;
 
          /**
-          * The position (in the object coordinate system) of \c nodeUnderMouse_
-          * (the node currently under the mouse pointer).
+          * The region being dragged, in window coordinates: two opposite
+          * corners for a rectangle, the vertices of a lasso.
           */
-         osg::Vec3 positionUnderMouse_;
+         RegionSelector::Polygon_t regionPoints_;
 
-         /// The node previously under the mouse pointer.
-         NodePtr prevNodeUnderMouse_;
+         /// Is a region being dragged?
+         bool regionDragging_;
+
+         /// Has the region changed since the selection was last updated?
+         bool regionChanged_;
 
          /**
-          * The position (in the object coordinate system) of \c
-          * prevNodeUnderMouse_ (the node previously under the mouse pointer).
+          * Must the placement of the registered nodes be captured again
+          * before updating the selection?
           */
-         osg::Vec3 prevPositionUnderMouse_;
+         bool regionCandidatesDirty_;
+
+         /// The signal reporting changes in the selection.
+         SelectionSignal_t selectionChangedSignal_;
 
          //
-         // For "Click" and "DoubleClick"
+         // For drag and drop
          //
 
-         /// The buttons of a mouse.
-         enum MouseButton
+         /// The state of a drag (of the mouse pointer).
+         struct DragState
          {
-            LEFT_MOUSE_BUTTON,   ///< The left button.
-            MIDDLE_MOUSE_BUTTON, ///< The middle button.
-            RIGHT_MOUSE_BUTTON,  ///< The right button.
-            MOUSE_BUTTON_COUNT   ///< The number of buttons in a mouse.
+            /// Constructs a \c DragState, with no drag.
+            DragState();
+
+            /**
+             * Was a button pressed over a node, which will be dragged if the
+             * pointer moves enough?
+             */
+            bool pending;
+
+            /// Is a node being dragged?
+            bool active;
+
+            /// The button that started the drag.
+            MouseButton button;
+
+            /// Where the button was pressed, in window coordinates.
+            osg::Vec2 pressPosition;
+
+            /// Where the pointer was at the last \c EVENT_DRAG.
+            osg::Vec2 lastPosition;
+
+            /**
+             * The result of picking when the button was pressed. While
+             * dragging, its hit is updated with the projected position.
+             */
+            PickResult pick;
+
+            /**
+             * The matrix taking window coordinates to the picked node's world
+             * coordinates.
+             */
+            osg::Matrixd fromWindow;
+
+            /**
+             * The matrix taking world coordinates to the local coordinates of
+             * the hit.
+             */
+            osg::Matrixd worldToLocal;
+
+            /// The point where the drag started, in world coordinates.
+            osg::Vec3d origin;
+
+            /**
+             * The constraint plane normal or axis direction, in world
+             * coordinates.
+             */
+            osg::Vec3d direction;
+
+            /// Is the constraint an axis (instead of a plane)?
+            bool alongAxis;
+
+            /// The drop target found by the last probe.
+            NodePtr dropTarget;
+
+            /// The time of the last drop target probe.
+            double timeOfLastProbe;
          };
 
+         /**
+          * Starts dragging \c drag_.pick.node, computing the drag constraint
+          * and triggering the <tt>"DragStart"</tt> signal.
+          * @param view The view displaying the scene.
+          * @param ea The event generated by OSG.
+          */
+         void beginDrag(osg::View* view, const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Handles a \c FRAME event while dragging: triggers the
+          * <tt>"Drag"</tt> signal if the pointer moved, and probes for the
+          * drop target if it is time to.
+          * @param view The view displaying the scene.
+          * @param ea The event generated by OSG.
+          */
+         void handleDragFrame(osg::View* view,
+                              const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Ends the drag, triggering the <tt>"Drop"</tt> and
+          * <tt>"DragEnd"</tt> signals.
+          * @param view The view displaying the scene.
+          * @param ea The \c RELEASE event generated by OSG.
+          */
+         void endDrag(osg::View* view, const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Projects a window position onto the drag constraint, updating the
+          * hit in \c drag_.pick.
+          * @return \c false if the position cannot be projected (when the
+          *         picking ray is parallel to the constraint); in this case,
+          *         the hit is not updated.
+          */
+         bool projectOnDragConstraint(float x, float y);
+
+         /**
+          * Finds the registered node under a window position, ignoring the
+          * node being dragged.
+          * @param view The view displaying the scene.
+          * @param x The horizontal position, in window coordinates.
+          * @param y The vertical position, in window coordinates.
+          */
+         NodePtr probeDropTarget(osg::View* view, float x, float y);
+
+         /// Triggers a drag and drop signal for a given node.
+         void triggerDragEvent(const NodePtr& node, Event event,
+                               const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Checks whether a node can be dragged, that is, if it has a drag
+          * and drop handler connected.
+          */
+         bool isDraggable(const NodePtr& node) const;
+
+         /// The state of the current drag, if any.
+         DragState drag_;
+
+         /// The drag constraint.
+         DragConstraint dragConstraint_;
+
+         /// The direction used by the drag constraint, if any.
+         osg::Vec3d dragConstraintDirection_;
+
+         /// The rate of drop target probes; zero if disabled.
+         double dropProbeRate_;
+
+         /**
+          * The distance, in pixels, the pointer must move with a button
+          * pressed over a node to start dragging it.
+          */
+         float dragThreshold_;
+
+         /// The maximum time, in seconds, between the clicks of a double click.
+         double doubleClickInterval_;
+
+         //
+         // For gestures
+         //
+
+         /// A gesture added for a node, and the state of its recognition.
+         struct GestureEntry
+         {
+            /**
+             * The node for which the gesture is recognized. \c NULL for the
+             * hover dwell gesture set by \c setHoverDwell(), which is
+             * recognized for the node under the pointer.
+             */
+            NodePtr node;
+
+            /// The gesture.
+            Gesture gesture;
+
+            /// The signal triggered when the gesture is recognized.
+            SignalPtr signal;
+
+            /// The number of clicks so far (for \c Gesture::MULTI_CLICK).
+            unsigned clicks;
+
+            /// The value of \c clickSerial_ at the last click.
+            unsigned long lastClickSerial;
+
+            /// The time of the last click (for \c Gesture::MULTI_CLICK).
+            double timeOfLastClick;
+
+            /**
+             * Where the motion tolerance is measured from (the first click,
+             * the press position or where the pointer stopped), in window
+             * coordinates.
+             */
+            osg::Vec2 anchor;
+
+            /// When the pending timer, if any, expires.
+            double due;
+
+            /// Is the entry in \c trackedGestures_?
+            bool tracked;
+
+            /**
+             * Is the gesture enabled? Only the gesture set by \c
+             * setHoverDwell() is ever disabled.
+             */
+            bool enabled;
+
+            /**
+             * Was the gesture recognized since its tracking started? (For \c
+             * Gesture::HOVER_DWELL.)
+             */
+            bool recognized;
+         };
+
+         /// A sequence of gesture entries.
+         typedef std::vector<GestureEntry> GestureEntries_t;
+
+         /// Type mapping nodes to the indices of their gesture entries.
+         typedef std::map<NodePtr, std::vector<std::size_t> > GestureIndex_t;
+
+         /**
+          * Updates the gestures for the press of a mouse button, starting
+          * the timers for long-presses and hold-repeats.
+          * @param view The view displaying the scene.
+          * @param ea The \c PUSH event generated by OSG.
+          * @param node The node under the pointer.
+          */
+         void recognizePressGestures(osg::View* view,
+                                     const osgGA::GUIEventAdapter& ea,
+                                     const NodePtr& node);
+
+         /**
+          * Updates the gestures for the release of a mouse button, canceling
+          * long-presses and hold-repeats, and counting multi-clicks.
+          * @param view The view displaying the scene.
+          * @param ea The \c RELEASE event generated by OSG.
+          * @param click The result of picking at the pointer position, if the
+          *        release completed a click; otherwise, an empty result.
+          */
+         void recognizeReleaseGestures(osg::View* view,
+                                       const osgGA::GUIEventAdapter& ea,
+                                       const PickResult& click);
+
+         /**
+          * Updates the gestures in a \c FRAME event: checks the motion of the
+          * pointer against the tolerance of the tracked gestures, starts
+          * hover dwells, and triggers the gestures whose timers expired.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         void recognizeFrameGestures(osg::View* view,
+                                     const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Starts tracking the pointer motion for a gesture, and schedules its
+          * timer.
+          * @param index The index of the gesture entry.
+          * @param anchor Where the motion tolerance is measured from.
+          * @param due When the timer expires.
+          */
+         void trackGesture(std::size_t index, const osg::Vec2& anchor,
+                           double due);
+
+         /// Stops tracking a gesture, canceling its timer.
+         void untrackGesture(std::size_t index);
+
+         /// Triggers the signal of a gesture.
+         void triggerGesture(std::size_t index,
+                             const osgGA::GUIEventAdapter& ea,
+                             const Intersection_t& hit);
+
+         /**
+          * Ends a hover dwell (because the pointer moved away), triggering \c
+          * EVENT_HOVER_CANCEL if it is the one set by \c setHoverDwell() and
+          * it was recognized. Doesn't untrack the gesture.
+          * @param index The index of the gesture entry.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         void endHoverDwell(std::size_t index,
+                            const osgGA::GUIEventAdapter& ea);
+
+         /// The gestures added; timer IDs are indices into this.
+         GestureEntries_t gestures_;
+
+         /// The indices of the gestures added for each node.
+         GestureIndex_t gesturesByNode_;
+
+         /**
+          * The indices of the gestures whose pointer motion is being tracked:
+          * long-presses and hold-repeats while the button is held, and hover
+          * dwells while the pointer is over their node. This is usually
+          * empty, so that frames cost nothing when no gesture is going on.
+          */
+         std::vector<std::size_t> trackedGestures_;
+
+         /// The timers of the gestures.
+         TimerWheel gestureTimers_;
+
+         /// A counter incremented at every click of the mouse.
+         unsigned long clickSerial_;
+
+         /// The node for which hover dwells are being tracked.
+         NodePtr dwellNode_;
+
+         /**
+          * The index of the gesture entry for \c EVENT_HOVER_DWELL and \c
+          * EVENT_HOVER_CANCEL, added the first time \c setHoverDwell() is
+          * called. Before that, the largest \c std::size_t.
+          */
+         std::size_t hoverDwellGesture_;
+
+         //
+         // For hover hysteresis
+         //
+
+         /**
+          * Applies the hover hysteresis to the result of picking for the mouse
+          * pointer, maybe replacing it with the current node.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          * @param pick The picking result; updated in place.
+          */
+         void applyHoverHysteresis(osg::View* view,
+                                   const osgGA::GUIEventAdapter& ea,
+                                   PickResult& pick);
+
+         /// The hysteresis distance, in pixels; zero if disabled.
+         float hysteresisPixels_;
+
+         /// The hysteresis number of picks; zero or one if disabled.
+         unsigned hysteresisFrames_;
+
+         /// The tolerance for depth ties; zero if disabled.
+         double depthTieTolerance_;
+
+         /// Where the current node was last picked, in window coordinates.
+         osg::Vec2 hysteresisAnchor_;
+
+         /// The node picked instead of the current one, if any.
+         NodePtr hysteresisCandidate_;
+
+         /// For how many consecutive picks \c hysteresisCandidate_ was found.
+         unsigned hysteresisCount_;
+
          /**
           * Returns the mouse button used in the \c osgGA::GUIEventAdapter
           * passed as parameter.
@@ -403,64 +1759,398 @@ namespace OSGUIsh
          MouseButton getMouseButton(const osgGA::GUIEventAdapter& ea);
 
          /**
-          * Updates the member variables used to store picking info: \c
-          * nodeUnderMouse_, \c positionUnderMouse_, \c prevNodeUnderMouse_ and
-          * \c prevPositionUnderMouse_.
+          * Updates the picking info in \c mouse_.
           * @param view The view displaying the scene.
           * @param ea The event generated by OSG.
-          * @note The implementation just calls either \c updatePickingDataLine
-          *       or \c updatePickingDataPolytope. This is in fact somewhat
-          *       ridiculous, since these functions are in fact quite
-          *       similar. The replication is necessary because, for some
-          *       reason, OSG "interceptors" don't have a common
-          *       interface/subclass -- so, I had to do implement polymorphism
-          *       by hand.
-          */
-         void updatePickingData(osg::View* view,
+          * @return \c false if there are no new picking results, because the
+          *         schedule didn't call for picking in this frame, because
+          *         picking could not be finished within \c pickBudget_ or
+          *         because the asynchronous picking didn't finish yet. In this
+          *         case, nothing is updated.
+          */
+         bool updatePickingData(osg::View* view,
                                 const osgGA::GUIEventAdapter& ea);
 
          /**
-          * The version of \c updatePickingData() using an \c
-          * osgUtil::LineSegmentIntersector.
+          * Checks whether the picking for mouse enter, leave and move events
+          * must be done in the current frame, according to \c pickSchedule_.
+          * This also updates the bookkeeping used to take this decision.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         bool isPickDue(osg::View* view, const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Checks whether the camera of a given view has changed since the
+          * last call to this method.
+          * @param view The view whose camera will be checked.
+          */
+         bool hasCameraChanged(osg::View* view);
+
+         /**
+          * Captures the candidates for picking (see \c
+          * PickTraversal::setTriangleCache()) under the mouse pointer among
+          * the registered nodes, and posts a picking request with them to \c
+          * asyncPicker_.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          */
+         void postAsyncPick(osg::View* view, const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Fetches the result of the last request posted to \c asyncPicker_,
+          * if available.
+          * @param view The view displaying the scene.
+          * @param result Output parameter, where the result is stored.
+          * @return \c true if a result was available.
+          */
+         bool fetchAsyncPick(osg::View* view, PickResult& result);
+
+         /**
+          * Checks whether any node in a node path, except the last one, is
+          * being observed by this \c EventHandler.
+          */
+         bool hasObservedAncestor(const osg::NodePath& nodePath);
+
+         /// A node path that keeps its nodes referenced.
+         typedef std::vector< osg::ref_ptr<osg::Node> > RefNodePath_t;
+
+         /**
+          * Some node paths to registered nodes, selected for a given camera
+          * or view. Walking up the scene graph from every registered node is
+          * costly, so the paths are found again only when the scene changes
+          * (that is, when \c sceneRevision_ changes) or when they are needed
+          * for another camera or view.
+          */
+         struct NodePathCache
+         {
+            /// Constructs an invalid \c NodePathCache.
+            NodePathCache() : owner(0), sceneRevision(0), valid(false) { }
+
+            /**
+             * Are the paths up to date, for a given camera or view and scene
+             * revision?
+             */
+            bool isValidFor(const osg::Object* theOwner,
+                            unsigned theSceneRevision) const
+            {
+               return valid && owner == theOwner
+                  && sceneRevision == theSceneRevision;
+            }
+
+            /**
+             * The camera or view the paths were selected for. Only compared,
+             * never dereferenced.
+             */
+            const osg::Object* owner;
+
+            /// The value of \c sceneRevision_ when the paths were found.
+            unsigned sceneRevision;
+
+            /// Were the paths ever found?
+            bool valid;
+
+            /// The paths.
+            std::vector<RefNodePath_t> paths;
+         };
+
+         /**
+          * The paths to the registered nodes pickable through a view's
+          * cameras, used by \c postAsyncPick(). Paths under other registered
+          * nodes are not included.
+          */
+         NodePathCache asyncPickPaths_;
+
+         /// The worker used for asynchronous picking, if enabled.
+         boost::scoped_ptr<AsyncPicker> asyncPicker_;
+
+         /**
+          * The view for which the last request was posted to \c
+          * asyncPicker_. Only compared, never dereferenced.
+          */
+         const osg::View* asyncPickView_;
+
+         /**
+          * Makes the mouse pointer belong to a given view, discarding the
+          * picking in progress for the previous one.
+          */
+         void setMouseView(const osg::View* view);
+
+         /// The thread pool used to pick in parallel, if any.
+         osg::ref_ptr<PickThreadPool> pickThreadPool_;
+
+         /// The service shared with other event handlers, if any.
+         osg::ref_ptr<PickService> pickService_;
+
+         /**
+          * Continues the traversal in \c hoverTraversal_, within the time
+          * given by \c pickBudget_, passing to the next picking masks as
+          * necessary.
+          * @param view The view displaying the scene.
+          * @param result Output parameter, where the result is stored when
+          *        the traversal finishes.
+          * @return \c true if the traversal has finished.
+          */
+         bool resumeHoverPick(osg::View* view, PickResult& result);
+
+         /**
+          * Selects, among the hits of a picking traversal, the one that
+          * determines the picked node, respecting \c ignoreBackFaces_ and
+          * \c depthTieTolerance_.
+          * @param camera The camera used for picking.
+          * @param hits The hits, sorted by distance from the viewer.
+          * @param result Output parameter, where the result is stored.
+          * @return \c true if a hit was selected.
+          */
+         bool selectHit(const osg::Camera* camera,
+                        const PickTraversal::Hits_t& hits,
+                        PickResult& result);
+
+         /**
+          * The time budget, in seconds, for the picking done while handling
+          * \c FRAME events. Zero means "no limit".
+          */
+         double pickBudget_;
+
+         /**
+          * The traversal used for picking while handling \c FRAME events,
+          * when there is a time budget for it. It may run across several
+          * frames.
+          */
+         PickTraversal hoverTraversal_;
+
+         /// The index in \c pickingMasks_ used by \c hoverTraversal_.
+         std::size_t hoverMaskIndex_;
+
+         /// The horizontal window coordinate picked by \c hoverTraversal_.
+         float hoverX_;
+
+         /// The vertical window coordinate picked by \c hoverTraversal_.
+         float hoverY_;
+
+         /// The schedule used for picking.
+         PickSchedule pickSchedule_;
+
+         /// The maximum picking rate, used with \c PICK_AT_MAX_RATE.
+         double maxPickRate_;
+
+         /// The time (as given by the events) of the last pick.
+         double timeOfLastPick_;
+
+         /// Has the mouse pointer moved since the last pick?
+         bool pointerMoved_;
+
+         /**
+          * Was the scene marked as dirty (with \c markSceneDirty()) since
+          * the last pick?
+          */
+         bool pickDirty_;
+
+         /// The camera view matrix when \c hasCameraChanged() was last called.
+         osg::Matrixd lastViewMatrix_;
+
+         /**
+          * The camera projection matrix when \c hasCameraChanged() was last
+          * called.
+          */
+         osg::Matrixd lastProjectionMatrix_;
+
+         /**
+          * The viewport (as x, y, width and height) when \c
+          * hasCameraChanged() was last called.
+          */
+         osg::Vec4d lastViewport_;
+
+         /**
+          * Converts the mouse position of an event to window coordinates, as
+          * expected by \c pickAt().
           * @param view The view displaying the scene.
           * @param ea The event generated by OSG.
-          * @see updatePickingData() for information on what this function does.
+          * @param x Output parameter, the horizontal window coordinate.
+          * @param y Output parameter, the vertical window coordinate.
           */
-         void updatePickingDataLine(osg::View* view,
-                                    const osgGA::GUIEventAdapter& ea);
+         void getWindowCoords(osg::View* view,
+                              const osgGA::GUIEventAdapter& ea,
+                              float& x, float& y);
 
          /**
-          * The version of \c updatePickingData() using an \c
-          * osgUtil::PolytopeIntersector.
+          * Converts a normalized position (in the [-1, 1] range, growing
+          * upwards) to window coordinates, as expected by \c pickAt(). If
+          * the view's master camera has no viewport (as in display walls and
+          * in some stereo setups, where only the slaves have viewports), its
+          * window coordinates are taken to be its clip coordinates, so the
+          * normalized position is returned unchanged.
           * @param view The view displaying the scene.
+          * @param xNormalized The normalized horizontal position.
+          * @param yNormalized The normalized vertical position.
+          * @param x Output parameter, the horizontal window coordinate.
+          * @param y Output parameter, the vertical window coordinate.
+          */
+         void getWindowCoords(osg::View* view,
+                              float xNormalized, float yNormalized,
+                              float& x, float& y);
+
+         /**
+          * Picks at the position of a mouse event. This is used for events
+          * other than \c FRAME, which must be resolved at their exact
+          * coordinates, not at the ones of the last \c FRAME.
+          * @param view The view displaying the scene. If this is \c NULL,
+          *        the current picking info (from the last \c FRAME) is
+          *        returned instead.
           * @param ea The event generated by OSG.
-          * @see updatePickingData() for information on what this function does.
+          */
+         PickResult pickAtEvent(osg::View* view,
+                                const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * Does the real picking work for \c pickAt(), using either \c
+          * pickLine() or \c pickPolytope(). This is in fact somewhat
+          * ridiculous, since these functions are in fact quite similar. The
+          * replication is necessary because, for some reason, OSG
+          * "interceptors" don't have a common interface/subclass -- so, I had
+          * to do implement polymorphism by hand.
+          * @param view The view displaying the scene.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param result Output parameter, where the result is stored.
+          */
+         void pick(osg::View* view, float x, float y, PickResult& result);
+
+         /**
+          * The version of \c pick() using a line segment (through a \c
+          * PickTraversal).
+          * @see pick() for information on what this function does.
+          */
+         void pickLine(osg::View* view, float x, float y, PickResult& result);
+
+         /**
+          * Runs a \c BatchPickTraversal, splitting the batch among the threads
+          * of \c pickThreadPool_ if it is large enough.
+          * @param camera The camera whose subgraph will be picked.
+          * @param segments The segments to pick with.
+          * @param mask The traversal mask to use.
+          * @param hits Output parameter, where the hits are stored.
+          */
+         void runBatchPick(osg::Camera* camera,
+                           const BatchPickTraversal::Segments_t& segments,
+                           osg::Node::NodeMask mask,
+                           BatchPickTraversal::Hits_t& hits);
+
+         /**
+          * The version of \c pick() using an \c osgUtil::PolytopeIntersector.
+          * @see pick() for information on what this function does.
           * @note This function does not even try to ignore back faces when
           *       <tt>ignoreBackFaces_ == true</tt> (the \c PolytopeIntersector
           *       does not provide the intersection normals).
           */
-         void updatePickingDataPolytope(osg::View* view,
-                                        const osgGA::GUIEventAdapter& ea);
+         void pickPolytope(osg::View* view, float x, float y,
+                           PickResult& result);
+
+         /**
+          * Picks the nodes in overlays, using \c overlayIndex_ (which is
+          * rebuilt if necessary).
+          * @param view The view displaying the scene.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param result Output parameter, where the result is stored.
+          * @return \c true if a node in an overlay was picked.
+          */
+         bool pickOverlay(osg::View* view, float x, float y,
+                          PickResult& result);
+
+         /**
+          * Collects, as picking roots, the registered nodes viewed through an
+          * absolute transform (like a nested HUD camera) or an \c
+          * osg::Projection under a given camera. A \c BatchPickTraversal
+          * doesn't traverse these subgraphs, so they must be picked apart.
+          * The paths to these nodes are kept in \c absolutePaths_; only the
+          * matrices along them are computed at every call.
+          * @param camera The camera through which the scene is viewed.
+          * @param roots Output parameter, receiving the roots.
+          */
+         void getAbsoluteRoots(osg::Camera* camera,
+                               PickTraversal::Roots_t& roots);
 
          /**
-          * An array indicating (for every mouse button) which was the node that
-          * received the last mouse down event. This is used to identify clicks.
+          * Picks only some subgraphs, honoring the picking masks.
+          * @param view The view displaying the scene.
+          * @param roots The subgraphs to pick, as built for the view's camera.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param result Output parameter, where the result is stored.
+          * @return \c true if a node was picked.
           */
-         NodePtr nodeThatGotMouseDown_[MOUSE_BUTTON_COUNT];
+         bool pickRoots(osg::View* view, const PickTraversal::Roots_t& roots,
+                        float x, float y, PickResult& result);
+
+         /// The paths used by \c getAbsoluteRoots().
+         NodePathCache absolutePaths_;
+
+         /// Is overlay picking enabled?
+         bool overlayPicking_;
+
+         /// Are overlay nodes picked by their geometry (not just bounds)?
+         bool overlayGeometry_;
+
+         /// The 2D index of the nodes in overlays.
+         OverlayIndex overlayIndex_;
+
+         /// The scale applied to the cameras' LOD scale when picking.
+         float pickLODScale_;
 
          /**
-          * An array indicating (for every mouse button) which was the node that
-          * received the last click event. This is used to identify double
-          * clicks.
+          * The triangles used by batch picking, shared by all its traversals
+          * (including the ones running in \c pickThreadPool_).
           */
-         NodePtr nodeThatGotClick_[MOUSE_BUTTON_COUNT];
+         osg::ref_ptr<TriangleCache> triangleCache_;
+
+         /// An entry in the cache of picking results.
+         struct PickCacheEntry
+         {
+            /// The view used for picking.
+            osg::View* view;
+
+            /// The horizontal window coordinate picked.
+            float x;
+
+            /// The vertical window coordinate picked.
+            float y;
+
+            /// The value of \c sceneRevision_ when the pick was made.
+            unsigned sceneRevision;
+
+            /**
+             * The number of the view's frame when the pick was made. The
+             * events of a frame come before its update traversal, so results
+             * from another frame may be out of date.
+             */
+            unsigned frameNumber;
+
+            /// The picking result itself.
+            PickResult result;
+         };
+
+         /// The maximum number of entries kept in \c pickCache_.
+         static const std::size_t PICK_CACHE_SIZE = 32;
 
          /**
-          * An array indicating (for every mouse button) the time at which the
-          * last click event has happened. This is used to identify double
-          * clicks.
+          * The most recent picking results. Kept small (see \c
+          * PICK_CACHE_SIZE), so that a linear search is fine.
           */
-         double timeOfLastClick_[MOUSE_BUTTON_COUNT];
+         std::vector<PickCacheEntry> pickCache_;
+
+         /**
+          * Where the next entry will be written in \c pickCache_ once it is
+          * full.
+          */
+         std::size_t nextPickCacheEntry_;
+
+         /**
+          * A counter incremented whenever the scene is known to have changed
+          * (see \c markSceneDirty()). Cached picking results from a different
+          * revision are not reused.
+          */
+         unsigned sceneRevision_;
 
          //
          // For "KeyUp" and "KeyDown"
@@ -469,8 +2159,106 @@ namespace OSGUIsh
          /// The node receiving keyboard events.
          NodePtr kbdFocus_;
 
-         /// The focus policy for keyboard-related events.
-         FocusPolicyPtr kbdFocusPolicy_;
+         /// The focus policy for keyboard-related events; null if manual.
+         FocusPolicy* kbdFocusPolicy_;
+
+         /// An entry in \c keySignals_: a key chord and its signal.
+         struct KeySignalEntry
+         {
+            /// The node with the focus.
+            NodePtr node;
+
+            /// The key.
+            int key;
+
+            /// The modifier keys, normalized by \c normalizeModKeyMask().
+            unsigned modKeyMask;
+
+            /// \c EVENT_KEY_DOWN or \c EVENT_KEY_UP.
+            Event event;
+
+            /// The signal; null if the entry is empty.
+            SignalPtr signal;
+         };
+
+         /// A sequence of key signal entries.
+         typedef std::vector<KeySignalEntry> KeySignalEntries_t;
+
+         /**
+          * Normalizes a modifier key mask, so that the left and right keys
+          * are not distinguished, and other modifiers are ignored.
+          */
+         static unsigned normalizeModKeyMask(unsigned modKeyMask);
+
+         /**
+          * Normalizes a key, so that letters are not case sensitive (their
+          * case depends on Shift and Caps Lock, which are handled by the
+          * modifier key mask or ignored).
+          */
+         static int normalizeKey(int key);
+
+         /**
+          * Finds the index, in \c keySignals_, of the entry for a key chord;
+          * or, if not present, of the empty entry where it would be inserted.
+          * \c keySignals_ must not be empty.
+          * @param key The key, already normalized.
+          * @param modKeyMask The modifier keys, already normalized.
+          */
+         std::size_t findKeySignal(const osg::Node* node, int key,
+                                   unsigned modKeyMask, Event event) const;
+
+         /**
+          * Triggers the signal of the key chord of a keyboard event, if
+          * there is one for the node with the focus.
+          * @param event Either \c EVENT_KEY_DOWN or \c EVENT_KEY_UP.
+          * @param ea The keyboard event generated by OSG.
+          */
+         void triggerKeySignal(Event event, const osgGA::GUIEventAdapter& ea);
+
+         /**
+          * The signals for key chords, in a hash table with open addressing
+          * and linear probing. Its size is zero or a power of two.
+          */
+         KeySignalEntries_t keySignals_;
+
+         /// The number of non-empty entries in \c keySignals_.
+         std::size_t numKeySignals_;
+
+         /**
+          * Moves the keyboard focus if a \c KEYDOWN event is for one of the
+          * focus navigation keys.
+          * @param view The view displaying the scene.
+          * @param ea The \c KEYDOWN event generated by OSG.
+          */
+         void navigateFocus(osg::View* view,
+                            const osgGA::GUIEventAdapter& ea);
+
+         /// Is spatial focus navigation enabled?
+         bool focusNavigation_;
+
+         /**
+          * The focus navigation keys, indexed by \c
+          * FocusNavigator::Direction.
+          */
+         int navigationKeys_[4];
+
+         /// Finds the nodes to move the focus to.
+         FocusNavigator focusNavigator_;
+
+         /**
+          * Moves the keyboard focus along the focus chain if a \c KEYDOWN
+          * event is for Tab.
+          * @param view The view displaying the scene.
+          * @param ea The \c KEYDOWN event generated by OSG.
+          */
+         void traverseFocusChain(osg::View* view,
+                                 const osgGA::GUIEventAdapter& ea);
+
+         /// Is the focus chain enabled?
+         bool focusChainEnabled_;
+
+         /// The focus chain.
+         FocusChain focusChain_;
 
          //
          // For "MouseWheelUp" and "MouseWheelDown"
@@ -479,8 +2267,58 @@ namespace OSGUIsh
          /// The node receiving mouse wheel events.
          NodePtr wheelFocus_;
 
-         /// The focus policy for mouse wheel-related events.
-         FocusPolicyPtr wheelFocusPolicy_;
+         /// The focus policy for mouse wheel-related events; null if manual.
+         FocusPolicy* wheelFocusPolicy_;
+
+         /// Is there a scroll delta waiting to be flushed?
+         bool scrollPending_;
+
+         /// The node for which the scroll delta is being accumulated.
+         NodePtr scrollNode_;
+
+         /// The scroll delta accumulated in the frame.
+         osg::Vec2 scrollDelta_;
+
+         /// The hit of the last scroll event in the frame.
+         Intersection_t scrollHit_;
+
+         //
+         // For focus changes
+         //
+
+         /**
+          * Moves the focus to a given node, triggering the signals for the
+          * focus change. Does nothing if the node already has the focus.
+          * @param kind The kind of focus.
+          * @param node The node getting the focus.
+          * @param ea The event that caused the focus to move.
+          * @param remember Store the node losing the focus in the history?
+          */
+         void moveFocus(FocusKind kind, const NodePtr& node,
+                        const osgGA::GUIEventAdapter& ea,
+                        bool remember = true);
+
+         /// The nodes that had the focus before, in a ring buffer.
+         struct FocusHistory
+         {
+            /// The nodes; the size of this is the capacity of the ring.
+            std::vector<NodePtr> nodes;
+
+            /// The index of the newest node.
+            std::size_t newest;
+
+            /// The number of nodes in the ring.
+            std::size_t count;
+         };
+
+         /// The focus histories, indexed by \c FocusKind.
+         FocusHistory focusHistories_[2];
+
+         /**
+          * A blank event, passed to the signals for focus changes not caused
+          * by events.
+          */
+         osg::ref_ptr<osgGA::GUIEventAdapter> blankEvent_;
    };
 
 } // namespace OSGUIsh
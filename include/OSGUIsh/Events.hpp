@@ -94,6 +94,89 @@ namespace OSGUIsh
        * focus.
        */
       EVENT_MOUSE_WHEEL_DOWN,
+
+      /**
+       * A "drag start" event; generated when the mouse pointer moves a few
+       * pixels while a mouse button pressed over a registered node is held.
+       * From now on, until the button is released, the node captures the
+       * mouse pointer: it receives all its motion, as \c EVENT_DRAG events,
+       * and no other node receives mouse enter, leave and move events.
+       */
+      EVENT_DRAG_START,
+
+      /**
+       * A "drag" event; generated (at most once per frame) when the mouse
+       * pointer moves while a node is dragged. The hit passed to the handlers
+       * is the pointer position projected onto the drag constraint.
+       */
+      EVENT_DRAG,
+
+      /**
+       * A "drag end" event; generated for the dragged node when the mouse
+       * button that started the drag is released.
+       */
+      EVENT_DRAG_END,
+
+      /**
+       * A "drop" event; generated for the drop target (the registered node
+       * under the mouse pointer, ignoring the dragged node) when a drag ends
+       * over it. Generated only if drop target probing is enabled.
+       */
+      EVENT_DROP,
+
+      /**
+       * A "hover dwell" event; generated when the mouse pointer stays over a
+       * registered node for some time, without moving more than a few pixels
+       * (see \c EventHandler::setHoverDwell()). Typically used to show
+       * tooltips. Generated again only after the pointer moves and stops
+       * again.
+       */
+      EVENT_HOVER_DWELL,
+
+      /**
+       * A "hover cancel" event; generated for a node that got an \c
+       * EVENT_HOVER_DWELL when the mouse pointer leaves it, or moves more than
+       * the hover dwell tolerance. Typically used to hide tooltips.
+       */
+      EVENT_HOVER_CANCEL,
+
+      /**
+       * A "scroll" event; generated (at most once per frame) when the mouse
+       * wheel is rolled, or a touchpad is scrolled, in any direction, while a
+       * registered node has the focus (the same focus used for \c
+       * EVENT_MOUSE_WHEEL_UP and \c EVENT_MOUSE_WHEEL_DOWN). The scroll
+       * deltas of all scroll events in the frame are summed up, and passed to
+       * the handlers as \c HandlerParams::scrollDelta.
+       */
+      EVENT_SCROLL,
+
+      /**
+       * A "focus in" event; generated for a registered node when it gets the
+       * keyboard focus, however the focus was moved (by a \c FocusPolicy,
+       * the focus chain, spatial focus navigation or \c
+       * EventHandler::setKeyboardFocus()). Generated only if the focus really
+       * changed.
+       */
+      EVENT_FOCUS_IN,
+
+      /**
+       * A "focus out" event; generated for a registered node when it loses
+       * the keyboard focus, in the same cases as \c EVENT_FOCUS_IN. Generated
+       * before the \c EVENT_FOCUS_IN for the node getting the focus.
+       */
+      EVENT_FOCUS_OUT,
+
+      /**
+       * A "wheel focus in" event; the same as \c EVENT_FOCUS_IN, but for the
+       * focus of mouse wheel and scroll events.
+       */
+      EVENT_WHEEL_FOCUS_IN,
+
+      /**
+       * A "wheel focus out" event; the same as \c EVENT_FOCUS_OUT, but for the
+       * focus of mouse wheel and scroll events.
+       */
+      EVENT_WHEEL_FOCUS_OUT,
    };
 
 } // namespace OSGUIsh
@@ -0,0 +1,204 @@
+/******************************************************************************\
+* FocusChain.hpp                                                               *
+* The sequence in which nodes get the focus with Tab and Shift-Tab.            *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_FOCUS_CHAIN_HPP_
+#define _OSGUISH_FOCUS_CHAIN_HPP_
+
+#include <map>
+#include <vector>
+#include <osg/Camera>
+#include <osg/Vec4d>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * The sequence in which nodes get the keyboard focus when Tab (or
+    * Shift-Tab) is pressed. The sequence is circular: after the last node
+    * comes the first one again.
+    * <p>Like in HTML forms, each node has a tab index. Nodes with positive tab
+    * indices come first, in increasing tab index order; then come the nodes
+    * with tab index zero (the default), in an automatic order; nodes with
+    * negative tab indices are not in the chain at all.
+    * <p>The chain is sorted only when rebuilt, and stored as a list with the
+    * links to the next and previous nodes precomputed; so, moving along it
+    * costs constant time. The chain must be rebuilt when the nodes, their tab
+    * indices or the scene change, and, if ordered by screen position, when
+    * the camera changes. \c needsRebuild() detects the latter.
+    */
+   class FocusChain
+   {
+      public:
+         /// The automatic orders for nodes with tab index zero.
+         enum Order
+         {
+            /**
+             * The scene graph order: the order in which a depth-first
+             * traversal from the root reaches the nodes (using the first of
+             * their instances).
+             */
+            ORDER_SCENE_GRAPH,
+
+            /**
+             * The reading order of their positions on the screen: rows from
+             * top to bottom, and, in each row, from left to right. Nodes not
+             * visible through the camera come after the visible ones, in
+             * scene graph order.
+             */
+            ORDER_SCREEN_POSITION
+         };
+
+         /**
+          * Constructs a \c FocusChain, with an empty chain.
+          * @param order The automatic order.
+          * @param rowHeight For \c ORDER_SCREEN_POSITION, the height of the
+          *        rows, in pixels. Nodes whose vertical positions differ by
+          *        less than this are usually in the same row.
+          */
+         explicit FocusChain(Order order = ORDER_SCENE_GRAPH,
+                             float rowHeight = 16.0f);
+
+         /**
+          * Sets the automatic order.
+          * @param order The automatic order.
+          * @param rowHeight For \c ORDER_SCREEN_POSITION, the height of the
+          *        rows, in pixels.
+          */
+         void setOrder(Order order, float rowHeight = 16.0f);
+
+         /**
+          * Sets the tab index of a node. (All nodes start with tab index zero.)
+          * @param node The node.
+          * @param tabIndex The tab index. If positive, the node comes before
+          *        the ones ordered automatically; if negative, the node is
+          *        left out of the chain.
+          */
+         void setTabIndex(const NodePtr& node, int tabIndex);
+
+         /**
+          * Checks whether the chain must be rebuilt, because it was never
+          * built, because \c invalidate() was called, or because the chain is
+          * ordered by screen position and the view matrix, the projection
+          * matrix or the viewport of a camera are different from those used
+          * to build it.
+          */
+         bool needsRebuild(const osg::Camera* camera) const;
+
+         /// Marks the chain as outdated (for instance, if the scene changed).
+         void invalidate() { valid_ = false; }
+
+         /**
+          * Rebuilds the chain.
+          * @param camera The camera through which the scene is viewed. Used
+          *        only for \c ORDER_SCREEN_POSITION.
+          * @param nodes The nodes to put in the chain (unless their tab
+          *        indices are negative).
+          */
+         void rebuild(osg::Camera* camera, const Nodes_t& nodes);
+
+         /**
+          * Returns the node after a given one in the chain.
+          * @param from The node. If it is not in the chain (for example, if it
+          *        is invalid), the first node of the chain is returned.
+          * @return The next node; invalid if the chain is empty.
+          */
+         NodePtr getNext(const NodePtr& from) const;
+
+         /**
+          * Returns the node before a given one in the chain.
+          * @param from The node. If it is not in the chain (for example, if it
+          *        is invalid), the last node of the chain is returned.
+          * @return The previous node; invalid if the chain is empty.
+          */
+         NodePtr getPrevious(const NodePtr& from) const;
+
+      private:
+         /// A node in the chain, with the links to its neighbors.
+         struct Link
+         {
+            /// The node.
+            NodePtr node;
+
+            /// The index of the next link.
+            std::size_t next;
+
+            /// The index of the previous link.
+            std::size_t previous;
+         };
+
+         /// The sort key of a node, computed when rebuilding the chain.
+         struct SortKey
+         {
+            /// The node.
+            NodePtr node;
+
+            /// Its tab index, or \c INT_MAX if it is zero.
+            int tabIndex;
+
+            /// Is it visible? (Used only for \c ORDER_SCREEN_POSITION.)
+            bool visible;
+
+            /// Its screen row, from the top. (For \c ORDER_SCREEN_POSITION.)
+            int row;
+
+            /// Its window x coordinate. (For \c ORDER_SCREEN_POSITION.)
+            float x;
+
+            /// The child indices along its path from the root.
+            std::vector<unsigned> path;
+
+            /// Does this key come before another one?
+            bool operator<(const SortKey& other) const;
+         };
+
+         /**
+          * Finds the link of a node. Moving along the chain, the node is
+          * usually the one returned last; so, that case is checked first,
+          * making this constant time.
+          * @return The index of the link; \c links_.size() if not found.
+          */
+         std::size_t findLink(const NodePtr& node) const;
+
+         /// The automatic order.
+         Order order_;
+
+         /// The row height, for \c ORDER_SCREEN_POSITION.
+         float rowHeight_;
+
+         /// The nonzero tab indices.
+         std::map<NodePtr, int> tabIndices_;
+
+         /// The chain.
+         std::vector<Link> links_;
+
+         /// Maps nodes to the indices of their links.
+         std::map<const osg::Node*, std::size_t> linksByNode_;
+
+         /// The index of the link returned last.
+         mutable std::size_t lastLink_;
+
+         /// Is the chain built and not invalidated?
+         bool valid_;
+
+         /// The view matrix used to build the chain.
+         osg::Matrixd viewMatrix_;
+
+         /// The projection matrix used to build the chain.
+         osg::Matrixd projectionMatrix_;
+
+         /// The viewport (as x, y, width and height) used to build the chain.
+         osg::Vec4d viewport_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_FOCUS_CHAIN_HPP_
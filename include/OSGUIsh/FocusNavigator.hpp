@@ -0,0 +1,143 @@
+/******************************************************************************\
+* FocusNavigator.hpp                                                           *
+* Finds the registered node in a given screen direction.                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_FOCUS_NAVIGATOR_HPP_
+#define _OSGUISH_FOCUS_NAVIGATOR_HPP_
+
+#include <map>
+#include <vector>
+#include <osg/Camera>
+#include <osg/Vec2>
+#include <osg/Vec4d>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * Finds, among a set of nodes, the nearest one in a given screen direction
+    * from another one. This is used to move the keyboard focus with the arrow
+    * keys (or anything else routed as arrow keys, like a gamepad D-pad).
+    * <p>The nodes are indexed by the window position of the center of their
+    * bounding spheres, in a uniform grid of square cells. The search visits
+    * the cells in rings of increasing distance from the starting node, and
+    * stops as soon as no farther cell can contain a better node; so, only
+    * the nodes near the starting one are tested.
+    * <p>The index depends on the camera; it must be rebuilt when the camera
+    * (or the scene) changes. \c needsRebuild() detects camera changes.
+    */
+   class FocusNavigator
+   {
+      public:
+         /// The directions of navigation.
+         enum Direction
+         {
+            NAVIGATE_LEFT,  ///< Towards negative window x.
+            NAVIGATE_RIGHT, ///< Towards positive window x.
+            NAVIGATE_UP,    ///< Towards positive window y.
+            NAVIGATE_DOWN   ///< Towards negative window y.
+         };
+
+         /**
+          * Constructs a \c FocusNavigator, with an empty index.
+          * @param cellSize The size of the grid cells, in pixels.
+          */
+         explicit FocusNavigator(float cellSize = 64.0f);
+
+         /**
+          * Checks whether the index must be rebuilt, because it was never
+          * built, because \c invalidate() was called, or because the view
+          * matrix, the projection matrix or the viewport of a camera are
+          * different from those used to build it.
+          */
+         bool needsRebuild(const osg::Camera* camera) const;
+
+         /// Marks the index as outdated (for instance, if the scene changed).
+         void invalidate() { valid_ = false; }
+
+         /**
+          * Rebuilds the index.
+          * @param camera The camera through which the scene is viewed. Only
+          *        the nodes under this camera are indexed (in the first of
+          *        their instances under it), and only if visible in its
+          *        viewport.
+          * @param nodes The nodes to index.
+          */
+         void rebuild(osg::Camera* camera, const Nodes_t& nodes);
+
+         /**
+          * Finds the nearest node in a given direction from another one.
+          * Nodes are compared by their distance along the direction plus
+          * twice their distance across it, so that nodes roughly aligned
+          * with the starting one are preferred.
+          * @param from The starting node. If it is not indexed (for example,
+          *        if it is invalid), the node nearest to the viewport center
+          *        is returned.
+          * @param direction The direction.
+          * @return The node found; invalid if there is none in that
+          *         direction.
+          */
+         NodePtr findNeighbor(const NodePtr& from, Direction direction) const;
+
+      private:
+         /// An indexed node.
+         struct Item
+         {
+            /// The node.
+            NodePtr node;
+
+            /// Its position, in window coordinates.
+            osg::Vec2 position;
+         };
+
+         /// A grid cell: the indices of the items in it.
+         typedef std::vector<std::size_t> Cell_t;
+
+         /// Returns the grid cell column containing a window x coordinate.
+         int getColumn(float x) const;
+
+         /// Returns the grid cell row containing a window y coordinate.
+         int getRow(float y) const;
+
+         /// The size of the grid cells, in pixels.
+         float cellSize_;
+
+         /// The indexed items.
+         std::vector<Item> items_;
+
+         /// Maps nodes to the indices of their items.
+         std::map<const osg::Node*, std::size_t> itemsByNode_;
+
+         /// The grid cells, row by row.
+         std::vector<Cell_t> cells_;
+
+         /// The number of grid columns.
+         int numColumns_;
+
+         /// The number of grid rows.
+         int numRows_;
+
+         /// Is the index built and not invalidated?
+         bool valid_;
+
+         /// The view matrix used to build the index.
+         osg::Matrixd viewMatrix_;
+
+         /// The projection matrix used to build the index.
+         osg::Matrixd projectionMatrix_;
+
+         /// The viewport (as x, y, width and height) used to build the index.
+         osg::Vec4d viewport_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_FOCUS_NAVIGATOR_HPP_
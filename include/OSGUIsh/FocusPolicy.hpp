@@ -22,83 +22,90 @@ namespace OSGUIsh
    /**
     * An abstract class defining an interface used to implement different
     * policies for changing focus from one node to another.
+    * <p>Each policy declares the types of events it reacts to, and the \c
+    * EventHandler calls it only for these events. Policies can be chained:
+    * when a policy doesn't react to an event (or declines to decide the
+    * focus), the decision is left to its fallback policy. Chaining doesn't
+    * allocate anything: the policies are not owned by the chain (nor by the
+    * \c EventHandler), so they must be kept alive while in use. Policies
+    * with no state can simply be static objects.
     */
    class FocusPolicy
    {
       public:
          /**
           * Constructs a \c FocusPolicy.
-          * @param focusedNode The node with focus. A \c FocusPolicy will keep
-          *        this pointing to the node that has the focus.
+          * @param eventMask The types of events the policy reacts to, as a
+          *        combination of \c osgGA::GUIEventAdapter::EventType flags.
           */
-         FocusPolicy(NodePtr& focusedNode);
+         explicit FocusPolicy(unsigned eventMask);
+
+         /// Destroys the \c FocusPolicy.
+         virtual ~FocusPolicy();
 
          /**
-          * Concrete subclasses of \c FocusPolicy will implement this so that \c
-          * setFocusedNode() is called whenever it is necessary to change the
-          * focus according to the policy.
-          * <p>This is called for every event arriving via OSG, after the
-          * signals are called.
-          * @param ea The event generated by OSG.
-          * @param nodeUnderMouse The node under the mouse pointer.
+          * Returns the types of events the policy reacts to, as a combination
+          * of \c osgGA::GUIEventAdapter::EventType flags.
           */
-         virtual void updateFocus(const osgGA::GUIEventAdapter& ea,
-                                  const NodePtr nodeUnderMouse) = 0;
-
-      protected:
-         /// Updates the focused node.
-         void setFocusedNode(NodePtr focusedNode)
-         { focusedNode_ = focusedNode; }
+         unsigned getEventMask() const { return eventMask_; }
 
-      private:
          /**
-          * A reference to the focused node. The policy will make this point to
-          * the proper node, the one that has the focus according to the policy.
+          * Sets the policy deciding the focus when this one doesn't. The
+          * fallback can have a fallback of its own, and so on.
+          * @param fallback The fallback policy; null (the default) means no
+          *        fallback. Not owned by this policy.
           */
-         NodePtr& focusedNode_;
-   };
-
-
-
-   /// A (smart) pointer to a \c FocusPolicy.
-   typedef boost::shared_ptr<FocusPolicy> FocusPolicyPtr;
+         void setFallback(FocusPolicy* fallback);
 
+         /// Returns the fallback policy (possibly null).
+         FocusPolicy* getFallback() const { return fallback_; }
 
+         /**
+          * Decides the focus for an event, using the first policy in the
+          * chain starting at this one that reacts to the event type and
+          * decides it. Only the policies reacting to the event type are
+          * called, so events no policy is interested in cost no virtual call.
+          * @param ea The event generated by OSG.
+          * @param nodeUnderMouse The node under the mouse pointer.
+          * @param focusedNode The node with the focus; updated in place.
+          * @return \c true if some policy decided the focus.
+          */
+         bool decideFocus(const osgGA::GUIEventAdapter& ea,
+                          const NodePtr nodeUnderMouse,
+                          NodePtr& focusedNode);
 
-   /**
-    * An abstract class defining an interface for creating
-    * <tt>FocusPolicy</tt>s.
-    */
-   class FocusPolicyFactory
-   {
-      public:
+      protected:
          /**
-          * Concrete subclasses should implement this so that a newly created \c
-          * FocusPolicy is returned.
-          * @param focusedNode A pointer to a node; the created policy will keep
-          *        it pointing to the focused node.
+          * Concrete subclasses of \c FocusPolicy will implement this to decide
+          * which node has the focus according to the policy.
+          * <p>This is called only for events whose types are in the mask
+          * passed to the constructor, after the signals are called.
+          * @param ea The event generated by OSG.
+          * @param nodeUnderMouse The node under the mouse pointer (for mouse
+          *        button and wheel events, the node actually under the event
+          *        coordinates).
+          * @param focusedNode The node with the focus. Policies change it as
+          *        needed.
+          * @return \c true if the policy decided the focus; \c false if the
+          *         decision is left to the fallback policy (in which case,
+          *         \c focusedNode must be left untouched).
           */
-         virtual FocusPolicyPtr create(NodePtr& focusedNode) const = 0;
+         virtual bool updateFocus(const osgGA::GUIEventAdapter& ea,
+                                  const NodePtr nodeUnderMouse,
+                                  NodePtr& focusedNode) = 0;
+
+      private:
+         /// The types of events the policy reacts to.
+         unsigned eventMask_;
+
+         /// The fallback policy; null if none.
+         FocusPolicy* fallback_;
    };
 
 
 
-   /**
-    * A template class used to generate <tt>FocusPolicyFactory</tt>s (hence the
-    * template name: factories are constructed by masons).
-    * @param T A <tt>FocusPolicy</tt>-derived class, the one that will be
-    *        created by the generated factory.
-    */
-   template <class T>
-   class FocusPolicyFactoryMason: public FocusPolicyFactory
-   {
-      public:
-         // (inherits docs)
-         virtual FocusPolicyPtr create(NodePtr& focusedNode) const
-         {
-            return FocusPolicyPtr(new T(focusedNode));
-         }
-   };
+   /// A (smart) pointer to a \c FocusPolicy.
+   typedef boost::shared_ptr<FocusPolicy> FocusPolicyPtr;
 
 } // namespace OSGUIsh
 
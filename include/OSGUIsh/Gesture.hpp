@@ -0,0 +1,143 @@
+/******************************************************************************\
+* Gesture.hpp                                                                  *
+* The description of a gesture to be recognized.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_GESTURE_HPP_
+#define _OSGUISH_GESTURE_HPP_
+
+#include <osgGA/GUIEventAdapter>
+
+
+namespace OSGUIsh
+{
+   /**
+    * The description of a gesture to be recognized for a node (see \c
+    * EventHandler::addGesture()). A gesture is just a row of parameters; the
+    * \c EventHandler interprets them. Use the static member functions to
+    * create the gestures, instead of setting the parameters by hand.
+    * <p>Gestures are recognized for the mouse pointer only.
+    */
+   struct Gesture
+   {
+      public:
+         /// The kinds of gesture.
+         enum Kind
+         {
+            /**
+             * A sequence of \c clickCount clicks with a given button, each
+             * one no more than \c delay seconds after the previous one, all
+             * of them within \c tolerance pixels of the first one.
+             */
+            MULTI_CLICK,
+
+            /**
+             * Pressing a given button and holding it for \c delay seconds,
+             * without moving more than \c tolerance pixels.
+             */
+            LONG_PRESS,
+
+            /**
+             * Pressing a given button and holding it (without moving more than
+             * \c tolerance pixels): recognized after \c delay seconds, and
+             * again every \c repeatInterval seconds, until the button is
+             * released.
+             */
+            HOLD_REPEAT,
+
+            /**
+             * Keeping the mouse pointer over the node for \c delay seconds,
+             * without moving more than \c tolerance pixels. Recognized again
+             * if the pointer moves more than that and stops again.
+             */
+            HOVER_DWELL
+         };
+
+         /**
+          * Creates a \c MULTI_CLICK gesture.
+          * @param clickCount The number of clicks. Must be positive.
+          * @param button The mouse button, as an \c
+          *        osgGA::GUIEventAdapter::MouseButtonMask value.
+          * @param interval The maximum time between clicks, in seconds. Zero
+          *        (the default) means the double-click interval of the \c
+          *        EventHandler (see \c EventHandler::setDoubleClickInterval()),
+          *        so that a \c multiClick(2) gesture agrees with the
+          *        <tt>"DoubleClick"</tt> event.
+          * @param tolerance The maximum distance from the first click, in
+          *        pixels.
+          */
+         static Gesture multiClick(
+            unsigned clickCount,
+            unsigned button = osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON,
+            double interval = 0.0, float tolerance = 4.0f);
+
+         /**
+          * Creates a \c LONG_PRESS gesture.
+          * @param button The mouse button, as an \c
+          *        osgGA::GUIEventAdapter::MouseButtonMask value.
+          * @param delay How long the button must be held, in seconds.
+          * @param tolerance The maximum distance the pointer can move, in
+          *        pixels.
+          */
+         static Gesture longPress(
+            unsigned button = osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON,
+            double delay = 0.8, float tolerance = 4.0f);
+
+         /**
+          * Creates a \c HOLD_REPEAT gesture.
+          * @param button The mouse button, as an \c
+          *        osgGA::GUIEventAdapter::MouseButtonMask value.
+          * @param delay The time until the first repetition, in seconds.
+          * @param repeatInterval The time between repetitions, in seconds.
+          *        Must be positive.
+          * @param tolerance The maximum distance the pointer can move, in
+          *        pixels.
+          */
+         static Gesture holdRepeat(
+            unsigned button = osgGA::GUIEventAdapter::LEFT_MOUSE_BUTTON,
+            double delay = 0.5, double repeatInterval = 0.1,
+            float tolerance = 4.0f);
+
+         /**
+          * Creates a \c HOVER_DWELL gesture.
+          * @param delay How long the pointer must stay, in seconds.
+          * @param tolerance The maximum distance the pointer can move, in
+          *        pixels.
+          */
+         static Gesture hoverDwell(double delay = 0.5, float tolerance = 4.0f);
+
+         /// The kind of gesture.
+         Kind kind;
+
+         /**
+          * The mouse button, as an \c osgGA::GUIEventAdapter::MouseButtonMask
+          * value. Not used by \c HOVER_DWELL.
+          */
+         unsigned button;
+
+         /// The number of clicks. Used only by \c MULTI_CLICK.
+         unsigned clickCount;
+
+         /**
+          * For \c MULTI_CLICK, the maximum time between clicks (zero
+          * meaning the \c EventHandler's double-click interval); for other
+          * kinds, the time until the gesture is recognized. In seconds.
+          */
+         double delay;
+
+         /// The time between repetitions. Used only by \c HOLD_REPEAT.
+         double repeatInterval;
+
+         /// The spatial tolerance, in pixels.
+         float tolerance;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_GESTURE_HPP_
@@ -24,12 +24,17 @@ namespace OSGUIsh
    class ManualFocusPolicy: public FocusPolicy
    {
       public:
-         /// Constructs a \c ManualFocusPolicy.
-         ManualFocusPolicy(NodePtr& focusedNode);
+         /**
+          * Constructs a \c ManualFocusPolicy. It reacts to no events, so it is
+          * never called.
+          */
+         ManualFocusPolicy();
 
+      protected:
          // (inherits documentation)
-         virtual void updateFocus(const osgGA::GUIEventAdapter& ea,
-                                  const NodePtr nodeUnderMouse);
+         virtual bool updateFocus(const osgGA::GUIEventAdapter& ea,
+                                  const NodePtr nodeUnderMouse,
+                                  NodePtr& focusedNode);
    };
 
 } // namespace OSGUIsh
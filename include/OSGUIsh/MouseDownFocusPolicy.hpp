@@ -24,12 +24,14 @@ namespace OSGUIsh
    class MouseDownFocusPolicy: public FocusPolicy
    {
       public:
-         /// Constructs a \c MouseDownFocusPolicy.
-         MouseDownFocusPolicy(NodePtr& focusedNode);
+         /// Constructs a \c MouseDownFocusPolicy, reacting to \c PUSH events.
+         MouseDownFocusPolicy();
 
+      protected:
          // (inherits documentation)
-         virtual void updateFocus(const osgGA::GUIEventAdapter& ea,
-                                  const NodePtr nodeUnderMouse);
+         virtual bool updateFocus(const osgGA::GUIEventAdapter& ea,
+                                  const NodePtr nodeUnderMouse,
+                                  NodePtr& focusedNode);
    };
 
 } // namespace OSGUIsh
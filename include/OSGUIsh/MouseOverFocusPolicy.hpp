@@ -21,12 +21,18 @@ namespace OSGUIsh
    class MouseOverFocusPolicy: public FocusPolicy
    {
       public:
-         /// Constructs a \c MouseOverFocusPolicy.
-         MouseOverFocusPolicy(NodePtr& focusedNode);
+         /**
+          * Constructs a \c MouseOverFocusPolicy, reacting to the events that
+          * may change the node under the mouse pointer (\c FRAME, \c PUSH,
+          * \c RELEASE and \c SCROLL).
+          */
+         MouseOverFocusPolicy();
 
+      protected:
          // (inherits documentation)
-         virtual void updateFocus(const osgGA::GUIEventAdapter& ea,
-                                  const NodePtr nodeUnderMouse);
+         virtual bool updateFocus(const osgGA::GUIEventAdapter& ea,
+                                  const NodePtr nodeUnderMouse,
+                                  NodePtr& focusedNode);
    };
 
 } // namespace OSGUIsh
@@ -0,0 +1,223 @@
+/******************************************************************************\
+* OverlayIndex.hpp                                                             *
+* A 2D index of the registered nodes in HUDs and other overlays.               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_OVERLAY_INDEX_HPP_
+#define _OSGUISH_OVERLAY_INDEX_HPP_
+
+#include <vector>
+#include <osg/Camera>
+#include <osg/Vec4d>
+#include <OSGUIsh/PickTraversal.hpp>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A 2D index of the nodes viewed through overlay cameras, like those used
+    * for HUDs: nested cameras with an absolute reference frame and an
+    * orthographic projection. Since such cameras map their scene straight to
+    * the window, nodes under them can be picked with simple rectangle tests
+    * instead of casting rays.
+    * <p>Each indexed node is stored with the window rectangle covered by its
+    * bounding box (clipped to its camera's viewport), in a uniform grid of
+    * square cells. Finding the nodes at a window position only tests the
+    * nodes in the cell containing it.
+    * <p>The index depends on the overlay cameras, on the transforms above
+    * the indexed nodes and on their bounds. \c needsRebuild() detects changes
+    * in the cameras, and \c invalidateIfMoved() in the transforms and bounds
+    * (for the nodes that were visible when the index was built, or hidden
+    * only because they were outside their viewport). The latter visits every
+    * indexed path, so it is meant to be called once per frame, not before
+    * every lookup. Other changes in the scene (like adding nodes or switching
+    * them on) must be signaled by calling \c invalidate().
+    */
+   class OverlayIndex
+   {
+      public:
+         /// An indexed node.
+         struct Item
+         {
+            /// The node.
+            NodePtr node;
+
+            /**
+             * Where the node is in the scene: its path from the camera
+             * through which the index was built, and the matrices along it.
+             */
+            PickTraversal::Root root;
+
+            /// The minimum window x coordinate covered by the node.
+            float xMin;
+
+            /// The minimum window y coordinate covered by the node.
+            float yMin;
+
+            /// The maximum window x coordinate covered by the node.
+            float xMax;
+
+            /// The maximum window y coordinate covered by the node.
+            float yMax;
+
+            /**
+             * The window depth of the node's nearest point: 0.0 at the near
+             * plane, 1.0 at the far plane.
+             */
+            float depth;
+
+            /// The node's bounding sphere when the index was built.
+            osg::BoundingSphere bound;
+         };
+
+         /// A sequence of pointers to items.
+         typedef std::vector<const Item*> Items_t;
+
+         /**
+          * Constructs an \c OverlayIndex, with an empty index.
+          * @param cellSize The size of the grid cells, in pixels.
+          */
+         explicit OverlayIndex(float cellSize = 64.0f);
+
+         /**
+          * Checks whether the index must be rebuilt, because it was never
+          * built, because it was invalidated, or because a camera it was
+          * built from is different now: the viewport of the camera, or the
+          * matrices or viewport of an overlay camera under it. Cheap enough
+          * to be called before every lookup.
+          */
+         bool needsRebuild(const osg::Camera* camera) const;
+
+         /// Marks the index as outdated (for instance, if the scene changed).
+         void invalidate() { valid_ = false; }
+
+         /**
+          * Marks the index as outdated if an indexed node moved since it was
+          * built: if the transforms above it, or its bound, are different.
+          * Takes time proportional to the number of indexed nodes times
+          * their depth in the scene graph.
+          */
+         void invalidateIfMoved();
+
+         /**
+          * Rebuilds the index.
+          * @param camera The camera through which the scene is viewed. Only
+          *        the nodes under an overlay camera nested in this camera are
+          *        indexed (in the first of their instances under it), and only
+          *        if visible in the overlay camera's viewport.
+          * @param nodes The nodes to index.
+          * @param lodScale The scale applied to the LOD scale of the cameras
+          *        when checking whether the nodes are in selected \c osg::LOD
+          *        children (see \c PickTraversal::makeRoot()).
+          */
+         void rebuild(osg::Camera* camera, const Nodes_t& nodes,
+                      float lodScale = 1.0f);
+
+         /// Is the index empty?
+         bool isEmpty() const { return items_.empty(); }
+
+         /**
+          * Finds the indexed nodes whose window rectangles contain a given
+          * position.
+          * @param x The horizontal position, in window coordinates.
+          * @param y The vertical position, in window coordinates.
+          * @param traversalMask The traversal mask. Nodes whose path contains
+          *        nodes with no bits in common with it are ignored.
+          * @param items Output parameter, receiving the items found, nearest
+          *        first. Among items at the same depth, the ones deeper in the
+          *        scene graph (like buttons on a panel) come first.
+          */
+         void findItems(float x, float y, osg::Node::NodeMask traversalMask,
+                        Items_t& items) const;
+
+      private:
+         /// The state of an overlay camera when the index was built.
+         struct CameraState
+         {
+            /// The camera.
+            osg::ref_ptr<const osg::Camera> camera;
+
+            /// Its view matrix.
+            osg::Matrixd viewMatrix;
+
+            /// Its projection matrix.
+            osg::Matrixd projectionMatrix;
+
+            /// Its viewport (as x, y, width and height).
+            osg::Vec4d viewport;
+         };
+
+         /// A grid cell: the indices of the items in it.
+         typedef std::vector<std::size_t> Cell_t;
+
+         /**
+          * Returns the overlay camera a node path goes through: the last
+          * camera in the path, if it has an absolute reference frame and an
+          * orthographic projection, and if no \c osg::Projection comes after
+          * it. Returns \c NULL if there is none.
+          */
+         static const osg::Camera* getOverlayCamera(const osg::NodePath& path);
+
+         /**
+          * Checks whether an item has moved since the index was built: if the
+          * matrices along its path, or its node bound, are different.
+          */
+         bool hasMoved(const Item& item) const;
+
+         /// Returns the grid cell column containing a window x coordinate.
+         int getColumn(float x) const;
+
+         /// Returns the grid cell row containing a window y coordinate.
+         int getRow(float y) const;
+
+         /// The size of the grid cells, in pixels.
+         float cellSize_;
+
+         /// The indexed items.
+         std::vector<Item> items_;
+
+         /**
+          * The items left out of the index for being outside their overlay
+          * camera's viewport. Only watched for motion, since moving may bring
+          * them into view.
+          */
+         std::vector<Item> hiddenItems_;
+
+         /// The grid cells, row by row.
+         std::vector<Cell_t> cells_;
+
+         /// The window x coordinate of the grid's left edge.
+         float gridX_;
+
+         /// The window y coordinate of the grid's bottom edge.
+         float gridY_;
+
+         /// The number of grid columns.
+         int numColumns_;
+
+         /// The number of grid rows.
+         int numRows_;
+
+         /// Is the index built and not invalidated?
+         bool valid_;
+
+         /// The LOD scale passed to \c rebuild().
+         float lodScale_;
+
+         /// The viewport (as x, y, width and height) used to build the index.
+         osg::Vec4d viewport_;
+
+         /// The overlay cameras used to build the index.
+         std::vector<CameraState> cameras_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_OVERLAY_INDEX_HPP_
@@ -0,0 +1,181 @@
+/******************************************************************************\
+* PickService.hpp                                                              *
+* Picking results shared among event handlers.                                 *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_PICK_SERVICE_HPP_
+#define _OSGUISH_PICK_SERVICE_HPP_
+
+#include <map>
+#include <vector>
+#include <osg/Referenced>
+#include <osg/View>
+#include <OSGUIsh/PickTraversal.hpp>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * Picking results shared among the event handlers of an application, so
+    * that the scene is traversed only once per position and frame, no matter
+    * how many handlers want to know what is under the mouse pointer.
+    * <p>A \c PickService does two things. First, it is a picking engine with
+    * a per-frame cache: \c pick() returns the full list of hits at a given
+    * position, running a \c PickTraversal only if no one asked for the same
+    * position (and view, and node mask) in the current frame. Several
+    * <tt>EventHandler</tt>s can share it (see \c
+    * EventHandler::setPickService()), as can any other handler, like a
+    * selection tool or a camera manipulator with "pick to pivot".
+    * <p>Second, it is a board where each \c EventHandler publishes, once per
+    * frame and per view, the result of the picking done for the mouse
+    * pointer: the position and the registered node found there. Other
+    * handlers can query it with \c getMousePick(), and get the full list of
+    * hits at no cost by calling \c pick() with the published position.
+    * <p>A frame is identified by the frame number of the view's frame stamp;
+    * the results for a view are discarded when its frame number changes, or
+    * when \c markSceneDirty() is called. A \c PickService is meant to be used
+    * from the event handling thread only.
+    */
+   class PickService: public osg::Referenced
+   {
+      public:
+         /// The pick published for the mouse pointer of a view.
+         struct MousePick
+         {
+            /// The frame number when the pick was published.
+            unsigned frameNumber;
+
+            /// The horizontal position picked, in window coordinates.
+            float x;
+
+            /// The vertical position picked, in window coordinates.
+            float y;
+
+            /// The pick result, as resolved by the publishing handler.
+            PickResult result;
+         };
+
+         /// Constructs a \c PickService, with nothing cached.
+         PickService();
+
+         /**
+          * Returns the hits at a given position of a view, in the current
+          * frame. The first call for a given position, view and node mask in
+          * a frame runs a \c PickTraversal; the following ones just return
+          * the same hits. The scene is picked through the view's camera
+          * found at the position by \c PickTraversal::findCamera().
+          * @param view The view displaying the scene.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param mask The traversal mask to use.
+          * @return The hits, sorted by distance from the viewer. Valid until
+          *         the next call to a non-const member function.
+          */
+         const PickTraversal::Hits_t& pick(
+            osg::View* view, float x, float y,
+            osg::Node::NodeMask mask = 0xFFFFFFFF);
+
+         /**
+          * Publishes the pick done for the mouse pointer of a view in the
+          * current frame, replacing any pick published before for the view.
+          * @param view The view displaying the scene.
+          * @param x The horizontal position picked, in window coordinates.
+          * @param y The vertical position picked, in window coordinates.
+          * @param result The pick result.
+          */
+         void publishMousePick(osg::View* view, float x, float y,
+                               const PickResult& result);
+
+         /**
+          * Returns the pick published for the mouse pointer of a view in the
+          * current frame.
+          * @param view The view displaying the scene.
+          * @return The published pick; null if no pick was published for the
+          *         view in the current frame.
+          */
+         const MousePick* getMousePick(const osg::View* view) const;
+
+         /**
+          * Discards all cached and published results. Call this when the
+          * scene changes in a way that can change picking results within a
+          * frame (<tt>EventHandler</tt>s using the service call this from
+          * their own \c markSceneDirty()).
+          */
+         void markSceneDirty();
+
+         /**
+          * Sets the scale applied to the cameras' LOD scale when picking (see
+          * \c PickTraversal::setLODScale()). Discards all cached results.
+          * @param scale The scale; the default is 1.0.
+          */
+         void setLODScale(float scale);
+
+      protected:
+         /// Destroys the \c PickService.
+         virtual ~PickService();
+
+      private:
+         /// A cached list of hits.
+         struct CacheEntry
+         {
+            /// The horizontal position picked, in window coordinates.
+            float x;
+
+            /// The vertical position picked, in window coordinates.
+            float y;
+
+            /// The traversal mask used.
+            osg::Node::NodeMask mask;
+
+            /// The hits.
+            PickTraversal::Hits_t hits;
+         };
+
+         /// All that is kept for a view.
+         struct ViewData
+         {
+            /// The frame number of the cached and published results.
+            unsigned frameNumber;
+
+            /// The cached lists of hits.
+            std::vector<CacheEntry> cache;
+
+            /// Where the next entry will be written in \c cache once full.
+            std::size_t nextEntry;
+
+            /// Was a mouse pick published in the frame?
+            bool hasMousePick;
+
+            /// The published mouse pick.
+            MousePick mousePick;
+         };
+
+         /// The maximum number of entries in each view's cache.
+         static const std::size_t CACHE_SIZE = 32;
+
+         /**
+          * Returns the data kept for a view, discarding it first if it is
+          * from a previous frame.
+          */
+         ViewData& getViewData(osg::View* view);
+
+         /// Returns the current frame number of a view.
+         static unsigned getFrameNumber(const osg::View* view);
+
+         /// The data kept for each view.
+         std::map<const osg::View*, ViewData> views_;
+
+         /// The traversal used for picking.
+         PickTraversal traversal_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_PICK_SERVICE_HPP_
@@ -0,0 +1,157 @@
+/******************************************************************************\
+* PickThreadPool.hpp                                                           *
+* A small work-stealing thread pool for picking.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_PICK_THREAD_POOL_HPP_
+#define _OSGUISH_PICK_THREAD_POOL_HPP_
+
+#include <deque>
+#include <vector>
+#include <osg/Referenced>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/Block>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Thread>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A small thread pool used to run independent picking traversals (like
+    * the ones for each picking mask) in parallel. It can be shared by several
+    * <tt>EventHandler</tt>s, typically the ones of every view of an \c
+    * osgViewer::CompositeViewer, so that they all use the same set of threads.
+    * <p>Each worker has its own queue of tasks. Workers take tasks from the
+    * back of their own queue, and steal from the front of the other queues
+    * when theirs is empty, so that the load is balanced even when some
+    * traversals are much more expensive than others. The thread calling \c
+    * run() helps running the tasks while it waits.
+    */
+   class PickThreadPool: public osg::Referenced
+   {
+      public:
+         /// A unit of work to be run by the pool.
+         class Task
+         {
+            public:
+               /// Destroys the \c Task.
+               virtual ~Task() { }
+
+               /// Does the work. Called from an arbitrary thread.
+               virtual void run() = 0;
+         };
+
+         /// A sequence of tasks.
+         typedef std::vector<Task*> Tasks_t;
+
+         /**
+          * Constructs the \c PickThreadPool and starts its threads.
+          * @param numThreads The number of worker threads. The default (zero)
+          *        means "one less than the number of processors" (because the
+          *        thread calling \c run() also works).
+          */
+         explicit PickThreadPool(unsigned numThreads = 0);
+
+         /**
+          * Runs a set of tasks, returning only when all of them are finished.
+          * Can be called from several threads simultaneously.
+          * @param tasks The tasks to run. They are not deleted by the pool.
+          */
+         void run(const Tasks_t& tasks);
+
+      protected:
+         /// Stops the worker threads and destroys the \c PickThreadPool.
+         virtual ~PickThreadPool();
+
+      private:
+         /// A group of tasks passed to a single call to \c run().
+         struct Batch
+         {
+            /// The number of tasks in the batch not finished yet.
+            OpenThreads::Atomic remaining;
+
+            /// Released when the last task in the batch finishes.
+            OpenThreads::Block finished;
+         };
+
+         /// An entry in a worker queue.
+         struct Entry
+         {
+            /// The task to run.
+            Task* task;
+
+            /// The batch the task belongs to.
+            Batch* batch;
+         };
+
+         /// A worker thread and its queue.
+         class Worker: public OpenThreads::Thread
+         {
+            public:
+               /// Constructs the \c Worker.
+               Worker(PickThreadPool& pool, std::size_t index);
+
+               /// The thread body (overrides virtual method).
+               virtual void run();
+
+               /// The queue of tasks; accessed by other threads when stealing.
+               std::deque<Entry> queue;
+
+               /// Protects \c queue.
+               OpenThreads::Mutex queueMutex;
+
+            private:
+               /// The pool owning this worker.
+               PickThreadPool& pool_;
+
+               /// The index of this worker in the pool.
+               std::size_t index_;
+         };
+
+         /**
+          * Takes a task from the queue of the worker with a given index, or
+          * steals one from any other queue if it is empty.
+          * @param index The index of the worker looking for work. Use a value
+          *        equal to the number of workers to indicate a thread that has
+          *        no queue of its own.
+          * @param entry Output parameter, where the task found is stored.
+          * @return \c true if a task was found.
+          */
+         bool takeTask(std::size_t index, Entry& entry);
+
+         /// Runs a task and updates its batch.
+         static void runTask(const Entry& entry);
+
+         /// The worker threads.
+         std::vector<Worker*> workers_;
+
+         /// The number of tasks in all queues.
+         OpenThreads::Atomic queued_;
+
+         /// Set to a non-zero value to make the workers exit.
+         OpenThreads::Atomic done_;
+
+         /// Used with \c workAvailable_.
+         OpenThreads::Mutex sleepMutex_;
+
+         /// Signaled when tasks are queued or when workers must exit.
+         OpenThreads::Condition workAvailable_;
+
+         /// The worker that will receive the next task queued.
+         std::size_t nextWorker_;
+
+         /// Protects \c nextWorker_ and the queuing of tasks.
+         OpenThreads::Mutex queuingMutex_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_PICK_THREAD_POOL_HPP_
@@ -0,0 +1,514 @@
+/******************************************************************************\
+* PickTraversal.hpp                                                            *
+* A picking traversal that can be suspended and resumed.                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_PICK_TRAVERSAL_HPP_
+#define _OSGUISH_PICK_TRAVERSAL_HPP_
+
+#include <vector>
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/LOD>
+#include <osg/Projection>
+#include <osg/View>
+#include <OSGUIsh/TriangleCache.hpp>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A traversal that picks a scene graph with a line segment, much like an \c
+    * osgUtil::IntersectionVisitor with an \c osgUtil::LineSegmentIntersector
+    * in \c WINDOW coordinates. The difference is that this traversal doesn't
+    * use the call stack to remember where it is: it keeps an explicit stack of
+    * nodes to visit instead. Therefore, it can be interrupted when it takes
+    * too long, and resumed later, right from where it stopped.
+    * <p>Nodes are referenced while the traversal is suspended, so it is safe
+    * to remove them from the scene graph in the meanwhile (though, in this
+    * case, results may not reflect the current state of the scene).
+    * <p>Only what is drawn is picked: inactive \c osg::Switch children are
+    * skipped, and \c osg::LOD (and \c osg::PagedLOD) children are selected
+    * just like the cull traversal does, from the camera's eye point (see \c
+    * selectLODChildren()). Missing \c PagedLOD children are never requested
+    * from the database pager.
+    */
+   class PickTraversal
+   {
+      public:
+         /// A hit found by the traversal.
+         struct Hit
+         {
+            /**
+             * The position of the hit along the picking segment: 0.0 is at the
+             * near plane, 1.0 is at the far plane.
+             */
+            double ratio;
+
+            /// The hit itself.
+            Intersection_t intersection;
+
+            /**
+             * Keeps the nodes in \c intersection.nodePath referenced, so that
+             * the hit remains usable even if they are removed from the scene
+             * graph.
+             */
+            osg::ref_ptr<osg::Referenced> pathRef;
+
+            /// Compares hits by their distance from the viewer.
+            bool operator<(const Hit& other) const
+            { return ratio < other.ratio; }
+         };
+
+         /// A sequence of hits.
+         typedef std::vector<Hit> Hits_t;
+
+         /**
+          * A \c Geode found under the picked position by a traversal that
+          * defers intersections (see \c setTriangleCache()). Holds everything
+          * needed to intersect it later without touching the scene graph.
+          */
+         struct Candidate
+         {
+            /// The node path to the \c Geode.
+            osg::NodePath nodePath;
+
+            /// Keeps the nodes in \c nodePath referenced.
+            osg::ref_ptr<osg::Referenced> pathRef;
+
+            /**
+             * The matrix taking the \c Geode coordinates to world
+             * coordinates. \c NULL means identity.
+             */
+            osg::ref_ptr<osg::RefMatrix> model;
+
+            /// The picking segment start, in the \c Geode coordinates.
+            osg::Vec3d start;
+
+            /// The picking segment end, in the \c Geode coordinates.
+            osg::Vec3d end;
+
+            /// The triangles of each drawable of the \c Geode.
+            std::vector<TriangleCache::TrianglesPtr> triangles;
+         };
+
+         /// A sequence of candidates.
+         typedef std::vector<Candidate> Candidates_t;
+
+         /**
+          * A snapshot of where a subgraph is placed in the scene: its node
+          * path and the matrices accumulated along it. Traversals can start
+          * from a collection of these, instead of from a camera, so that only
+          * some subgraphs are traversed.
+          * @see makeRoot()
+          */
+         struct Root
+         {
+            /**
+             * The node path from the camera to the subgraph root (including
+             * both). The nodes are referenced, so the snapshot remains valid
+             * even if the scene graph changes.
+             */
+            std::vector< osg::ref_ptr<osg::Node> > path;
+
+            /// The view matrix in effect for the subgraph.
+            osg::Matrixd view;
+
+            /// The projection matrix in effect for the subgraph.
+            osg::Matrixd projection;
+
+            /// The window (viewport) matrix in effect for the subgraph.
+            osg::Matrixd window;
+
+            /**
+             * The matrix taking the coordinates of the subgraph root's parent
+             * to the world coordinates of the camera.
+             */
+            osg::Matrixd model;
+
+            /**
+             * The LOD scale of the cameras in effect for the subgraph (not
+             * including the scale passed to \c makeRoot(), nor the one set
+             * with \c setLODScale()).
+             */
+            float lodScale;
+         };
+
+         /// A sequence of roots.
+         typedef std::vector<Root> Roots_t;
+
+         /**
+          * Creates a \c Root from a node path, by accumulating the matrices
+          * found along it.
+          * @param path The node path. Its first node must be the camera
+          *        through which the subgraph is viewed; the last one is the
+          *        subgraph root.
+          * @param root Output parameter, where the root is stored.
+          * @param lodScale The scale applied to the LOD scale of the cameras
+          *        when checking \c osg::LOD children, like the one passed to
+          *        \c setLODScale(). Use the same scale as the traversals
+          *        started from the root, so that both agree on the selected
+          *        children.
+          * @return \c false if the path doesn't start with a camera or goes
+          *         through an inactive \c osg::Switch child or an \c osg::LOD
+          *         child not selected for the camera; in this case, \c root
+          *         is not usable.
+          */
+         static bool makeRoot(const osg::NodePath& path, Root& root,
+                              float lodScale = 1.0f);
+
+         /**
+          * Finds the camera of a view that shows what is at a given window
+          * position, the same way \c osgViewer does when giving the event
+          * focus to a camera. Slave cameras (insets, tiles of a display wall,
+          * eyes of a stereo setup) are checked from the last to the first,
+          * since later slaves are drawn over earlier ones; the master camera
+          * is used if none of them contains the position. Only slaves drawing
+          * to the frame buffer and accepting the event focus are considered.
+          * @param view The view.
+          * @param x The horizontal position, in the window coordinates of
+          *        the view's master camera (which are its clip coordinates
+          *        if it has no viewport, as in display walls). Output
+          *        parameter, too: receives the position in the window
+          *        coordinates of the returned camera.
+          * @param y The vertical position, just like \c x.
+          * @return The camera found. Never \c NULL.
+          */
+         static osg::Camera* findCamera(osg::View* view, float& x, float& y);
+
+         /**
+          * Selects the children of an \c osg::LOD drawn at a given eye point,
+          * using the same rules as the cull traversal. For an \c
+          * osg::PagedLOD whose selected child is not loaded, the most
+          * detailed loaded child is selected instead (as the cull traversal
+          * does while the missing child is paged in).
+          * @param lod The LOD.
+          * @param modelView The matrix taking the LOD's coordinates to eye
+          *        coordinates.
+          * @param projection The projection matrix. (Used only by LODs with \c
+          *        PIXEL_SIZE_ON_SCREEN ranges, like \c window.)
+          * @param window The window (viewport) matrix.
+          * @param lodScale The LOD scale. Larger values select less detailed
+          *        children.
+          * @param children Output parameter, receiving the indices of the
+          *        selected children, in increasing order.
+          */
+         static void selectLODChildren(const osg::LOD& lod,
+                                       const osg::Matrixd& modelView,
+                                       const osg::Matrixd& projection,
+                                       const osg::Matrixd& window,
+                                       float lodScale,
+                                       std::vector<unsigned>& children);
+
+         /**
+          * Returns the LOD scale in effect under a nested camera, using the
+          * same rule as the cull traversal: the camera's own LOD scale if it
+          * doesn't inherit it (that is, if its inheritance mask doesn't
+          * include \c osg::CullSettings::LOD_SCALE), or the scale in effect
+          * above it otherwise.
+          * @param camera The nested camera.
+          * @param parentScale The LOD scale in effect above \c camera.
+          */
+         static float getNestedLODScale(const osg::Camera& camera,
+                                        float parentScale);
+
+         /**
+          * Constructs a \c PickTraversal. Nothing is traversed until \c
+          * start() is called.
+          */
+         PickTraversal();
+
+         /**
+          * Starts a new traversal, discarding the one in progress, if any. No
+          * node is actually visited here; call \c resume() for this.
+          * @param camera The camera whose subgraph will be traversed.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param traversalMask The traversal mask; nodes whose node mask
+          *        has no bits in common with it are ignored.
+          */
+         void start(osg::Camera* camera, float x, float y,
+                    osg::Node::NodeMask traversalMask);
+
+         /**
+          * Starts a new traversal of some subgraphs only, discarding the one in
+          * progress, if any. Roots under cameras whose viewports don't contain
+          * the picked position are ignored. Other than that, this is just
+          * like the other version of \c start().
+          * @param roots The subgraphs to traverse.
+          * @param x The horizontal position to pick, in window coordinates.
+          * @param y The vertical position to pick, in window coordinates.
+          * @param traversalMask The traversal mask. Roots whose path contains
+          *        nodes with no bits in common with it are ignored.
+          */
+         void start(const Roots_t& roots, float x, float y,
+                    osg::Node::NodeMask traversalMask);
+
+         /**
+          * Continues the traversal started by \c start().
+          * @param timeLimit The maximum time, in seconds, to spend
+          *        traversing. Zero (the default) means "no limit". Notice that
+          *        the limit is checked between nodes, so a single \c Geode
+          *        with lots of geometry can make the traversal exceed it.
+          *        Also, at least one node is always visited, so that calling
+          *        this repeatedly will eventually finish the traversal.
+          * @return \c true if the traversal has finished; \c false if it was
+          *         suspended because it run out of time.
+          */
+         bool resume(double timeLimit = 0.0);
+
+         /**
+          * Aborts the traversal in progress, if any, and discards the hits
+          * found so far, releasing all references to nodes.
+          */
+         void reset();
+
+         /**
+          * Sets a node whose subgraph is not traversed (for instance, a node
+          * being dragged, which is known to be under the pointer and must not
+          * be picked). Takes effect for nodes visited from now on.
+          * @param node The node to ignore; \c NULL (the default) means that
+          *        no node is ignored.
+          */
+         void setIgnoredNode(const osg::Node* node) { ignoredNode_ = node; }
+
+         /**
+          * Sets the scale applied to the LOD scale of the cameras when
+          * selecting \c osg::LOD children. Values larger than one pick
+          * coarser children than those drawn, which is cheaper. Takes effect
+          * for traversals started from now on.
+          * @param scale The scale; the default is 1.0, which picks exactly
+          *        the children drawn.
+          */
+         void setLODScale(float scale) { lodScale_ = scale; }
+
+         /// Is there a started traversal that has not finished yet?
+         bool isRunning() const { return running_; }
+
+         /**
+          * Returns the hits found so far, sorted by distance from the viewer
+          * once the traversal finishes.
+          */
+         const Hits_t& getHits() const { return hits_; }
+
+         /**
+          * Checks if the segment from \c start to \c end intersects a bounding
+          * sphere, using the same test as \c osgUtil::LineSegmentIntersector.
+          * An invalid sphere is considered to be intersected.
+          */
+         static bool intersects(const osg::BoundingSphere& bs,
+                                const osg::Vec3d& start,
+                                const osg::Vec3d& end);
+
+         /**
+          * Makes the traversal defer the intersection of <tt>Geode</tt>s.
+          * Instead of being intersected when visited, the <tt>Geode</tt>s
+          * under the picked position are collected as candidates (see \c
+          * getCandidates()), along with their triangles, taken from a cache.
+          * The hits are then found by \c intersectCandidates(), which doesn't
+          * touch the scene graph, and can thus run in another thread while
+          * the scene graph is changed. (\c osg::Billboard nodes, whose
+          * geometry depends on the eye position, are still intersected when
+          * visited.) Takes effect for traversals started from now on.
+          * @param cache The cache to take the triangles from. \c NULL (the
+          *        default) means that intersections are not deferred.
+          */
+         void setTriangleCache(TriangleCache* cache) { triangleCache_ = cache; }
+
+         /**
+          * Returns the candidates collected so far, when intersections are
+          * deferred.
+          */
+         const Candidates_t& getCandidates() const { return candidates_; }
+
+         /**
+          * Intersects the picking segment with the triangles of some
+          * candidates. Only the nearest hit in each drawable is found.
+          * @param candidates The candidates, as collected by a traversal.
+          * @param cullBackFaces If \c true, back-facing triangles are
+          *        ignored.
+          * @param hits Output parameter, to which the hits are appended
+          *        (unsorted).
+          */
+         static void intersectCandidates(const Candidates_t& candidates,
+                                         bool cullBackFaces, Hits_t& hits);
+
+      private:
+         /**
+          * A link in a node path. Node paths are kept as linked lists of these
+          * links, so that children share the path of their parents, and so
+          * that the nodes in the path are kept referenced.
+          */
+         struct PathLink: public osg::Referenced
+         {
+            /// Constructs the \c PathLink.
+            PathLink(osg::Node* theNode, PathLink* theParent)
+               : node(theNode), parent(theParent)
+            { }
+
+            /// The node at the end of this path.
+            osg::ref_ptr<osg::Node> node;
+
+            /// The path leading to \c node's parent.
+            osg::ref_ptr<PathLink> parent;
+         };
+
+         /**
+          * The matrices and picking segment of a camera. A new one is created
+          * whenever a nested \c osg::Camera or an \c osg::Projection is
+          * found.
+          */
+         struct CameraSpace: public osg::Referenced
+         {
+            /// The view matrix.
+            osg::Matrixd view;
+
+            /// The projection matrix.
+            osg::Matrixd projection;
+
+            /// The window (viewport) matrix.
+            osg::Matrixd window;
+
+            /// The segment start, in this camera's world coordinates.
+            osg::Vec3d worldStart;
+
+            /// The segment end, in this camera's world coordinates.
+            osg::Vec3d worldEnd;
+
+            /**
+             * The LOD scale of the cameras. (Multiplied by \c lodScale_ to
+             * select \c osg::LOD children.)
+             */
+            float lodScale;
+         };
+
+         /// An entry in the stack of nodes still to be visited.
+         struct Frame
+         {
+            /// The path to the node to visit (including it).
+            osg::ref_ptr<PathLink> path;
+
+            /// The camera whose subgraph contains the node.
+            osg::ref_ptr<CameraSpace> space;
+
+            /**
+             * The matrix taking the node's parent coordinates to \c space's
+             * world coordinates. \c NULL means identity.
+             */
+            osg::ref_ptr<osg::RefMatrix> model;
+
+            /// The picking segment start, in the node's parent coordinates.
+            osg::Vec3d start;
+
+            /// The picking segment end, in the node's parent coordinates.
+            osg::Vec3d end;
+         };
+
+         /**
+          * Updates a camera space and a model matrix when entering a nested
+          * camera. This mimics what \c osgUtil::IntersectionVisitor does.
+          * @param camera The camera being entered.
+          * @param space The camera space. Must contain the matrices and LOD
+          *        scale of the parent camera; will be updated with those of
+          *        \c camera. (The segment is not updated.)
+          * @param model The model matrix; it is reset to \c NULL (identity)
+          *        if \c camera has an absolute reference frame.
+          */
+         static void enterCamera(const osg::Camera& camera, CameraSpace& space,
+                                 osg::ref_ptr<osg::RefMatrix>& model);
+
+         /**
+          * Computes the world coordinates of the picking segment for a given
+          * \c CameraSpace, whose matrices must be already set.
+          */
+         void computeWorldSegment(CameraSpace& space) const;
+
+         /**
+          * Pushes the children of a group to the stack.
+          * @param group The group whose children will be pushed.
+          * @param path The path leading to \c group (including it).
+          * @param space The camera whose subgraph contains \c group.
+          * @param model The matrix taking \c group's children coordinates to
+          *        \c space's world coordinates. \c NULL means identity.
+          * @param start The picking segment start, in \c group's children
+          *        coordinates.
+          * @param end The picking segment end, in \c group's children
+          *        coordinates.
+          */
+         void pushChildren(osg::Group& group, PathLink* path,
+                           CameraSpace* space, osg::RefMatrix* model,
+                           const osg::Vec3d& start, const osg::Vec3d& end);
+
+         /**
+          * Like \c pushChildren(), but computes the picking segment from \c
+          * space and \c model.
+          */
+         void pushChildren(osg::Group& group, PathLink* path,
+                           CameraSpace* space, osg::RefMatrix* model);
+
+         /// Visits one node, the one described by \c frame.
+         void visit(const Frame& frame);
+
+         /**
+          * Visits a nested camera. Cameras not drawing to the frame buffer,
+          * and cameras with their own viewport not containing the picked
+          * position, are skipped along with their subgraphs.
+          */
+         void visitCamera(const Frame& frame, osg::Camera& camera);
+
+         /// Visits an \c osg::LOD, pushing only its selected children.
+         void visitLOD(const Frame& frame, osg::LOD& lod);
+
+         /// Visits an \c osg::Projection node.
+         void visitProjection(const Frame& frame, osg::Projection& projection);
+
+         /**
+          * Intersects the picking segment with the drawables of a \c Geode,
+          * or collects it as a candidate if intersections are deferred.
+          */
+         void intersectGeode(const Frame& frame, osg::Geode& geode);
+
+         /// Converts a \c PathLink list to an \c osg::NodePath.
+         static osg::NodePath makeNodePath(const PathLink* path);
+
+         /// The stack of nodes still to be visited.
+         std::vector<Frame> stack_;
+
+         /// The hits found so far.
+         Hits_t hits_;
+
+         /// The candidates found so far, when intersections are deferred.
+         Candidates_t candidates_;
+
+         /// The cache of triangles used when intersections are deferred.
+         osg::ref_ptr<TriangleCache> triangleCache_;
+
+         /// The horizontal position being picked, in window coordinates.
+         float x_;
+
+         /// The vertical position being picked, in window coordinates.
+         float y_;
+
+         /// The traversal mask used.
+         osg::Node::NodeMask traversalMask_;
+
+         /// The node whose subgraph is not traversed, if any.
+         const osg::Node* ignoredNode_;
+
+         /// The scale applied to the cameras' LOD scale.
+         float lodScale_;
+
+         /// Is there a traversal in progress?
+         bool running_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_PICK_TRAVERSAL_HPP_
@@ -0,0 +1,70 @@
+/******************************************************************************\
+* PointerSource.hpp                                                            *
+* Sources of pointing rays other than the mouse.                               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_POINTER_SOURCE_HPP_
+#define _OSGUISH_POINTER_SOURCE_HPP_
+
+#include <boost/shared_ptr.hpp>
+#include <osg/View>
+#include <osgGA/GUIEventAdapter>
+#include <OSGUIsh/BatchPickTraversal.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * An abstract class defining an interface for pointers other than the
+    * mouse: tracked wands, gaze directions, scripted probes and the like. A
+    * pointer source provides a line segment in world coordinates (instead of
+    * a position in the window) and the state of its buttons. The \c
+    * EventHandler uses this to generate the same events it generates for the
+    * mouse.
+    */
+   class PointerSource
+   {
+      public:
+         /// Destroys the \c PointerSource.
+         virtual ~PointerSource();
+
+         /**
+          * Concrete subclasses will implement this to provide the segment
+          * along which the pointer is pointing. This is called once per frame,
+          * while handling the \c FRAME event.
+          * @param view The view displaying the scene.
+          * @param ea The \c FRAME event generated by OSG.
+          * @param segment Output parameter, where the segment is stored, in
+          *        the world coordinates of the view's camera.
+          * @return \c false if the pointer is not pointing anywhere right now
+          *         (in which case it is handled as if pointing at nothing).
+          */
+         virtual bool getSegment(osg::View* view,
+                                 const osgGA::GUIEventAdapter& ea,
+                                 BatchPickTraversal::Segment& segment) = 0;
+
+         /**
+          * Returns the buttons currently pressed, as a combination of \c
+          * osgGA::GUIEventAdapter::MouseButtonMask flags. Button presses and
+          * releases generate \c EVENT_MOUSE_DOWN, \c EVENT_MOUSE_UP, \c
+          * EVENT_CLICK and \c EVENT_DOUBLE_CLICK just like the mouse buttons.
+          * The default implementation returns zero (a pointer without
+          * buttons).
+          */
+         virtual unsigned getButtonMask();
+   };
+
+
+
+   /// A (smart) pointer to a \c PointerSource.
+   typedef boost::shared_ptr<PointerSource> PointerSourcePtr;
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_POINTER_SOURCE_HPP_
@@ -0,0 +1,73 @@
+/******************************************************************************\
+* RayPointerSource.hpp                                                         *
+* A pointer source whose segment and buttons are set explicitly.               *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_RAY_POINTER_SOURCE_HPP_
+#define _OSGUISH_RAY_POINTER_SOURCE_HPP_
+
+#include <OSGUIsh/PointerSource.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A pointer source whose segment and buttons are set explicitly by the
+    * application. This is typically updated with the pose of a tracked
+    * device (or with the head pose, for gaze pointing) before each frame.
+    */
+   class RayPointerSource: public PointerSource
+   {
+      public:
+         /// Constructs a \c RayPointerSource, initially inactive.
+         RayPointerSource();
+
+         /**
+          * Sets the segment along which the pointer points, and makes the
+          * pointer active.
+          * @param start The segment start, in world coordinates.
+          * @param end The segment end, in world coordinates.
+          */
+         void setSegment(const osg::Vec3d& start, const osg::Vec3d& end);
+
+         /**
+          * Makes the pointer active or inactive. An inactive pointer points
+          * at nothing.
+          */
+         void setActive(bool active) { active_ = active; }
+
+         /**
+          * Sets the buttons currently pressed.
+          * @param buttonMask A combination of \c
+          *        osgGA::GUIEventAdapter::MouseButtonMask flags.
+          */
+         void setButtonMask(unsigned buttonMask) { buttonMask_ = buttonMask; }
+
+         // (inherits documentation)
+         virtual bool getSegment(osg::View* view,
+                                 const osgGA::GUIEventAdapter& ea,
+                                 BatchPickTraversal::Segment& segment);
+
+         // (inherits documentation)
+         virtual unsigned getButtonMask();
+
+      private:
+         /// The segment along which the pointer points.
+         BatchPickTraversal::Segment segment_;
+
+         /// Is the pointer active?
+         bool active_;
+
+         /// The buttons currently pressed.
+         unsigned buttonMask_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_RAY_POINTER_SOURCE_HPP_
@@ -0,0 +1,203 @@
+/******************************************************************************\
+* RegionSelector.hpp                                                           *
+* Finds the registered nodes inside a rectangle or lasso.                      *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_REGION_SELECTOR_HPP_
+#define _OSGUISH_REGION_SELECTOR_HPP_
+
+#include <vector>
+#include <osg/Camera>
+#include <osg/Vec2>
+#include <osg/Vec4d>
+#include <OSGUIsh/Types.hpp>
+
+
+namespace OSGUIsh
+{
+   /**
+    * Finds which nodes, among a set of candidates, are inside a region of the
+    * window: a rectangle or a lasso (an arbitrary polygon). A node is inside
+    * the region if any of its triangles is at least partially inside it.
+    * <p>Candidates are culled first by testing their bounding spheres against
+    * the sub-frustum defined by the region bounding rectangle. Only the nodes
+    * whose bounding spheres cross the sub-frustum boundary (or, for a lasso,
+    * that are not culled at all) have their triangles tested; nodes whose
+    * bounding spheres are entirely inside a rectangle are selected right
+    * away.
+    * <p>The selection is updated incrementally: when a rectangle grows, only
+    * the nodes not yet selected are tested; when it shrinks, only the
+    * selected ones are.
+    * @note Points and lines are not considered; only triangles.
+    */
+   class RegionSelector
+   {
+      public:
+         /// A polygon, in window coordinates.
+         typedef std::vector<osg::Vec2> Polygon_t;
+
+         /// Constructs a \c RegionSelector, with no candidates.
+         RegionSelector();
+
+         /**
+          * Sets the candidate nodes. Their placement in the scene, as viewed
+          * through a camera, is captured now; if the scene or the camera
+          * change, this must be called again. Nodes that were selected remain
+          * selected if they are still candidates.
+          * @param camera The camera through which the scene is viewed. Only
+          *        the instances of the candidates under this camera are
+          *        considered.
+          * @param nodes The candidate nodes.
+          * @param traversalMask The traversal mask used when testing the
+          *        triangles of the candidates.
+          * @param removed Output parameter, where the selected nodes that are
+          *        no longer candidates are stored.
+          */
+         void setCandidates(osg::Camera* camera, const Nodes_t& nodes,
+                            osg::Node::NodeMask traversalMask,
+                            Nodes_t& removed);
+
+         /**
+          * Sets the region to a rectangle, updating the selection.
+          * @param corner1 One corner of the rectangle, in window coordinates.
+          * @param corner2 The opposite corner, in window coordinates.
+          * @param added Output parameter, where the nodes that entered the
+          *        selection are stored.
+          * @param removed Output parameter, where the nodes that left the
+          *        selection are stored.
+          */
+         void selectRectangle(const osg::Vec2& corner1,
+                              const osg::Vec2& corner2,
+                              Nodes_t& added, Nodes_t& removed);
+
+         /**
+          * Sets the region to a lasso, updating the selection.
+          * @param lasso The lasso polygon, in window coordinates. It is
+          *        implicitly closed, and may be self-intersecting (the
+          *        even-odd rule is used).
+          * @param added Output parameter, where the nodes that entered the
+          *        selection are stored.
+          * @param removed Output parameter, where the nodes that left the
+          *        selection are stored.
+          */
+         void selectLasso(const Polygon_t& lasso,
+                          Nodes_t& added, Nodes_t& removed);
+
+         /**
+          * Clears the selection (and the region).
+          * @param removed Output parameter, where the nodes that left the
+          *        selection are stored.
+          */
+         void clear(Nodes_t& removed);
+
+         /**
+          * Gets the selected nodes.
+          * @param selection Output parameter, where the nodes are stored.
+          */
+         void getSelection(Nodes_t& selection) const;
+
+      private:
+         /// A candidate node.
+         struct Candidate
+         {
+            /// The node.
+            NodePtr node;
+
+            /**
+             * For each instance of the node in the scene, the matrix taking
+             * the coordinates of its parent to (homogeneous) window
+             * coordinates.
+             */
+            std::vector<osg::Matrixd> toWindow;
+
+            /// Is the node selected?
+            bool selected;
+         };
+
+         /// A sequence of candidates.
+         typedef std::vector<Candidate> Candidates_t;
+
+         /// A region of the window.
+         struct Region
+         {
+            /// The region bounding rectangle.
+            float xMin, xMax, yMin, yMax;
+
+            /// The lasso polygon; empty if the region is a rectangle.
+            Polygon_t lasso;
+         };
+
+         /// The possible results of testing a bounding sphere.
+         enum Classification
+         {
+            OUTSIDE,  ///< Entirely outside the region sub-frustum.
+            INSIDE,   ///< Entirely inside the region sub-frustum.
+            BOUNDARY  ///< Crossing the region sub-frustum boundary.
+         };
+
+         /// The visitor testing the triangles of a candidate.
+         class TriangleTest;
+         friend class TriangleTest;
+
+         /**
+          * Updates the selection for a new region.
+          * @param region The new region.
+          * @param testSelected Should the selected nodes be tested?
+          * @param testUnselected Should the nodes not selected be tested?
+          */
+         void select(const Region& region, bool testSelected,
+                     bool testUnselected, Nodes_t& added, Nodes_t& removed);
+
+         /// Checks whether a candidate is inside \c region_.
+         bool isInside(const Candidate& candidate) const;
+
+         /**
+          * Classifies a bounding sphere against the sub-frustum of the
+          * bounding rectangle of \c region_.
+          * @param bs The bounding sphere.
+          * @param toWindow The matrix taking the bounding sphere coordinates
+          *        to homogeneous window coordinates.
+          */
+         Classification classify(const osg::BoundingSphere& bs,
+                                 const osg::Matrixd& toWindow) const;
+
+         /**
+          * Checks whether a triangle, in homogeneous window coordinates, is
+          * at least partially inside \c region_.
+          */
+         bool overlaps(const osg::Vec4d& v0, const osg::Vec4d& v1,
+                       const osg::Vec4d& v2) const;
+
+         /// Checks whether a point is inside a polygon (even-odd rule).
+         static bool isInPolygon(const osg::Vec2& point,
+                                 const Polygon_t& polygon);
+
+         /// The candidate nodes.
+         Candidates_t candidates_;
+
+         /// The traversal mask used when testing triangles.
+         osg::Node::NodeMask traversalMask_;
+
+         /// The current region.
+         Region region_;
+
+         /// Is there a current region?
+         bool hasRegion_;
+
+         /**
+          * The planes of the sub-frustum of \c region_ bounding rectangle, in
+          * homogeneous window coordinates. Points inside have non-negative
+          * distances to all of them.
+          */
+         osg::Vec4d planes_[6];
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_REGION_SELECTOR_HPP_
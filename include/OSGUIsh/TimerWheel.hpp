@@ -0,0 +1,115 @@
+/******************************************************************************\
+* TimerWheel.hpp                                                               *
+* A hashed timing wheel.                                                       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_TIMER_WHEEL_HPP_
+#define _OSGUISH_TIMER_WHEEL_HPP_
+
+#include <map>
+#include <vector>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A hashed timing wheel: a circular array of slots, each one holding the
+    * timers that expire during a fixed time interval (the wheel resolution).
+    * Timers farther in the future than a full turn of the wheel just stay in
+    * their slot for more turns. Scheduling and canceling are cheap, and
+    * advancing the wheel visits only the slots for the elapsed time; when no
+    * timers are pending, advancing costs nothing at all.
+    * <p>Time is just a number here (the \c EventHandler uses the time of the
+    * events given by OSG), and it is expected to never go backwards.
+    */
+   class TimerWheel
+   {
+      public:
+         /// Identifies a timer. Chosen by the user of the wheel.
+         typedef unsigned long TimerId;
+
+         /// A sequence of timer IDs.
+         typedef std::vector<TimerId> TimerIds_t;
+
+         /**
+          * Constructs a \c TimerWheel.
+          * @param resolution The time interval covered by each slot.
+          * @param numSlots The number of slots.
+          */
+         explicit TimerWheel(double resolution = 1.0 / 64.0,
+                             std::size_t numSlots = 256);
+
+         /**
+          * Schedules a timer. If a timer with the same ID is already pending,
+          * it is rescheduled.
+          * @param id The timer ID.
+          * @param time When the timer expires. If this is in the past, the
+          *        timer expires in the next call to \c advance().
+          */
+         void schedule(TimerId id, double time);
+
+         /**
+          * Cancels a pending timer. Canceling a timer that is not pending does
+          * nothing.
+          */
+         void cancel(TimerId id);
+
+         /**
+          * Advances the wheel to a given time, collecting the timers that
+          * expired.
+          * @param now The current time.
+          * @param expired Output parameter, where the IDs of the expired
+          *        timers are stored, sorted by expiration time. Expired timers
+          *        are no longer pending.
+          */
+         void advance(double now, TimerIds_t& expired);
+
+         /// Are there no pending timers?
+         bool empty() const { return pending_.empty(); }
+
+      private:
+         /// A timer in a slot.
+         struct Entry
+         {
+            /// The timer ID.
+            TimerId id;
+
+            /// When it expires.
+            double time;
+         };
+
+         /// A slot: the timers expiring in a given interval, in any turn.
+         typedef std::vector<Entry> Slot_t;
+
+         /// Returns the tick (the slot number, not wrapped) of a given time.
+         long getTick(double time) const;
+
+         /// The time interval covered by each slot.
+         double resolution_;
+
+         /// The slots.
+         std::vector<Slot_t> slots_;
+
+         /**
+          * The pending timers and their expiration times. Slot entries not
+          * matching an entry here were canceled or rescheduled, and are
+          * discarded when found.
+          */
+         std::map<TimerId, double> pending_;
+
+         /// The number of entries in all slots, including stale ones.
+         std::size_t numEntries_;
+
+         /// The tick of the last call to \c advance().
+         long currentTick_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_TIMER_WHEEL_HPP_
@@ -0,0 +1,189 @@
+/******************************************************************************\
+* TriangleCache.hpp                                                            *
+* A cache of the triangles of drawables, laid out for fast intersection.       *
+*                                                                              *
+* Copyright (C) 2011 by Leandro Motta Barros.                                  *
+*                                                                              *
+* This program is distributed under the OpenSceneGraph Public License. You     *
+* should have received a copy of it with the source distribution, in a file    *
+* named 'COPYING.txt'.                                                         *
+\******************************************************************************/
+
+#ifndef _OSGUISH_TRIANGLE_CACHE_HPP_
+#define _OSGUISH_TRIANGLE_CACHE_HPP_
+
+#include <map>
+#include <vector>
+#include <osg/Array>
+#include <osg/Drawable>
+#include <osg/observer_ptr>
+#include <osg/ref_ptr>
+#include <osg/Referenced>
+#include <osg/Vec3d>
+#include <OpenThreads/Mutex>
+
+
+namespace OSGUIsh
+{
+   /**
+    * A cache of the triangles of drawables, in a layout suitable for testing
+    * many of them against a segment at once. Extracting the triangles of a
+    * drawable is typically much more expensive than intersecting them, so
+    * doing it once and reusing the result while the drawable doesn't change
+    * is what makes picking with many segments (or many times) cheap.
+    * <p>A cached entry is discarded when its drawable changes: for an \c
+    * osg::Geometry, this is detected by the modified counts of its vertex
+    * array and primitive sets (so, just like for OSG itself, \c dirty() must
+    * be called on them after they are changed); for other drawables, by
+    * their bounding box.
+    * <p>Can be used from several threads at once.
+    */
+   class TriangleCache: public osg::Referenced
+   {
+      public:
+         /**
+          * The triangles of a drawable, in "structure of arrays" layout, so
+          * that they can be tested four at a time. The number of triangles
+          * is padded to a multiple of four with degenerate ones. Filled by
+          * an \c osg::TriangleFunctor, and never changed after that, so that
+          * it can be freely shared among threads.
+          */
+         class Triangles: public osg::Referenced
+         {
+            public:
+               /// Adds a triangle.
+               void operator()(const osg::Vec3& v0, const osg::Vec3& v1,
+                               const osg::Vec3& v2);
+
+               /// Adds a triangle (signature used by older OSG versions).
+               void operator()(const osg::Vec3& v0, const osg::Vec3& v1,
+                               const osg::Vec3& v2, bool)
+               { (*this)(v0, v1, v2); }
+
+               /// Pads the arrays to a multiple of four triangles.
+               void pad();
+
+               /// The number of triangles, including padding.
+               std::size_t size() const { return v0x.size(); }
+
+               /**
+                * Finds the nearest triangle hit by a segment.
+                * @param start The segment start point.
+                * @param end The segment end point.
+                * @param cullBackFaces If \c true, back-facing triangles are
+                *        ignored.
+                * @param ratio Input and output parameter: only hits nearer
+                *        than this (0.0 is at \c start, 1.0 at \c end) are
+                *        considered; updated with the ratio of the hit found.
+                * @return The index of the triangle hit, or \c size() if none
+                *         was hit.
+                */
+               std::size_t intersect(const osg::Vec3d& start,
+                                     const osg::Vec3d& end,
+                                     bool cullBackFaces, float& ratio) const;
+
+               /// Returns the (unnormalized) normal of a triangle.
+               osg::Vec3d getNormal(std::size_t i) const;
+
+               /// The first vertex of each triangle.
+               std::vector<float> v0x, v0y, v0z;
+
+               /// The edge from the first to the second vertex.
+               std::vector<float> e1x, e1y, e1z;
+
+               /// The edge from the first to the third vertex.
+               std::vector<float> e2x, e2y, e2z;
+         };
+
+         /// A pointer to a set of cached triangles.
+         typedef osg::ref_ptr<const Triangles> TrianglesPtr;
+
+         /**
+          * Returns the triangles of a drawable, extracting them if they are
+          * not cached yet, or if the drawable changed since they were.
+          * @param drawable The drawable.
+          * @return The triangles. Remain valid (and unchanged) even if the
+          *         cache is cleared or the drawable changes.
+          */
+         TrianglesPtr get(osg::Drawable& drawable);
+
+         /**
+          * Discards the cached triangles of drawables that no longer exist.
+          * Entries are never discarded otherwise (an entry is just replaced
+          * when its drawable changes), so this should be called from time to
+          * time if drawables are removed from the scene.
+          */
+         void prune();
+
+         /// Discards all cached triangles.
+         void clear();
+
+      protected:
+         /// Destroys the \c TriangleCache.
+         virtual ~TriangleCache() { }
+
+      private:
+         /// What identifies a version of a drawable's geometry.
+         struct Signature
+         {
+            /// Constructs the \c Signature of a drawable.
+            explicit Signature(osg::Drawable& drawable);
+
+            /// Are the two signatures equal?
+            bool operator==(const Signature& other) const;
+
+            /// The vertex array (for an \c osg::Geometry).
+            const osg::Array* vertices;
+
+            /// The modified count of \c vertices.
+            unsigned verticesModified;
+
+            /// The number of primitive sets (for an \c osg::Geometry).
+            unsigned numPrimitiveSets;
+
+            /// The sum of the modified counts of the primitive sets.
+            unsigned primitivesModified;
+
+            /// The minimum corner of the drawable bounding box.
+            osg::Vec3 boundMin;
+
+            /// The maximum corner of the drawable bounding box.
+            osg::Vec3 boundMax;
+         };
+
+         /// An entry in the cache.
+         struct Entry
+         {
+            /// Constructs the \c Entry.
+            Entry(osg::Drawable& theDrawable, const Signature& theSignature,
+                  const Triangles* theTriangles)
+               : drawable(&theDrawable), signature(theSignature),
+                 triangles(theTriangles)
+            { }
+
+            /**
+             * The drawable. Observed, so that a new drawable allocated at
+             * the address of a deleted one is not mistaken for it.
+             */
+            osg::observer_ptr<osg::Drawable> drawable;
+
+            /// The signature of the drawable when the triangles were cached.
+            Signature signature;
+
+            /// The triangles.
+            TrianglesPtr triangles;
+         };
+
+         /// The type used to store the entries, indexed by drawable.
+         typedef std::map<const osg::Drawable*, Entry> Entries_t;
+
+         /// The cached entries.
+         Entries_t entries_;
+
+         /// Protects \c entries_.
+         OpenThreads::Mutex mutex_;
+   };
+
+} // namespace OSGUIsh
+
+#endif // _OSGUISH_TRIANGLE_CACHE_HPP_
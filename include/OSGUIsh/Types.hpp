@@ -12,6 +12,7 @@
 #ifndef _OSGUISH_TYPES_HPP_
 #define _OSGUISH_TYPES_HPP_
 
+#include <vector>
 #include <osg/Node>
 #include <osgUtil/LineSegmentIntersector>
 #include <osgUtil/PolytopeIntersector>
@@ -22,6 +23,18 @@ namespace OSGUIsh
    /// A (smart) pointer to a scene graph node.
    typedef osg::ref_ptr<osg::Node> NodePtr;
 
+   /// A sequence of (smart) pointers to scene graph nodes.
+   typedef std::vector<NodePtr> Nodes_t;
+
+   /**
+    * Identifies a pointer: the mouse or any other device generating pointer
+    * events (see \c PointerSource).
+    */
+   typedef unsigned PointerId;
+
+   /// The \c PointerId of the mouse.
+   const PointerId MOUSE_POINTER = 0;
+
    /**
     * An intersection (a hit when picking). OSG has types similar to this one,
     * but, unfortunately, they are directly coupled with the different
@@ -83,6 +96,40 @@ namespace OSGUIsh
          osg::Vec3d localIntersectionNormal;
    };
 
+
+
+   /**
+    * The result of picking at a given position. Contains both the node
+    * registered with OSGUIsh that was picked and the "low level" hit that led
+    * to it.
+    */
+   struct PickResult
+   {
+      public:
+         /// Constructs a \c PickResult representing "nothing picked".
+         PickResult() : hasHit(false) { }
+
+         /**
+          * The registered node picked. This is invalid if nothing was picked,
+          * and also if the picked geometry doesn't belong to any registered
+          * node.
+          */
+         NodePtr node;
+
+         /**
+          * The hit that originated this result. Meaningful only if \c hasHit
+          * is \c true.
+          */
+         Intersection_t hit;
+
+         /**
+          * Was anything hit at all? (Notice that this can be \c true even if
+          * \c node is invalid: this happens when the hit geometry is not part
+          * of any registered node.)
+          */
+         bool hasHit;
+   };
+
 } // namespace OSGUIsh
 
 #endif // _OSGUISH_TYPES_HPP_